@@ -0,0 +1,1317 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <memory>
+#include <atomic>
+#include <thread>
+
+#include <opencv2/core.hpp>
+
+#include "ZoneManager.h"
+#include "LEDCounts.h"
+#include "LedColors.h"
+#include "Frame.h"
+#include "ColorInterpolator.h"
+#include "LedSink.h"
+#include "NullLedSink.h"
+#include "RecordingLedSink.h"
+#include "MockLedSink.h"
+#include "MultiLedSink.h"
+#include "LetterboxDetector.h"
+#include "ChangeDetector.h"
+#include "SumKernels.h"
+#include "Pipeline.h"
+#include "RealTime.h"
+#include "const_config.h"
+
+#ifdef __linux__
+#include "BorderRecorder.h"
+#include "ReplayFrameSource.h"
+#include "DdpLedSink.h"
+
+#include <mutex>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+/*
+	Purpose:
+	Measures the hot path of the program (convert -> zone averages -> black bar detection -> interpolation -> color packing -> render) with generated frames.
+	No capture card or led-strip is needed, so every change to the hot path can be measured on a ordinary Linux box.
+
+	Usage: TV_ambient_lighting_benchmark [--iterations N] [--quick] [--record FILE] [--static] [--flat] [--stride N] [--verify] [--outputs] [--borders FILE] [--replay FILE] [--ddp] [--geometry] [--changes] [--dominant] [--jitter] [--hdr]
+	--record renders to a RecordingLedSink instead of a NullLedSink, to measure the cost of recording.
+	--static uses the same frame for every iteration (a paused movie), to measure the gain of the change detection.
+	--flat uses hard edged zones where every pixel counts the same, to measure the cost of the weighted (overlapping) zones.
+	--stride samples only every N rows of the zones, like the QualityGovernor does when the analysis is too slow.
+	--verify checks that every SumKernels the CPU supports gives the exact same sums as the scalar reference, and measures them.
+	--outputs renders to layouts of mock WS281x strips (MultiLedSink), checks which leds every strip gets and measures the render rate.
+	--borders records generated frames as border strips to FILE, plays them back and checks that the zones get the exact same averages.
+	--replay plays back a border recording (BORDER_RECORDING) as fast as possible, measures the analysis and prints a checksum of the averages to compare runs.
+	--geometry switches the input resolution and black bars back and forth, checks that the zones cover the sides of the content exactly
+	  and get the same averages as a fresh ZoneManager, and measures a switch to a new and to a cached layout.
+	--changes checks that the change detection marks a zone dirty on a slow fade (less than its threshold per frame) and on a change of only the hue of NV12.
+	--dominant checks that the dominant color mode picks the saturated color of a zone and that its incremental histograms give the same colors as counting from scratch,
+	  and measures the zones of the dominant color mode against the (weighted and flat) average, moving and paused.
+	--hdr checks that the 16 bit formats (BGR16, Y210, P010) of a SDR source give the exact same zone colors as the 8 bit ones, prints the tone curve of PQ and HLG
+	  and measures the zones of the 16 bit formats (tone mapped) against the 8 bit ones.
+	--jitter measures how late a render clock wakes up (like cyclictest) for --iterations ticks while every core is busy, as a normal task and in the real-time mode (run as root).
+	--ddp sends packed BGR colors to a DDP receiver on the loopback, checks that the receiver ends up with the same colors as R, G, B (also with the white of a RGBW strip extracted)
+	  and counts the packets (all leds and a few leds changing).
+*/
+
+enum class InputFormat {
+	BGR,
+	YUYV, // <- Averaged as YUYV
+	NV12, // <- Averaged as NV12
+	YUYV_CONVERTED // <- Converted to BGR first, like cv::VideoCapture does
+};
+
+const char* getInputFormatName(InputFormat format) {
+	switch (format) {
+	case InputFormat::BGR: return "BGR";
+	case InputFormat::YUYV: return "YUYV";
+	case InputFormat::NV12: return "NV12";
+	case InputFormat::YUYV_CONVERTED: return "YUYV>BGR";
+	}
+	return "?";
+}
+
+struct Resolution {
+	const char* name;
+	Dimensions dimensions;
+};
+
+/// <summary>
+/// Stores the duration of a stage for every iteration and calculates the percentiles from it.
+/// </summary>
+struct StageTimings {
+	const char* name;
+	std::vector<double> samplesUS;
+
+	void add(std::chrono::steady_clock::duration duration) {
+		samplesUS.push_back(std::chrono::duration<double, std::micro>(duration).count());
+	}
+
+	double percentile(double p) {
+		if (samplesUS.empty()) return 0.0;
+
+		size_t index = std::min(samplesUS.size() - 1, (size_t)(p * samplesUS.size()));
+		std::nth_element(samplesUS.begin(), samplesUS.begin() + index, samplesUS.end());
+		return samplesUS[index];
+	}
+
+	double max() const {
+		return samplesUS.empty() ? 0.0 : *std::max_element(samplesUS.begin(), samplesUS.end());
+	}
+};
+
+/// <summary>
+/// Spreads the given amount of leds over the sides of a 16:9 screen.
+/// The led count of the config is used as is.
+/// </summary>
+LEDCounts makeLEDCounts(unsigned int ledCount) {
+	if (ledCount == Config::LED_COUNTS.all()) return Config::LED_COUNTS;
+
+	unsigned int horizontal = (unsigned int)(ledCount * 16.0 / (2 * (16 + 9)));
+	unsigned int vertical = ledCount - horizontal * 2;
+
+	return LEDCounts{
+		.top = horizontal,
+		.bottom = horizontal,
+		.left = vertical / 2,
+		.right = vertical - vertical / 2
+	};
+}
+
+/// <summary>
+/// Generates a few frames with noise on top of a gradient, so every iteration gets other content.
+/// </summary>
+std::vector<Frame> generateFrames(Dimensions dimensions, InputFormat format, int frameCount) {
+	std::vector<Frame> frames;
+
+	for (int i = 0; i < frameCount; i++) {
+		Frame frame;
+		switch (format) {
+		case InputFormat::BGR:
+			frame.image.create(dimensions.height, dimensions.width, CV_8UC3);
+			frame.format = PixelFormat::BGR;
+			break;
+		case InputFormat::YUYV:
+		case InputFormat::YUYV_CONVERTED:
+			frame.image.create(dimensions.height, dimensions.width, CV_8UC2);
+			frame.format = PixelFormat::YUYV;
+			break;
+		case InputFormat::NV12:
+			frame.image.create(dimensions.height * 3 / 2, dimensions.width, CV_8UC1);
+			frame.format = PixelFormat::NV12;
+			break;
+		}
+		cv::randu(frame.image, cv::Scalar::all(0), cv::Scalar::all(256));
+
+		// Gradient over the noise, shifted every frame
+		const int channels = frame.image.channels();
+		for (int y = 0; y < frame.image.rows; y++) {
+			uchar* row = frame.image.ptr<uchar>(y);
+			for (int x = 0; x < frame.image.cols; x++) {
+				uchar gradient = (uchar)((x + y + i * 32) & 0xFF);
+				row[x * channels] = (uchar)((row[x * channels] + gradient) / 2);
+			}
+		}
+
+		frames.push_back(frame);
+	}
+
+	return frames;
+}
+
+/// <summary>
+/// Runs all stages on the generated frames for the given amount of iterations and prints the results as one row.
+/// </summary>
+void runBenchmark(const Resolution& resolution, InputFormat format, unsigned int ledCount, int iterations, bool staticFrames, bool flatZones, int rowStride, LedSink& ledSink) {
+	using Clock = std::chrono::steady_clock;
+
+	std::vector<Frame> frames = generateFrames(resolution.dimensions, format, staticFrames ? 1 : 4);
+
+	ZoneManager zoneManager(makeLEDCounts(ledCount), resolution.dimensions);
+	if (flatZones) zoneManager.setSamplingKernel(SamplingKernel());
+	zoneManager.setRowStride(rowStride);
+	Frame bgrFrame;
+	LetterboxDetector letterboxDetector(Config::LETTERBOX_DETECTION_INTERVAL_FRAMES, Config::LETTERBOX_BLACK_LEVEL, Config::LETTERBOX_STABLE_DETECTIONS);
+	ColorInterpolator interpolator(Config::LED_SMOOTHING_TIME_MS);
+	const ColorCorrection colorCorrection(Config::COLOR_CORRECTION);
+	std::vector<cv::Vec3b> colors;
+	std::vector<uint32_t> ledColors;
+	std::vector<uint32_t> lastRenderedColors;
+	int skippedRenderCount = 0;
+
+	StageTimings convertTimings = { "convert" };
+	StageTimings reduceTimings = { "reduce" };
+	StageTimings barsTimings = { "bars" };
+	StageTimings interpolateTimings = { "interp" };
+	StageTimings packTimings = { "pack" };
+	StageTimings renderTimings = { "render" };
+	StageTimings totalTimings = { "total" };
+
+	// Warm-up, so allocations and the first-touch of the frames are not measured
+	for (int i = 0; i < 3; i++) {
+		const Frame& frame = frames[i % frames.size()];
+		if (format == InputFormat::YUYV_CONVERTED) convertToBGR(frame, bgrFrame.image);
+		zoneManager.calculateAverages(format == InputFormat::YUYV_CONVERTED ? bgrFrame : frame);
+		getLedColors(colors, zoneManager);
+		packLedColors(colors, ledColors, colorCorrection);
+	}
+
+	uint64_t skippedZonesBefore = zoneManager.getSkippedZoneCount();
+	uint64_t zonesBefore = skippedZonesBefore + zoneManager.getCalculatedZoneCount();
+
+	auto benchmarkStart = Clock::now();
+	for (int i = 0; i < iterations; i++) {
+		const Frame& frame = frames[i % frames.size()];
+
+		auto start = Clock::now();
+
+		// Convert
+		const Frame* input = &frame;
+		if (format == InputFormat::YUYV_CONVERTED) {
+			convertToBGR(frame, bgrFrame.image);
+			input = &bgrFrame;
+		}
+		auto converted = Clock::now();
+
+		// Reduce
+		zoneManager.calculateAverages(*input);
+		auto reduced = Clock::now();
+
+		// Black bars
+		if (letterboxDetector.update(*input)) zoneManager.setContentRect(letterboxDetector.getContentRect());
+		auto detected = Clock::now();
+
+		// Interpolate, one new target and one tick of the render clock
+		getLedColors(colors, zoneManager);
+		interpolator.setTarget(colors, detected, detected);
+		interpolator.update(detected + std::chrono::milliseconds(4));
+		interpolator.getColors(colors);
+		auto interpolated = Clock::now();
+
+		// Pack
+		packLedColors(colors, ledColors, colorCorrection);
+		auto packed = Clock::now();
+
+		// Render (only when the colors changed, like the render stage does)
+		if (hasLedColorsChanged(ledColors, lastRenderedColors, Config::RENDER_CHANGE_THRESHOLD)) {
+			ledSink.render(ledColors);
+			lastRenderedColors = ledColors;
+		}
+		else {
+			skippedRenderCount++;
+		}
+		auto rendered = Clock::now();
+
+		convertTimings.add(converted - start);
+		reduceTimings.add(reduced - converted);
+		barsTimings.add(detected - reduced);
+		interpolateTimings.add(interpolated - detected);
+		packTimings.add(packed - interpolated);
+		renderTimings.add(rendered - packed);
+		totalTimings.add(rendered - start);
+	}
+	double benchmarkSeconds = std::chrono::duration<double>(Clock::now() - benchmarkStart).count();
+
+	// Print results
+	std::cout << std::left << std::setw(6) << resolution.name
+		<< std::setw(9) << getInputFormatName(format)
+		<< std::right << std::setw(5) << ledCount << " LEDs";
+
+	std::cout << std::fixed << std::setprecision(1);
+	for (StageTimings* timings : { &convertTimings, &reduceTimings, &barsTimings, &interpolateTimings, &packTimings, &renderTimings, &totalTimings }) {
+		std::cout << " | " << timings->name << " "
+			<< timings->percentile(0.50) << "/" << timings->percentile(0.99) << "/" << timings->max();
+	}
+
+	double framesPerSecond = iterations / benchmarkSeconds;
+	double megaPixelsPerSecond = framesPerSecond * resolution.dimensions.width * resolution.dimensions.height / 1e6;
+	std::cout << " | " << framesPerSecond << " fps, " << megaPixelsPerSecond << " MP/s";
+
+	uint64_t skippedZones = zoneManager.getSkippedZoneCount() - skippedZonesBefore;
+	uint64_t zones = zoneManager.getSkippedZoneCount() + zoneManager.getCalculatedZoneCount() - zonesBefore;
+	std::cout << " | skipped " << (zones > 0 ? 100.0 * skippedZones / zones : 0.0) << "% zones, "
+		<< 100.0 * skippedRenderCount / iterations << "% renders" << std::endl;
+}
+
+/// <summary>
+/// Compares the sums of every supported SumKernels with the scalar reference, on every start and end column of short segments
+/// and on whole 8K rows (with noise and with only 255, the worst case for the accumulators). Also measures the throughput of the kernels.
+/// </summary>
+/// <returns>If all kernels gave the exact same sums</returns>
+bool verifySumKernels() {
+	using Clock = std::chrono::steady_clock;
+
+	const int rowWidth = 7680;
+	cv::Mat noiseRow(1, rowWidth * 3, CV_8UC1);
+	cv::randu(noiseRow, cv::Scalar::all(0), cv::Scalar::all(256));
+	cv::Mat fullRow(1, rowWidth * 3, CV_8UC1, cv::Scalar::all(255));
+
+	const SumKernels& reference = getReferenceSumKernels();
+	const SumKernels& selected = getSumKernels();
+	bool allExact = true;
+
+	std::cout << "Verifying the sum kernels against the " << reference.name << " reference, selected: " << selected.name << std::endl;
+	for (const SumKernels* kernels : getSupportedSumKernels()) {
+		uint64_t mismatchCount = 0;
+		uint64_t checkCount = 0;
+
+		auto check = [&](RowSumFunction function, RowSumFunction referenceFunction, const uchar* row, int x0, int x1) {
+			uint32_t sums[3];
+			uint32_t referenceSums[3];
+			function(row, x0, x1, sums);
+			referenceFunction(row, x0, x1, referenceSums);
+
+			checkCount++;
+			if (sums[0] != referenceSums[0] || sums[1] != referenceSums[1] || sums[2] != referenceSums[2]) {
+				if (mismatchCount++ == 0) {
+					std::cout << "  " << kernels->name << " first mismatch at columns " << x0 << " - " << x1 << std::endl;
+				}
+			}
+		};
+
+		for (const cv::Mat* row : { &noiseRow, &fullRow }) {
+			const uchar* data = row->ptr<uchar>(0);
+			for (int x0 = 0; x0 < 64; x0++) {
+				for (int x1 = x0 + 1; x1 <= x0 + 400; x1++) {
+					check(kernels->sumBGR, reference.sumBGR, data, x0, x1);
+					check(kernels->sumYUYV, reference.sumYUYV, data, x0, x1);
+				}
+			}
+			for (int x0 : { 0, 1, 7 }) {
+				check(kernels->sumBGR, reference.sumBGR, data, x0, rowWidth);
+				check(kernels->sumYUYV, reference.sumYUYV, data, x0, rowWidth);
+				check(kernels->sumYUYV, reference.sumYUYV, data, x0, rowWidth - 1);
+			}
+		}
+
+		// The weighted kernels, with the biggest weights they get
+		std::vector<uint16_t> weights(rowWidth * 3);
+		for (size_t i = 0; i < weights.size(); i++) weights[i] = (uint16_t)((i * 37) % 511);
+		std::vector<uint32_t> profile(rowWidth * 3), referenceProfile(rowWidth * 3);
+		for (const cv::Mat* row : { &noiseRow, &fullRow }) {
+			const uchar* data = row->ptr<uchar>(0);
+			for (int offset = 0; offset < 8; offset++) {
+				for (int count = 0; count <= 400; count++) {
+					for (int channelCount = 1; channelCount <= 4; channelCount++) {
+						uint32_t sums[4] = { 0, 0, 0, 0 }, referenceSums[4] = { 0, 0, 0, 0 };
+						kernels->sumWeighted(data + offset, weights.data() + offset, count, channelCount, sums);
+						reference.sumWeighted(data + offset, weights.data() + offset, count, channelCount, referenceSums);
+
+						checkCount++;
+						if (!std::equal(sums, sums + 4, referenceSums) && mismatchCount++ == 0) {
+							std::cout << "  " << kernels->name << " first weighted sum mismatch at " << count << " bytes" << std::endl;
+						}
+					}
+
+					const uint32_t firstWeight = (count * 7) % 256;
+					const uint32_t secondWeight = 255 - offset;
+					std::fill(profile.begin(), profile.end(), 1);
+					std::fill(referenceProfile.begin(), referenceProfile.end(), 1);
+					kernels->accumulateWeighted(data + offset, data + 512, count, firstWeight, secondWeight, profile.data() + offset);
+					reference.accumulateWeighted(data + offset, data + 512, count, firstWeight, secondWeight, referenceProfile.data() + offset);
+
+					checkCount++;
+					if (profile != referenceProfile && mismatchCount++ == 0) {
+						std::cout << "  " << kernels->name << " first weighted accumulate mismatch at " << count << " bytes" << std::endl;
+					}
+				}
+			}
+		}
+
+		// Throughput on the rows of a 4K frame
+		const int rowCount = 2160;
+		const int width = 3840;
+		uint32_t sums[3];
+
+		auto start = Clock::now();
+		for (int y = 0; y < rowCount; y++) {
+			kernels->sumBGR(noiseRow.ptr<uchar>(0), 0, width, sums);
+		}
+		auto bgrDone = Clock::now();
+		for (int y = 0; y < rowCount; y++) {
+			kernels->sumYUYV(noiseRow.ptr<uchar>(0), 0, width, sums);
+		}
+		auto yuyvDone = Clock::now();
+
+		double pixels = (double)rowCount * width;
+		std::cout << std::fixed << std::setprecision(1) << "  " << std::left << std::setw(7) << kernels->name << std::right
+			<< (mismatchCount == 0 ? "exact" : "MISMATCH") << " (" << mismatchCount << "/" << checkCount << " mismatches)"
+			<< " | BGR " << pixels / std::chrono::duration<double, std::micro>(bgrDone - start).count() << " MP/s"
+			<< " | YUYV " << pixels / std::chrono::duration<double, std::micro>(yuyvDone - bgrDone).count() << " MP/s" << std::endl;
+
+		allExact &= (mismatchCount == 0);
+	}
+
+	return allExact;
+}
+
+/// <summary>
+/// Renders to layouts of MockLedSinks: checks that every output gets the leds of its segments and measures the render rate.
+/// </summary>
+/// <returns>If every output of every layout got the right leds</returns>
+bool verifyLedOutputs(int iterations) {
+	using Clock = std::chrono::steady_clock;
+
+	struct Layout {
+		const char* name;
+		std::vector<LedChannel> channels;
+		std::vector<LedSegment> segments;
+	};
+
+	// 360 leds (a wall-sized display), as one strip, two strips from the middle and one strip per side
+	const unsigned int ledCount = 360;
+	const std::vector<Layout> layouts = {
+		{ "1 strip", { { LedSinkType::MOCK } }, { { 0, 0, 360 } } },
+		{ "2 strips", { { LedSinkType::MOCK }, { LedSinkType::MOCK } }, { { 0, 180, 180 }, { 1, 0, 180, true } } },
+		{ "4 strips", { { LedSinkType::MOCK }, { LedSinkType::MOCK }, { LedSinkType::MOCK }, { LedSinkType::MOCK } },
+			{ { 0, 0, 90 }, { 1, 90, 90, true }, { 2, 180, 90 }, { 3, 270, 90, true } } }
+	};
+
+	std::vector<uint32_t> ledColors(ledCount);
+	for (unsigned int i = 0; i < ledCount; i++) ledColors[i] = i; // <- Every led gets its own index as color
+
+	bool allMapped = true;
+	std::cout << "Rendering " << ledCount << " leds to mock WS281x outputs" << std::endl;
+	for (const Layout& layout : layouts) {
+		std::unique_ptr<LedSink> sink = createLedOutput(layout.channels, layout.segments, ledCount);
+		if (!sink || !sink->init()) return false;
+		MultiLedSink& multiLedSink = static_cast<MultiLedSink&>(*sink);
+
+		// Mapping, every output should have the leds of its segment in order
+		sink->render(ledColors);
+		bool mapped = (multiLedSink.getOutputCount() == layout.segments.size());
+		for (size_t o = 0; o < multiLedSink.getOutputCount() && mapped; o++) {
+			const LedSegment& segment = layout.segments[o];
+			const std::vector<uint32_t>& received = static_cast<MockLedSink&>(multiLedSink.getOutput(o)).getLedColors();
+
+			mapped &= (received.size() == segment.ledCount);
+			for (unsigned int i = 0; i < segment.ledCount && mapped; i++) {
+				mapped &= (received[i] == (segment.reversed ? segment.firstLed + segment.ledCount - 1 - i : segment.firstLed + i));
+			}
+		}
+
+		// Timing
+		auto start = Clock::now();
+		for (int i = 0; i < iterations; i++) {
+			sink->render(ledColors);
+		}
+		sink->fini(); // <- Waits for the last transfer
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		std::cout << std::fixed << std::setprecision(1) << "  " << std::left << std::setw(9) << layout.name << std::right
+			<< (mapped ? "mapped" : "WRONG MAPPING") << " | " << iterations / seconds << " Hz" << std::endl;
+
+		allMapped &= mapped;
+	}
+
+	return allMapped;
+}
+
+/// <summary>
+/// Switches one ZoneManager between input resolutions (and black bars) like a HDMI source switch, with the weighted and the flat zones.
+/// Checks every layout: the zones of a side cover its edge of the content rect exactly and the averages are the same as of a fresh ZoneManager.
+/// Also measures the first frame after a switch, to a layout that has to be build and to one that is cached.
+/// </summary>
+/// <returns>If every layout is right</returns>
+bool verifyZoneGeometry() {
+	using Clock = std::chrono::steady_clock;
+
+	struct Layout {
+		Dimensions dimensions;
+		cv::Rect contentRect; // <- Empty is the whole frame
+	};
+	const std::vector<Layout> layouts = {
+		{ { 1920, 1080 }, cv::Rect() },
+		{ { 3840, 2160 }, cv::Rect() },
+		{ { 1280, 720 }, cv::Rect() },
+		{ { 1920, 1080 }, cv::Rect(0, 140, 1920, 800) }, // <- 2.40:1 movie
+		{ { 1366, 768 }, cv::Rect() } // <- Doesn't divide by the led counts
+	};
+	const LEDCounts& LEDCounts = Config::LED_COUNTS;
+
+	bool allRight = true;
+	std::cout << "Switching between " << layouts.size() << " layouts, twice" << std::endl;
+	for (bool flatZones : { false, true }) {
+		ZoneManager zoneManager(LEDCounts);
+		if (flatZones) zoneManager.setSamplingKernel(SamplingKernel());
+		zoneManager.setChangeDetection(false); // <- Every frame is averaged completely, so the frames can be compared
+
+		for (int pass = 0; pass < 2; pass++) {
+			for (const Layout& layout : layouts) {
+				Frame frame = generateFrames(layout.dimensions, InputFormat::BGR, 1)[0];
+				frame.contentRect = layout.contentRect;
+
+				// The cost of the switch is the first frame minus a frame after it
+				auto start = Clock::now();
+				zoneManager.calculateAverages(frame);
+				auto switchedTime = Clock::now();
+				zoneManager.calculateAverages(frame);
+				double switchUS = std::chrono::duration<double, std::micro>((switchedTime - start) - (Clock::now() - switchedTime)).count();
+
+				// The zones of every side, added up, are as long as the content and don't leave it
+				const cv::Rect content = layout.contentRect.empty() ? cv::Rect(0, 0, layout.dimensions.width, layout.dimensions.height) : layout.contentRect;
+				const ZoneTable& zones = zoneManager.getZoneTable();
+				int sideLengths[4] = {};
+				bool right = true;
+				for (size_t i = 0; i < zones.size(); i++) {
+					const cv::Rect& rect = zones.rects[i];
+					const bool horizontal = (zones.slots[i].side == ZoneSide::TOP || zones.slots[i].side == ZoneSide::BOTTOM);
+					sideLengths[(int)zones.slots[i].side] += horizontal ? rect.width : rect.height;
+					right &= ((rect & content) == rect && !rect.empty());
+				}
+				right &= (sideLengths[(int)ZoneSide::TOP] == (LEDCounts.top ? content.width : 0) && sideLengths[(int)ZoneSide::BOTTOM] == (LEDCounts.bottom ? content.width : 0));
+				right &= (sideLengths[(int)ZoneSide::LEFT] == (LEDCounts.left ? content.height : 0) && sideLengths[(int)ZoneSide::RIGHT] == (LEDCounts.right ? content.height : 0));
+
+				// The same averages as a layout that is build for this frame only
+				ZoneManager freshZoneManager(LEDCounts);
+				if (flatZones) freshZoneManager.setSamplingKernel(SamplingKernel());
+				freshZoneManager.setChangeDetection(false);
+				freshZoneManager.calculateAverages(frame);
+				right &= (freshZoneManager.getZoneTable().colors == zones.colors && freshZoneManager.getZoneTable().rects == zones.rects);
+
+				std::cout << std::fixed << std::setprecision(1) << "  " << (flatZones ? "flat     " : "weighted ") << std::setw(4) << layout.dimensions.width << "x"
+					<< std::left << std::setw(4) << layout.dimensions.height << std::right << (layout.contentRect.empty() ? "      " : " bars ")
+					<< (right ? "right" : "WRONG") << " | switch to " << (pass == 0 ? "new layout " : "cached one ") << switchUS << " us" << std::endl;
+				allRight &= right;
+			}
+		}
+	}
+
+	return allRight;
+}
+
+/// <summary>
+/// Checks the ChangeDetector on a slow fade: every byte of the frame ramps up by 1 level per frame, less than the threshold.
+/// The zone has to be marked dirty once the ramp adds up to more than the threshold, long before the forced refresh, for every pixel format.
+/// Also checks that a NV12 frame that only changes its hue (the UV plane, not the Y plane) is marked dirty on the next frame.
+/// </summary>
+/// <returns>If every change is detected in time</returns>
+bool verifyChangeDetection() {
+	const Dimensions dimensions = { 320, 180 };
+	const std::vector<cv::Rect> zoneRects = { cv::Rect(0, 0, 64, 36), cv::Rect(64, 0, 64, 36) };
+	const int threshold = 2;
+	const int refreshInterval = 30;
+
+	bool allRight = true;
+	std::cout << "Ramping " << zoneRects.size() << " zones by 1 level per frame, threshold " << threshold << ", refresh every " << refreshInterval << " frames" << std::endl;
+	for (InputFormat format : { InputFormat::BGR, InputFormat::YUYV, InputFormat::NV12 }) {
+		Frame frame = generateFrames(dimensions, format, 1)[0];
+		frame.image.setTo(cv::Scalar::all(100));
+
+		ChangeDetector changeDetector;
+		changeDetector.setThreshold(threshold);
+		changeDetector.setRefreshInterval(refreshInterval);
+		changeDetector.build(zoneRects, dimensions);
+
+		std::vector<uint8_t> dirtyZones;
+		changeDetector.detect(frame.image, frame.format, dirtyZones); // <- The first frame is a refresh
+
+		// Dirty on the frame the ramp is more than the threshold since the last dirty frame, and only then
+		std::vector<int> dirtyFrames;
+		for (int i = 1; i < refreshInterval; i++) {
+			frame.image += cv::Scalar::all(1);
+			changeDetector.detect(frame.image, frame.format, dirtyZones);
+			if (dirtyZones[0] && dirtyZones[1]) dirtyFrames.push_back(i);
+		}
+		bool right = !dirtyFrames.empty() && dirtyFrames[0] == threshold + 1;
+		for (size_t i = 1; i < dirtyFrames.size(); i++) right &= (dirtyFrames[i] - dirtyFrames[i - 1] == threshold + 1);
+
+		std::cout << "  " << std::left << std::setw(6) << getInputFormatName(format) << std::right << (right ? "right" : "WRONG")
+			<< " | dirty on " << dirtyFrames.size() << " of " << refreshInterval - 1 << " frames, first on frame " << (dirtyFrames.empty() ? -1 : dirtyFrames[0]) << std::endl;
+		allRight &= right;
+
+		if (format == InputFormat::NV12) {
+			// The same luma, an other hue
+			cv::Mat uvPlane = frame.image.rowRange(dimensions.height, frame.image.rows);
+			uvPlane += cv::Scalar::all(40);
+			changeDetector.detect(frame.image, frame.format, dirtyZones);
+			right = dirtyZones[0] && dirtyZones[1];
+
+			std::cout << "  NV12 hue only " << (right ? "right" : "WRONG") << std::endl;
+			allRight &= right;
+		}
+	}
+
+	return allRight;
+}
+
+/// <summary>
+/// Generates frames of flat blocks (with a little noise), shifted to the right by the given amount of pixels per frame.
+/// The bytes of a block are the same in every pixel format, so every block falls in one bin of the dominant color histogram.
+/// </summary>
+std::vector<Frame> generateBlockFrames(Dimensions dimensions, InputFormat format, const std::vector<int>& shifts) {
+	const int blockSize = 96;
+
+	std::vector<Frame> frames = generateFrames(dimensions, format, 1);
+	const Frame noise = frames[0];
+	frames.clear();
+
+	for (int shift : shifts) {
+		Frame frame = noise;
+		frame.image = noise.image.clone();
+
+		const int channels = frame.image.channels();
+		for (int y = 0; y < frame.image.rows; y++) {
+			uchar* row = frame.image.ptr<uchar>(y);
+			for (int x = 0; x < frame.image.cols * channels; x++) {
+				const uint32_t block = (uint32_t)((x / channels + shift) / blockSize + (y / blockSize) * 1000) * 2654435761u;
+				row[x] = (uchar)(((block >> (8 * (x % channels))) & 0xF0) | (row[x] & 0x3));
+			}
+		}
+
+		frames.push_back(frame);
+	}
+
+	return frames;
+}
+
+/// <summary>
+/// Checks the dominant color mode and measures it against the average, at 1080p with the leds of the config.
+/// A zone of grey with a smaller saturated part gets the saturated color, and updating the histograms incrementally
+/// gives the exact same colors as counting every frame from scratch, in every pixel format.
+/// Also measures the zones of both modes, moving (the blocks shift every frame) and paused (the same frame, change detection skips the zones).
+/// </summary>
+/// <returns>If the dominant colors are right</returns>
+bool verifyDominantColor(int iterations) {
+	using Clock = std::chrono::steady_clock;
+
+	const Dimensions dimensions = { 1920, 1080 };
+	const LEDCounts& LEDCounts = Config::LED_COUNTS;
+	bool allRight = true;
+
+	// Grey with red stripes over 40% of the top zones
+	{
+		cv::Mat image(dimensions.height, dimensions.width, CV_8UC3);
+		cv::randu(image, cv::Scalar::all(96), cv::Scalar::all(112));
+		for (int y = 0; y < dimensions.height / 4; y++) {
+			for (int x = 0; x < dimensions.width; x++) {
+				if (x % 10 < 4) image.at<cv::Vec3b>(y, x) = cv::Vec3b(30, 30, 220);
+			}
+		}
+
+		ZoneManager dominantZoneManager(LEDCounts, dimensions);
+		dominantZoneManager.setColorMode(ZoneColorMode::DOMINANT);
+		dominantZoneManager.calculateAverages(image);
+		ZoneManager averageZoneManager(LEDCounts, dimensions);
+		averageZoneManager.calculateAverages(image);
+
+		bool right = true;
+		const ZoneTable& zones = dominantZoneManager.getZoneTable();
+		for (size_t i = 0; i < zones.size(); i++) {
+			if (zones.slots[i].side != ZoneSide::TOP) continue;
+			const cv::Vec3b& color = zones.colors[i];
+			right &= (std::abs(color[0] - 30) <= 1 && std::abs(color[1] - 30) <= 1 && std::abs(color[2] - 220) <= 1);
+		}
+
+		const size_t firstTopZone = std::find_if(zones.slots.begin(), zones.slots.end(), [](const ZoneSlot& slot) { return slot.side == ZoneSide::TOP; }) - zones.slots.begin();
+		const cv::Vec3b average = averageZoneManager.getZoneTable().colors[firstTopZone];
+		std::cout << "Grey zone with 40% red: dominant " << (right ? "red" : "WRONG") << ", average (" << (int)average[0] << ", " << (int)average[1] << ", " << (int)average[2] << ")" << std::endl;
+		allRight &= right;
+	}
+
+	std::cout << "Dominant colors at " << dimensions.width << "x" << dimensions.height << " with " << LEDCounts.all() << " leds, zones p50 in microseconds" << std::endl;
+	for (InputFormat format : { InputFormat::BGR, InputFormat::YUYV, InputFormat::NV12 }) {
+		// Standing still, a few pixels, a lot and back
+		const std::vector<Frame> frames = generateBlockFrames(dimensions, format, { 0, 0, 8, 16, 16, 400, 408, 0 });
+
+		ZoneManager incrementalZoneManager(LEDCounts, dimensions);
+		incrementalZoneManager.setColorMode(ZoneColorMode::DOMINANT);
+		incrementalZoneManager.setChangeDetection(false); // <- Every zone is updated, so the colors can be compared
+		int dominantZoneCount = 0;
+		bool equal = true;
+		for (const Frame& frame : frames) {
+			incrementalZoneManager.calculateAverages(frame);
+
+			ZoneManager freshZoneManager(LEDCounts, dimensions);
+			freshZoneManager.setColorMode(ZoneColorMode::DOMINANT);
+			freshZoneManager.setChangeDetection(false);
+			freshZoneManager.calculateAverages(frame);
+			equal &= (freshZoneManager.getZoneTable().colors == incrementalZoneManager.getZoneTable().colors);
+
+			// The zones that didn't fall back to the average
+			ZoneManager averageZoneManager(LEDCounts, dimensions);
+			averageZoneManager.setSamplingKernel(SamplingKernel());
+			averageZoneManager.setChangeDetection(false);
+			averageZoneManager.calculateAverages(frame);
+			for (size_t i = 0; i < averageZoneManager.getZoneTable().size(); i++) {
+				dominantZoneCount += (averageZoneManager.getZoneTable().colors[i] != freshZoneManager.getZoneTable().colors[i]);
+			}
+		}
+
+		std::cout << "  " << std::left << std::setw(5) << getInputFormatName(format) << std::right << (equal ? "equal" : "DIFFERENT") << " ("
+			<< dominantZoneCount << " of " << frames.size() * LEDCounts.all() << " zones dominant)";
+
+		// Moving and paused, for the weighted average, the flat average and the dominant color
+		const std::vector<Frame> movingFrames = generateBlockFrames(dimensions, format, { 0, 24, 48, 72 });
+		for (int mode = 0; mode < 3; mode++) {
+			for (bool paused : { false, true }) {
+				ZoneManager zoneManager(LEDCounts, dimensions);
+				if (mode == 1) zoneManager.setSamplingKernel(SamplingKernel());
+				if (mode == 2) zoneManager.setColorMode(ZoneColorMode::DOMINANT);
+
+				StageTimings timings = { "zones" };
+				for (int i = -3; i < iterations; i++) {
+					const Frame& frame = paused ? movingFrames[0] : movingFrames[(i + 3) % movingFrames.size()];
+
+					auto start = Clock::now();
+					zoneManager.calculateAverages(frame);
+					if (i >= 0) timings.add(Clock::now() - start); // <- The first frames are the warm-up
+				}
+
+				std::cout << std::fixed << std::setprecision(0) << " | " << (mode == 0 ? "weighted " : mode == 1 ? "flat " : "dominant ")
+					<< (paused ? "paused " : "moving ") << timings.percentile(0.5);
+			}
+		}
+		std::cout << std::endl;
+
+		allRight &= equal;
+	}
+
+	return allRight;
+}
+
+/// <summary>
+/// Widens a 8 bit frame to the 16 bit format with the same layout: every sample in the high byte,
+/// with noise in the 6 bits below the 10 bits of a P010 sample (they have to be ignored).
+/// </summary>
+Frame widenFrame(const Frame& frame) {
+	Frame wideFrame;
+	switch (frame.format) {
+	case PixelFormat::BGR: wideFrame.format = PixelFormat::BGR16; break;
+	case PixelFormat::YUYV: wideFrame.format = PixelFormat::Y210; break;
+	default: wideFrame.format = PixelFormat::P010; break;
+	}
+	wideFrame.image.create(frame.image.rows, frame.image.cols, CV_MAKETYPE(CV_16U, frame.image.channels()));
+
+	const int sampleCount = frame.image.cols * frame.image.channels();
+	for (int y = 0; y < frame.image.rows; y++) {
+		const uchar* row = frame.image.ptr<uchar>(y);
+		uint16_t* wideRow = wideFrame.image.ptr<uint16_t>(y);
+		for (int x = 0; x < sampleCount; x++) {
+			wideRow[x] = (uint16_t)((row[x] << 8) | ((x * 7 + y * 13) & 0x3F));
+		}
+	}
+
+	return wideFrame;
+}
+
+/// <summary>
+/// Checks the 16 bit formats and measures them against the 8 bit ones, at 1080p with the leds of the config.
+/// A SDR source captured in a 16 bit format has to give the exact same zone colors as the 8 bit format (flat, weighted and dominant zones).
+/// Prints the led value of a grey of PQ and HLG from black to the peak (it has to rise), and checks that a saturated PQ color keeps its hue.
+/// </summary>
+/// <returns>If the 16 bit zones are right</returns>
+bool verifyHighBitDepth(int iterations) {
+	using Clock = std::chrono::steady_clock;
+
+	const Dimensions dimensions = { 1920, 1080 };
+	const LEDCounts& LEDCounts = Config::LED_COUNTS;
+	const ToneMappingSettings sdr = { .transferFunction = TransferFunction::SDR };
+	bool allRight = true;
+
+	std::cout << "16 bit formats of a SDR source against the 8 bit formats, at " << dimensions.width << "x" << dimensions.height << " with " << LEDCounts.all() << " leds" << std::endl;
+	for (InputFormat format : { InputFormat::BGR, InputFormat::YUYV, InputFormat::NV12 }) {
+		const std::vector<Frame> frames = generateFrames(dimensions, format, 3);
+		std::vector<Frame> wideFrames;
+		for (const Frame& frame : frames) wideFrames.push_back(widenFrame(frame));
+
+		std::cout << "  " << std::left << std::setw(5) << getInputFormatName(format) << std::right;
+		for (int mode = 0; mode < 3; mode++) {
+			ZoneManager zoneManager(LEDCounts, dimensions);
+			ZoneManager wideZoneManager(LEDCounts, dimensions);
+			wideZoneManager.setToneMapping(sdr);
+			if (mode == 1) {
+				zoneManager.setSamplingKernel(SamplingKernel());
+				wideZoneManager.setSamplingKernel(SamplingKernel());
+			}
+			if (mode == 2) {
+				zoneManager.setColorMode(ZoneColorMode::DOMINANT);
+				wideZoneManager.setColorMode(ZoneColorMode::DOMINANT);
+			}
+
+			bool equal = true;
+			for (size_t i = 0; i < frames.size(); i++) {
+				zoneManager.calculateAverages(frames[i]);
+				wideZoneManager.calculateAverages(wideFrames[i]);
+				equal &= (zoneManager.getZoneTable().colors == wideZoneManager.getZoneTable().colors);
+			}
+
+			std::cout << " | " << (mode == 0 ? "weighted " : mode == 1 ? "flat " : "dominant ") << (equal ? "equal" : "DIFFERENT");
+			allRight &= equal;
+		}
+		std::cout << std::endl;
+	}
+
+	// The 10 bit code of a PQ signal of the given nits (the inverse of the EOTF)
+	auto pqCode = [](double nits) {
+		const double m1 = 2610.0 / 16384.0, m2 = 2523.0 / 4096.0 * 128.0;
+		const double c1 = 3424.0 / 4096.0, c2 = 2413.0 / 4096.0 * 32.0, c3 = 2392.0 / 4096.0 * 32.0;
+		const double power = std::pow(nits / 10000.0, m1);
+		return (float)(1023.0 * std::pow((c1 + c2 * power) / (1.0 + c3 * power), m2));
+	};
+
+	std::cout << "Tone curve (" << Config::TONE_MAPPING.peakNits << " nits peak, " << Config::TONE_MAPPING.whiteNits << " nits white), led value of a grey" << std::endl;
+	{
+		ToneMappingSettings settings = Config::TONE_MAPPING;
+		settings.transferFunction = TransferFunction::PQ;
+		const ToneMapper pq(settings);
+		settings.transferFunction = TransferFunction::HLG;
+		const ToneMapper hlg(settings);
+
+		bool rising = true;
+		int previous = -1;
+		std::cout << "  PQ  nits";
+		for (double nits : { 0.0, 1.0, 10.0, 50.0, 100.0, 203.0, 400.0, 1000.0, 4000.0 }) {
+			const float code = pqCode(nits);
+			const float codes[3] = { code, code, code };
+			const int value = pq.map(codes, false)[1];
+			std::cout << " | " << nits << ": " << value;
+			rising &= (value >= previous);
+			previous = value;
+		}
+		std::cout << std::endl;
+
+		previous = -1;
+		std::cout << "  HLG signal";
+		for (double signal : { 0.0, 0.1, 0.25, 0.5, 0.75, 0.9, 1.0 }) {
+			const float code = (float)(1023.0 * signal);
+			const float codes[3] = { code, code, code };
+			const int value = hlg.map(codes, false)[1];
+			std::cout << " | " << signal << ": " << value;
+			rising &= (value >= previous);
+			previous = value;
+		}
+		std::cout << std::endl;
+
+		// A bright red of 1000 nits stays red, the roll-off doesn't make it white
+		const float redCodes[3] = { 0.0f, 0.0f, pqCode(1000.0) };
+		const cv::Vec3b red = pq.map(redCodes, false);
+		const bool hueKept = (red[2] == 255 && red[1] == 0);
+		std::cout << "  PQ peak red: (" << (int)red[0] << ", " << (int)red[1] << ", " << (int)red[2] << ") " << (hueKept ? "red" : "WRONG")
+			<< ", curve " << (rising ? "rising" : "NOT RISING") << std::endl;
+		allRight &= rising && hueKept;
+	}
+
+	// Moving frames, the 16 bit ones tone mapped with the config
+	std::cout << "Zones p50 in microseconds, 8 bit against 16 bit (" << (getToneMapper().isHDR() ? "tone mapped" : "SDR") << ")" << std::endl;
+	for (InputFormat format : { InputFormat::BGR, InputFormat::YUYV, InputFormat::NV12 }) {
+		const std::vector<Frame> frames = generateFrames(dimensions, format, 4);
+		std::vector<Frame> wideFrames;
+		for (const Frame& frame : frames) wideFrames.push_back(widenFrame(frame));
+
+		std::cout << "  " << std::left << std::setw(5) << getInputFormatName(format) << std::right;
+		for (int mode = 0; mode < 2; mode++) {
+			for (bool wide : { false, true }) {
+				ZoneManager zoneManager(LEDCounts, dimensions);
+				if (mode == 1) zoneManager.setSamplingKernel(SamplingKernel());
+
+				StageTimings timings = { "zones" };
+				for (int i = -3; i < iterations; i++) {
+					const Frame& frame = (wide ? wideFrames : frames)[(i + 3) % frames.size()];
+
+					auto start = Clock::now();
+					zoneManager.calculateAverages(frame);
+					if (i >= 0) timings.add(Clock::now() - start); // <- The first frames are the warm-up
+				}
+
+				std::cout << std::fixed << std::setprecision(0) << " | " << (mode == 0 ? "weighted " : "flat ")
+					<< (wide ? "16 bit " : "8 bit ") << timings.percentile(0.5);
+			}
+		}
+		std::cout << std::defaultfloat << std::endl;
+	}
+
+	return allRight;
+}
+
+/// <summary>
+/// Measures the render jitter like cyclictest: a thread ticks at RENDER_RATE_HZ and measures how late it wakes up for every tick,
+/// as a normal task (like the render stage without REAL_TIME) and as in the real-time mode (SCHED_FIFO, memory locked, on the core of the render stage).
+/// Every core is kept busy with normal tasks that walk through memory meanwhile, like Kodi would.
+/// Without permission for SCHED_FIFO or mlockall (not root) the real-time row runs as a normal task, a warning is logged.
+/// </summary>
+/// <returns>Always true, there is nothing to check</returns>
+bool measureRenderJitter(int ticks) {
+	using Clock = std::chrono::steady_clock;
+
+	const Clock::duration period = std::chrono::nanoseconds(1000000000LL / std::max(1, Config::RENDER_RATE_HZ));
+	const int coreCount = (int)std::max(1u, std::thread::hardware_concurrency());
+
+	std::atomic<bool> loading = true;
+	std::vector<std::thread> loadThreads;
+	for (int i = 0; i < coreCount; i++) {
+		loadThreads.emplace_back([&loading] {
+			std::vector<uint8_t> memory(8 * 1024 * 1024);
+			size_t index = 0;
+			while (loading.load(std::memory_order_relaxed)) {
+				memory[index]++;
+				index = (index + 4096 + 64) % memory.size();
+			}
+		});
+	}
+
+	std::cout << "Render jitter of " << ticks << " ticks at " << std::max(1, Config::RENDER_RATE_HZ) << " Hz, with " << coreCount
+		<< " busy normal tasks. Wake-up latency min/avg/p99/max in microseconds" << std::endl;
+	for (bool realTime : { false, true }) {
+		if (realTime) lockMemory(0);
+
+		StageTimings latencies = { "jitter" };
+		latencies.samplesUS.reserve(ticks);
+		std::thread ticker([&] {
+			if (realTime) {
+				setThreadRealTimePriority(Config::RENDER_REAL_TIME_PRIORITY);
+				prefaultStack(Config::REAL_TIME_STACK_PREFAULT_BYTES);
+			}
+
+			Clock::time_point nextTickTime = Clock::now() + period; // <- A tick to settle (the core it is pinned to)
+			for (int i = -1; i < ticks; i++) {
+				if (realTime) sleepUntil(nextTickTime);
+				else std::this_thread::sleep_until(nextTickTime);
+
+				if (i >= 0) latencies.add(Clock::now() - nextTickTime);
+				nextTickTime += period;
+			}
+		});
+		if (realTime) pinThreadToCore(ticker, Config::RENDER_CPU_CORE < coreCount ? Config::RENDER_CPU_CORE : -1);
+		ticker.join();
+
+		if (realTime) unlockMemory();
+
+		double sumUS = 0.0;
+		for (double latencyUS : latencies.samplesUS) sumUS += latencyUS;
+		const double minUS = latencies.samplesUS.empty() ? 0.0 : *std::min_element(latencies.samplesUS.begin(), latencies.samplesUS.end());
+
+		std::cout << std::fixed << std::setprecision(1) << "  " << std::left << std::setw(10) << (realTime ? "real-time" : "normal") << std::right
+			<< minUS << " / " << sumUS / std::max<size_t>(1, latencies.samplesUS.size()) << " / " << latencies.percentile(0.99) << " / " << latencies.max() << std::endl;
+	}
+
+	loading = false;
+	for (std::thread& thread : loadThreads) thread.join();
+
+	return true;
+}
+
+#ifdef __linux__
+/// <summary>
+/// Records generated frames of every pixel format as border strips, with black bars after a few frames, plays them back
+/// and checks that the zones of the replay get the exact same averages as the zones of the recorded frames. Also measures the recorder and the replay.
+/// </summary>
+/// <returns>If every replayed frame got the same averages</returns>
+bool verifyBorderRecording(const std::string& filePath) {
+	using Clock = std::chrono::steady_clock;
+
+	const Dimensions dimensions = { 1920, 1080 };
+	const int frameCount = 8;
+	const cv::Rect barsContentRect(0, 140, 1920, 800); // <- 2.40:1 movie, from frame 4 on
+
+	bool allEqual = true;
+	std::cout << "Recording " << frameCount << " frames of " << dimensions.width << "x" << dimensions.height << " as border strips to " << filePath << std::endl;
+	for (InputFormat format : { InputFormat::BGR, InputFormat::YUYV, InputFormat::NV12 }) {
+		for (bool flatZones : { false, true }) {
+			std::vector<Frame> frames = generateFrames(dimensions, format, 4);
+			std::vector<std::vector<cv::Vec3b>> recordedColors;
+
+			// Record
+			ZoneManager zoneManager(Config::LED_COUNTS, dimensions);
+			if (flatZones) zoneManager.setSamplingKernel(SamplingKernel());
+			BorderRecorder recorder(filePath);
+			if (!recorder.open(Config::LED_COUNTS)) return false;
+
+			Clock::duration recordTime = Clock::duration::zero();
+			for (int i = 0; i < frameCount; i++) {
+				Frame& frame = frames[i % frames.size()];
+				frame.timestamp = Clock::now();
+				if (i == frameCount / 2) zoneManager.setContentRect(barsContentRect);
+
+				zoneManager.calculateAverages(frame);
+				recordedColors.push_back(zoneManager.getZoneTable().colors);
+
+				auto start = Clock::now();
+				recorder.record(frame, zoneManager);
+				recordTime += Clock::now() - start;
+			}
+			const size_t recordedLength = recorder.getLength();
+			recorder.close();
+
+			// Replay
+			ReplayFrameSource replay(filePath, false);
+			if (!replay.open() || replay.getFrameCount() != frameCount) return false;
+
+			ZoneManager replayZoneManager(Config::LED_COUNTS);
+			if (flatZones) replayZoneManager.setSamplingKernel(SamplingKernel());
+
+			bool equal = true;
+			Frame frame;
+			Clock::duration replayTime = Clock::duration::zero();
+			for (int i = 0; i < frameCount; i++) {
+				auto start = Clock::now();
+				replay.read(frame);
+				replayTime += Clock::now() - start;
+
+				replayZoneManager.calculateAverages(frame);
+				equal &= (replayZoneManager.getZoneTable().colors == recordedColors[i]);
+			}
+
+			const size_t rawFrameSize = frames[0].image.total() * frames[0].image.elemSize();
+			std::cout << std::fixed << std::setprecision(1) << "  " << std::left << std::setw(5) << getInputFormatName(format)
+				<< std::setw(9) << (flatZones ? "flat" : "weighted") << std::right << (equal ? "equal" : "DIFFERENT")
+				<< " | " << recordedLength / frameCount / 1024 << " KB per frame (raw " << rawFrameSize / 1024 << " KB)"
+				<< " | record " << std::chrono::duration<double, std::micro>(recordTime).count() / frameCount << " us"
+				<< " | replay " << std::chrono::duration<double, std::micro>(replayTime).count() / frameCount << " us" << std::endl;
+
+			allEqual &= equal;
+		}
+	}
+
+	return allEqual;
+}
+
+/// <summary>
+/// Plays back a border recording as fast as possible through the analysis (zone averages and led colors) and measures it.
+/// The checksum covers the averages of every frame, so two builds (or two runs) can be compared.
+/// </summary>
+/// <returns>If the recording could be played back</returns>
+bool runReplay(const std::string& filePath) {
+	using Clock = std::chrono::steady_clock;
+
+	ReplayFrameSource replay(filePath, false);
+	if (!replay.open()) return false;
+
+	ZoneManager zoneManager(Config::LED_COUNTS);
+	std::vector<cv::Vec3b> colors;
+	Frame frame;
+
+	StageTimings readTimings = { "read" };
+	StageTimings reduceTimings = { "reduce" };
+	uint64_t checksum = 14695981039346656037ULL; // <- FNV-1a
+	for (size_t i = 0; i < replay.getFrameCount(); i++) {
+		auto start = Clock::now();
+		replay.read(frame);
+		auto read = Clock::now();
+		zoneManager.calculateAverages(frame);
+		getLedColors(colors, zoneManager);
+		auto reduced = Clock::now();
+
+		readTimings.add(read - start);
+		reduceTimings.add(reduced - read);
+		for (const cv::Vec3b& color : colors) {
+			for (int c = 0; c < 3; c++) checksum = (checksum ^ color[c]) * 1099511628211ULL;
+		}
+	}
+
+	std::cout << std::fixed << std::setprecision(1) << replay.getFrameCount() << " frames of " << frame.getDimensions().width << "x" << frame.getDimensions().height;
+	for (StageTimings* timings : { &readTimings, &reduceTimings }) {
+		std::cout << " | " << timings->name << " " << timings->percentile(0.50) << "/" << timings->percentile(0.99) << "/" << timings->max();
+	}
+	std::cout << " | checksum " << std::hex << checksum << std::dec << std::endl;
+	return true;
+}
+
+/// <summary>
+/// Sends frames with a DdpLedSink to a DDP receiver on the loopback: once with all leds changing every frame and once with only a few.
+/// Checks that the receiver ends up with the colors of the last frame (and black after fini), and counts the packets per frame.
+/// </summary>
+/// <returns>If the receiver got the right colors every time</returns>
+bool verifyDdpLedSink(int iterations) {
+	const unsigned int ledCount = 1000; // <- More than fit in one packet
+
+	// Receiver, writes the data of every packet in its own buffer at the offset of the packet
+	int receiverSocket = socket(AF_INET, SOCK_DGRAM, 0);
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+	int receiveBufferSize = 4 << 20;
+	setsockopt(receiverSocket, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+	timeval timeout = { 0, 50000 };
+	setsockopt(receiverSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if (bind(receiverSocket, (sockaddr*)&address, sizeof(address)) == -1 || getsockname(receiverSocket, (sockaddr*)&address, &addressLength) == -1) {
+		std::cout << "Can't open the DDP receiver on the loopback" << std::endl;
+		return false;
+	}
+
+	std::mutex receiverMutex;
+	std::vector<uint8_t> received(ledCount * 3, 0);
+	std::atomic<bool> receiving = true;
+	std::atomic<uint64_t> receivedPackets = 0;
+	std::thread receiver([&]() {
+		std::vector<uint8_t> packet(DdpLedSink::HEADER_SIZE + DdpLedSink::MAX_DATA_SIZE);
+		while (receiving) {
+			ssize_t size = recv(receiverSocket, packet.data(), packet.size(), 0);
+			if (size < (ssize_t)DdpLedSink::HEADER_SIZE) continue;
+
+			const size_t offset = ((size_t)packet[4] << 24) | ((size_t)packet[5] << 16) | ((size_t)packet[6] << 8) | packet[7];
+			const size_t length = ((size_t)packet[8] << 8) | packet[9];
+			if (offset + length > received.size() || DdpLedSink::HEADER_SIZE + length != (size_t)size) continue;
+
+			std::lock_guard<std::mutex> lock(receiverMutex);
+			std::memcpy(received.data() + offset, packet.data() + DdpLedSink::HEADER_SIZE, length);
+			receivedPackets++;
+		}
+	});
+
+	// Waits till the receiver has the given BGR colors as R, G, B, corrected (UDP on the loopback doesn't lose packets when the receive buffer is big enough)
+	auto waitForColors = [&](const std::vector<cv::Vec3b>& colors, const ColorCorrection& colorCorrection) {
+		for (int attempt = 0; attempt < 100; attempt++) {
+			{
+				std::lock_guard<std::mutex> lock(receiverMutex);
+				bool equal = true;
+				for (unsigned int i = 0; i < ledCount && equal; i++) {
+					const cv::Vec3b& color = colors[i];
+					equal = received[i * 3] == colorCorrection.getTable(2)[color[2]] && received[i * 3 + 1] == colorCorrection.getTable(1)[color[1]]
+						&& received[i * 3 + 2] == colorCorrection.getTable(0)[color[0]];
+				}
+				if (equal) return true;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		return false;
+	};
+
+	bool allEqual = true;
+	std::cout << "Sending " << ledCount << " leds to a DDP receiver on port " << ntohs(address.sin_port) << std::endl;
+	for (bool extractWhite : { false, true }) {
+		// The colors of a RGBW strip (STRIP_HAS_WHITE) on a RGB DDP channel have to arrive with their white
+		ColorCorrectionSettings settings = Config::COLOR_CORRECTION;
+		settings.extractWhite = extractWhite;
+		const ColorCorrection colorCorrection(settings);
+
+		for (bool fewChanging : { false, true }) {
+			DdpLedSink sink("127.0.0.1", ntohs(address.sin_port), false, std::chrono::seconds(10));
+			if (!sink.init()) return false;
+
+			std::vector<cv::Vec3b> colors(ledCount, cv::Vec3b(32, 32, 32));
+			std::vector<uint32_t> ledColors;
+			uint64_t startPackets = receivedPackets;
+			for (int i = 0; i < iterations; i++) {
+				auto makeColor = [&](unsigned int l) {
+					const uint32_t value = (uint32_t)(i * 7919 + l) * 2654435761u;
+					return cv::Vec3b((uchar)value, (uchar)(value >> 8), (uchar)(value >> 16)); // <- Blue, green and red all differ
+				};
+				if (fewChanging) {
+					for (unsigned int l = 0; l < 10; l++) colors[(i * 37 + l) % ledCount] = makeColor(l); // <- One zone of 10 leds
+				}
+				else {
+					for (unsigned int l = 0; l < ledCount; l++) colors[l] = makeColor(l);
+				}
+				packLedColors(colors, ledColors, colorCorrection);
+				sink.render(ledColors);
+				std::this_thread::sleep_for(std::chrono::microseconds(500)); // <- A render clock, so the sink has time to send every frame
+			}
+
+			bool equal = waitForColors(colors, colorCorrection);
+			const uint64_t packets = receivedPackets - startPackets;
+			const uint64_t sentFrames = sink.getSentFrameCount();
+
+			sink.fini();
+			equal &= waitForColors(std::vector<cv::Vec3b>(ledCount, cv::Vec3b(0, 0, 0)), ColorCorrection()); // <- Turned off
+
+			std::cout << std::fixed << std::setprecision(2) << "  " << std::left << std::setw(14) << (fewChanging ? "10 changing" : "all changing")
+				<< std::setw(12) << (extractWhite ? "RGBW colors" : "RGB colors") << std::right
+				<< (equal ? "equal" : "DIFFERENT") << " | " << sentFrames << " frames sent | " << (double)packets / std::max<uint64_t>(sentFrames, 1) << " packets per frame" << std::endl;
+			allEqual &= equal;
+		}
+	}
+
+	receiving = false;
+	receiver.join();
+	::close(receiverSocket);
+	return allEqual;
+}
+#endif
+
+int main(int argc, char** argv) {
+	int iterations = 200;
+	bool quick = false;
+	std::string recordingFilePath;
+	bool staticFrames = false;
+	bool flatZones = false;
+	int rowStride = 1;
+	bool verify = false;
+	bool outputs = false;
+	std::string bordersFilePath;
+	std::string replayFilePath;
+	bool ddp = false;
+	bool geometry = false;
+	bool changes = false;
+	bool dominant = false;
+	bool jitter = false;
+	bool hdr = false;
+
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--iterations" && i + 1 < argc) {
+			iterations = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (argument == "--quick") {
+			quick = true;
+		}
+		else if (argument == "--record" && i + 1 < argc) {
+			recordingFilePath = argv[++i];
+		}
+		else if (argument == "--static") {
+			staticFrames = true;
+		}
+		else if (argument == "--flat") {
+			flatZones = true;
+		}
+		else if (argument == "--stride" && i + 1 < argc) {
+			rowStride = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (argument == "--verify") {
+			verify = true;
+		}
+		else if (argument == "--outputs") {
+			outputs = true;
+		}
+		else if (argument == "--borders" && i + 1 < argc) {
+			bordersFilePath = argv[++i];
+		}
+		else if (argument == "--replay" && i + 1 < argc) {
+			replayFilePath = argv[++i];
+		}
+		else if (argument == "--ddp") {
+			ddp = true;
+		}
+		else if (argument == "--geometry") {
+			geometry = true;
+		}
+		else if (argument == "--changes") {
+			changes = true;
+		}
+		else if (argument == "--dominant") {
+			dominant = true;
+		}
+		else if (argument == "--jitter") {
+			jitter = true;
+		}
+		else if (argument == "--hdr") {
+			hdr = true;
+		}
+		else {
+			std::cout << "Usage: " << argv[0] << " [--iterations N] [--quick] [--record FILE] [--static] [--flat] [--stride N] [--verify] [--outputs] [--borders FILE] [--replay FILE] [--ddp] [--geometry] [--changes] [--dominant] [--jitter] [--hdr]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (verify) {
+		return verifySumKernels() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (outputs) {
+		return verifyLedOutputs(iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (geometry) {
+		return verifyZoneGeometry() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (changes) {
+		return verifyChangeDetection() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (dominant) {
+		return verifyDominantColor(iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (jitter) {
+		return measureRenderJitter(iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (hdr) {
+		return verifyHighBitDepth(iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+#ifdef __linux__
+	if (!bordersFilePath.empty()) {
+		return verifyBorderRecording(bordersFilePath) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (!replayFilePath.empty()) {
+		return runReplay(replayFilePath) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	if (ddp) {
+		return verifyDdpLedSink(iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+#endif
+
+	std::vector<Resolution> resolutions = {
+		{ "720p", { 1280, 720 } },
+		{ "1080p", { 1920, 1080 } },
+		{ "4K", { 3840, 2160 } }
+	};
+	std::vector<unsigned int> ledCounts = { Config::LED_COUNTS.all(), 100, 300, 1000 };
+
+	if (quick) {
+		resolutions.resize(2);
+		ledCounts.resize(2);
+		iterations = std::min(iterations, 20);
+	}
+
+	std::unique_ptr<LedSink> ledSink;
+	if (recordingFilePath.empty()) ledSink = std::make_unique<NullLedSink>();
+	else ledSink = std::make_unique<RecordingLedSink>(recordingFilePath);
+
+	if (!ledSink->init()) return EXIT_FAILURE;
+
+	std::cout << "Pipeline benchmark, " << iterations << " iterations per row, rendering to led sink: " << ledSink->getName() << std::endl;
+	std::cout << "Stage times are p50/p99/max in microseconds." << std::endl;
+
+	for (const Resolution& resolution : resolutions) {
+		for (InputFormat format : { InputFormat::BGR, InputFormat::YUYV, InputFormat::NV12, InputFormat::YUYV_CONVERTED }) {
+			for (unsigned int ledCount : ledCounts) {
+				runBenchmark(resolution, format, ledCount, iterations, staticFrames, flatZones, rowStride, *ledSink);
+			}
+		}
+	}
+
+	ledSink->fini();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+#include "BorderRecorder.h"
+#include "Logger.h"
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace BorderRecording;
+
+static constexpr size_t GROW_SIZE = 64 * 1024 * 1024; // <- About 30 frames of 1080p
+
+BorderRecorder::BorderRecorder(std::string filePath)
+	: m_filePath(filePath) { }
+
+BorderRecorder::~BorderRecorder() {
+	this->close();
+}
+
+/// <summary>
+/// Creates (or overwrites) the recording and writes the header.
+/// </summary>
+/// <param name="LEDCounts">The leds the zones are made for, stored so a replay can warn when they differ</param>
+/// <returns>If the recording is ready to record frames</returns>
+bool BorderRecorder::open(const LEDCounts& LEDCounts) {
+	this->close();
+
+	m_fd = ::open(m_filePath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (m_fd == -1) {
+		LOG_ERROR("Can't create border recording " << m_filePath << ": " << std::strerror(errno));
+		return false;
+	}
+
+	m_length = 0;
+	m_hasLayout = false;
+	m_recordedFrameCount = 0;
+
+	if (!this->reserve(sizeof(Header))) return false;
+
+	Header fileHeader = {};
+	std::memcpy(fileHeader.magic, MAGIC, sizeof(MAGIC));
+	fileHeader.byteOrderMark = BYTE_ORDER_MARK;
+	fileHeader.ledCounts[0] = LEDCounts.top;
+	fileHeader.ledCounts[1] = LEDCounts.bottom;
+	fileHeader.ledCounts[2] = LEDCounts.left;
+	fileHeader.ledCounts[3] = LEDCounts.right;
+
+	std::memcpy(m_mapping, &fileHeader, sizeof(Header));
+	m_length = sizeof(Header);
+	return true;
+}
+
+/// <summary>
+/// Cuts the file to the recorded length and closes it.
+/// </summary>
+void BorderRecorder::close() {
+	if (m_mapping) {
+		munmap(m_mapping, m_mappedLength);
+		m_mapping = nullptr;
+		m_mappedLength = 0;
+
+		if (ftruncate(m_fd, (off_t)m_length) == -1) {
+			LOG_WARNING("Can't cut border recording " << m_filePath << " to its length: " << std::strerror(errno));
+		}
+		LOG_INFO("Recorded " << m_recordedFrameCount << " frames (" << m_length / (1024 * 1024) << " MB) to " << m_filePath);
+	}
+
+	if (m_fd != -1) {
+		::close(m_fd);
+		m_fd = -1;
+	}
+}
+
+/// <summary>
+/// Grows the file and the mapping (in steps of GROW_SIZE) till it has room for the given length.
+/// The new part of the file is allocated on disk (not sparse), so a full disk is a error here instead of a SIGBUS while copying.
+/// </summary>
+/// <returns>If there is room, when not the recording is closed</returns>
+bool BorderRecorder::reserve(size_t length) {
+	if (length <= m_mappedLength) return true;
+
+	const size_t newLength = m_mappedLength + std::max(GROW_SIZE, length - m_mappedLength);
+
+	int result = posix_fallocate(m_fd, (off_t)m_mappedLength, (off_t)(newLength - m_mappedLength));
+	void* mapping = MAP_FAILED;
+	if (result == 0) {
+		mapping = m_mapping
+			? mremap(m_mapping, m_mappedLength, newLength, MREMAP_MAYMOVE)
+			: mmap(nullptr, newLength, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+		if (mapping == MAP_FAILED) result = errno;
+	}
+
+	if (mapping == MAP_FAILED) {
+		LOG_ERROR("Can't grow border recording " << m_filePath << ", stopped recording: " << std::strerror(result));
+		this->close();
+		return false;
+	}
+
+	m_mapping = (uint8_t*)mapping;
+	m_mappedLength = newLength;
+	return true;
+}
+
+/// <summary>
+/// Appends a record with room for a payload of the given size.
+/// </summary>
+/// <returns>Where the payload goes, nullptr when the file can't grow</returns>
+uint8_t* BorderRecorder::append(RecordType type, size_t size) {
+	const size_t recordLength = sizeof(RecordHeader) + pad(size);
+	if (!this->reserve(m_length + recordLength)) return nullptr;
+
+	uint8_t* record = m_mapping + m_length;
+	RecordHeader recordHeader = { type, (uint32_t)size };
+	std::memcpy(record, &recordHeader, sizeof(RecordHeader));
+
+	m_length += recordLength;
+	return record + sizeof(RecordHeader);
+}
+
+/// <summary>
+/// Takes over the layout of the given frame and zones when it differs from the last recorded one.
+/// </summary>
+/// <returns>If the layout changed and has to be recorded</returns>
+bool BorderRecorder::hasLayoutChanged(const Frame& frame, const ZoneManager& zoneManager) {
+	const Dimensions frameDimensions = frame.getDimensions();
+
+	Layout layout = {};
+	layout.width = frameDimensions.width;
+	layout.height = frameDimensions.height;
+	layout.pixelFormat = (uint32_t)frame.format;
+	layout.contentRect = toRect(zoneManager.getContentRect());
+
+	std::array<cv::Rect, 4> strips;
+	for (int side = 0; side < 4; side++) {
+		strips[side] = alignStrip(zoneManager.getSampledRect((ZoneSide)side), frame.format, frameDimensions);
+		layout.strips[side] = toRect(strips[side]);
+	}
+
+	if (m_hasLayout && std::memcmp(&layout, &m_layout, sizeof(Layout)) == 0) return false;
+
+	m_layout = layout;
+	m_strips = strips;
+	m_frameSize = 0;
+	for (const cv::Rect& strip : m_strips) {
+		m_frameSize += getStripSize(strip, frame.format);
+	}
+	m_hasLayout = true;
+	return true;
+}
+
+/// <summary>
+/// Appends the border strips of the frame, with the layout first when the frame or the zones changed.
+/// Must be called after the averages of the frame are calculated, so the zones are the ones the frame was sampled with.
+/// </summary>
+/// <returns>If the frame is recorded</returns>
+bool BorderRecorder::record(const Frame& frame, const ZoneManager& zoneManager) {
+	if (!m_mapping || frame.empty()) return false;
+
+	if (this->hasLayoutChanged(frame, zoneManager)) {
+		uint8_t* payload = this->append(RecordType::LAYOUT, sizeof(Layout));
+		if (!payload) return false;
+		std::memcpy(payload, &m_layout, sizeof(Layout));
+	}
+
+	uint8_t* payload = this->append(RecordType::FRAME, sizeof(int64_t) + m_frameSize);
+	if (!payload) return false;
+
+	if (m_recordedFrameCount == 0) m_firstTimestamp = frame.timestamp;
+	const int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(frame.timestamp - m_firstTimestamp).count();
+	std::memcpy(payload, &timestamp, sizeof(int64_t));
+
+	uint8_t* bytes = payload + sizeof(int64_t);
+	for (const cv::Rect& strip : m_strips) {
+		packStrip(frame, strip, bytes);
+		bytes += getStripSize(strip, frame.format);
+	}
+
+	m_recordedFrameCount++;
+	return true;
+}
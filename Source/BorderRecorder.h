@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+#include <opencv2/core.hpp>
+
+#include "BorderRecording.h"
+#include "ZoneManager.h"
+#include "Frame.h"
+
+/// <summary>
+/// Records the border strips the zones sample of every analysed frame (plus its timestamp and the zone layout) to a file,
+/// so the frames can be played back later with a ReplayFrameSource. See BorderRecording for the file layout.
+///
+/// The file is append-only and memory-mapped: a frame is copied straight into the mapping, the kernel writes it to disk in the background.
+/// The file (and the mapping) grows in big steps, so there is no syscall per frame. It is cut to the recorded length when closed.
+/// </summary>
+class BorderRecorder
+{
+public:
+	// Constructor
+	BorderRecorder(std::string filePath);
+	~BorderRecorder();
+
+	// Methods
+	bool open(const LEDCounts& LEDCounts);
+	void close();
+	bool record(const Frame& frame, const ZoneManager& zoneManager);
+
+	// Getters & setters
+	bool isOpened() const { return m_mapping != nullptr; }
+	uint64_t getRecordedFrameCount() const { return m_recordedFrameCount; }
+	size_t getLength() const { return m_length; }
+
+private:
+	// Methods
+	bool reserve(size_t length);
+	uint8_t* append(BorderRecording::RecordType type, size_t size);
+	bool hasLayoutChanged(const Frame& frame, const ZoneManager& zoneManager);
+
+	// Members
+	std::string m_filePath;
+	int m_fd = -1;
+	uint8_t* m_mapping = nullptr;
+	size_t m_mappedLength = 0;
+	size_t m_length = 0; // <- Bytes recorded, the rest of the mapping is zeros
+
+	BorderRecording::Layout m_layout = {};
+	std::array<cv::Rect, 4> m_strips; // <- Of m_layout, aligned to the pixel format
+	size_t m_frameSize = 0; // <- Bytes of the strips of a frame
+	bool m_hasLayout = false;
+
+	std::chrono::steady_clock::time_point m_firstTimestamp;
+	uint64_t m_recordedFrameCount = 0;
+};
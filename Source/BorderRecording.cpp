@@ -0,0 +1,130 @@
+#include "BorderRecording.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace BorderRecording {
+	static int getBytesPerPixel(PixelFormat format) {
+		switch (format) {
+		case PixelFormat::BGR: return 3;
+		case PixelFormat::YUYV: return 2;
+		case PixelFormat::NV12: return 1; // <- Of the Y plane
+		case PixelFormat::BGR16: return 6;
+		case PixelFormat::Y210: return 4;
+		case PixelFormat::P010: return 2; // <- Of the Y plane
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// Clips the strip to the frame and grows it to whole chroma blocks (pixel pairs for YUYV and Y210, 2x2 blocks for NV12 and P010),
+	/// so the strip holds all bytes of its pixels.
+	/// </summary>
+	cv::Rect alignStrip(const cv::Rect& strip, PixelFormat format, Dimensions frameDimensions) {
+		cv::Rect clipped = strip & cv::Rect(0, 0, frameDimensions.width, frameDimensions.height);
+		if (clipped.empty() || getLayout(format) == PixelFormat::BGR) return clipped;
+
+		int left = clipped.x & ~1;
+		int right = std::min((clipped.x + clipped.width + 1) & ~1, frameDimensions.width & ~1);
+		int top = clipped.y;
+		int bottom = clipped.y + clipped.height;
+		if (getLayout(format) == PixelFormat::NV12) {
+			top &= ~1;
+			bottom = std::min((bottom + 1) & ~1, frameDimensions.height & ~1);
+		}
+
+		return cv::Rect(left, top, std::max(right - left, 0), std::max(bottom - top, 0));
+	}
+
+	/// <summary>
+	/// The amount of bytes a (aligned) strip takes in a recording.
+	/// </summary>
+	size_t getStripSize(const cv::Rect& strip, PixelFormat format) {
+		size_t size = (size_t)strip.width * strip.height * getBytesPerPixel(format);
+		if (getLayout(format) == PixelFormat::NV12) size += size / 2; // <- The UV plane
+		return size;
+	}
+
+	/// <summary>
+	/// Copies the bytes of a (aligned) strip out of the frame, row by row. For NV12 (and P010) the rows of the Y plane come first, then those of the UV plane.
+	/// </summary>
+	/// <param name="bytes">Output, must have room for getStripSize bytes</param>
+	void packStrip(const Frame& frame, const cv::Rect& strip, uint8_t* bytes) {
+		const size_t rowSize = (size_t)strip.width * getBytesPerPixel(frame.format);
+		const size_t offset = (size_t)strip.x * getBytesPerPixel(frame.format);
+
+		for (int y = strip.y; y < strip.y + strip.height; y++) {
+			std::memcpy(bytes, frame.image.ptr<uint8_t>(y) + offset, rowSize);
+			bytes += rowSize;
+		}
+
+		if (getLayout(frame.format) == PixelFormat::NV12) {
+			const int uvStart = frame.getDimensions().height;
+			for (int y = strip.y / 2; y < (strip.y + strip.height) / 2; y++) {
+				std::memcpy(bytes, frame.image.ptr<uint8_t>(uvStart + y) + offset, rowSize);
+				bytes += rowSize;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Copies the bytes of a strip (made by packStrip) back into the frame.
+	/// </summary>
+	void unpackStrip(const uint8_t* bytes, const cv::Rect& strip, Frame& frame) {
+		const size_t rowSize = (size_t)strip.width * getBytesPerPixel(frame.format);
+		const size_t offset = (size_t)strip.x * getBytesPerPixel(frame.format);
+
+		for (int y = strip.y; y < strip.y + strip.height; y++) {
+			std::memcpy(frame.image.ptr<uint8_t>(y) + offset, bytes, rowSize);
+			bytes += rowSize;
+		}
+
+		if (getLayout(frame.format) == PixelFormat::NV12) {
+			const int uvStart = frame.getDimensions().height;
+			for (int y = strip.y / 2; y < (strip.y + strip.height) / 2; y++) {
+				std::memcpy(frame.image.ptr<uint8_t>(uvStart + y) + offset, bytes, rowSize);
+				bytes += rowSize;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Makes the whole frame black, in its own pixel format (YUV black is Y 16 with a neutral U and V of 128, in the high byte for the 16 bit formats).
+	/// </summary>
+	void fillBlack(Frame& frame) {
+		switch (frame.format) {
+		case PixelFormat::BGR:
+			frame.image.setTo(cv::Scalar::all(0));
+			break;
+		case PixelFormat::YUYV:
+			frame.image.setTo(cv::Scalar(16, 128));
+			break;
+		case PixelFormat::NV12: {
+			const int height = frame.getDimensions().height;
+			frame.image.rowRange(0, height).setTo(cv::Scalar::all(16));
+			frame.image.rowRange(height, frame.image.rows).setTo(cv::Scalar::all(128));
+			break;
+		}
+		case PixelFormat::BGR16:
+			frame.image.setTo(cv::Scalar::all(0));
+			break;
+		case PixelFormat::Y210:
+			frame.image.setTo(cv::Scalar(16 << 8, 128 << 8));
+			break;
+		case PixelFormat::P010: {
+			const int height = frame.getDimensions().height;
+			frame.image.rowRange(0, height).setTo(cv::Scalar::all(16 << 8));
+			frame.image.rowRange(height, frame.image.rows).setTo(cv::Scalar::all(128 << 8));
+			break;
+		}
+		}
+	}
+
+	Rect toRect(const cv::Rect& rect) {
+		return Rect{ rect.x, rect.y, rect.width, rect.height };
+	}
+
+	cv::Rect toRect(const Rect& rect) {
+		return cv::Rect(rect.x, rect.y, rect.width, rect.height);
+	}
+}
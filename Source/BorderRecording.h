@@ -0,0 +1,68 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+#include <opencv2/core.hpp>
+
+#include "Frame.h"
+#include "PixelFormat.h"
+
+/// <summary>
+/// The file layout of a border recording, written by the BorderRecorder and played back by the ReplayFrameSource.
+/// Only the border strips the zones sample are stored, in the pixel format of the capture card, so a replay gives the exact same averages.
+///
+/// File layout (native byte order, append-only):
+/// - Header: BorderRecording::Header, its byteOrderMark is BYTE_ORDER_MARK in the byte order of the machine that recorded it
+///   (the structs are stored as they are in memory, a recording only plays back on a machine with the same byte order)
+/// - Records, each a BorderRecording::RecordHeader followed by its payload (padded to 8 bytes):
+///   - LAYOUT: BorderRecording::Layout, written before the first frame and every time the frame or the zones change
+///   - FRAME: nanoseconds since the first frame (int64), followed by the bytes of the 4 strips of the last layout (see packStrip)
+/// - The file can end in zeros (a record of type END), it is grown in big steps while recording.
+/// </summary>
+namespace BorderRecording {
+	constexpr char MAGIC[8] = { 'B', 'R', 'D', 'R', 'R', 'E', 'C', '2' };
+	constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	enum class RecordType : uint32_t {
+		END = 0,
+		LAYOUT = 1,
+		FRAME = 2
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t byteOrderMark; // <- BYTE_ORDER_MARK
+		uint32_t reserved; // <- 0, keeps the records 8 byte aligned
+		uint32_t ledCounts[4]; // <- Top, bottom, left, right, to warn when a recording is played back with other leds
+	};
+
+	struct RecordHeader {
+		RecordType type;
+		uint32_t size; // <- Of the payload, without the padding
+	};
+
+	struct Rect {
+		int32_t x, y, width, height;
+	};
+
+	struct Layout {
+		int32_t width, height; // <- Of the frame
+		uint32_t pixelFormat; // <- PixelFormat
+		Rect contentRect; // <- The zones are laid out along its edges
+		Rect strips[4]; // <- The part of the frame the zones of a side sample, in the order of ZoneSide
+	};
+
+	static_assert(sizeof(Header) == 32 && sizeof(RecordHeader) == 8 && sizeof(Layout) == 92, "The file layout can't have padding");
+
+	constexpr size_t pad(size_t size) { return (size + 7) & ~(size_t)7; }
+
+	cv::Rect alignStrip(const cv::Rect& strip, PixelFormat format, Dimensions frameDimensions);
+	size_t getStripSize(const cv::Rect& strip, PixelFormat format);
+	void packStrip(const Frame& frame, const cv::Rect& strip, uint8_t* bytes);
+	void unpackStrip(const uint8_t* bytes, const cv::Rect& strip, Frame& frame);
+	void fillBlack(Frame& frame);
+
+	Rect toRect(const cv::Rect& rect);
+	cv::Rect toRect(const Rect& rect);
+}
@@ -0,0 +1,351 @@
+#include "BorderReducer.h"
+#include "Dimensions.h"
+
+#include <algorithm>
+
+#include <opencv2/core.hpp>
+
+/// <summary>
+/// Compiles the given zone rects into bands and segments.
+/// Rects are clipped to the frame, so a zone that is (partly) outside the frame only averages the pixels inside it.
+/// Needs to be called again when the zone rects or the frame dimensions change.
+/// The buffers are reused, so rebuilding the same amount of zones (for example with a other content rect) doesn't allocate.
+/// </summary>
+/// <param name="zoneRects">The rects of the zones, the index of a rect is the index of the zone in the averages.</param>
+/// <param name="frameDimensions">Dimensions of the frames that will be reduced</param>
+/// <param name="rowStride">Only the rows that are a multiple of this are summed, 1 sums every row</param>
+void BorderReducer::build(const std::vector<cv::Rect>& zoneRects, Dimensions frameDimensions, int rowStride) {
+	m_frameDimensions = frameDimensions;
+	m_rowStride = std::max(rowStride, 1);
+
+	m_bands.clear();
+	m_segments.clear();
+	m_segmentZones.clear();
+
+	m_sums.assign(zoneRects.size() * 3, 0);
+	m_pixelCounts.assign(zoneRects.size(), 0);
+
+	// Clip rects to the frame
+	const cv::Rect frameRect(0, 0, frameDimensions.width, frameDimensions.height);
+	std::vector<cv::Rect>& clippedRects = m_clippedRects;
+	clippedRects.clear();
+	for (const cv::Rect& rect : zoneRects) {
+		clippedRects.push_back(rect & frameRect);
+	}
+
+	// Every top and bottom edge of a rect is a place where the set of covering zones can change
+	std::vector<int>& rowBreaks = m_rowBreaks;
+	rowBreaks.clear();
+	for (const cv::Rect& rect : clippedRects) {
+		if (rect.empty()) continue;
+		rowBreaks.push_back(rect.y);
+		rowBreaks.push_back(rect.y + rect.height);
+	}
+	std::sort(rowBreaks.begin(), rowBreaks.end());
+	rowBreaks.erase(std::unique(rowBreaks.begin(), rowBreaks.end()), rowBreaks.end());
+
+	std::vector<int>& columnBreaks = m_columnBreaks;
+	for (size_t i = 0; i + 1 < rowBreaks.size(); i++) {
+		const int y0 = rowBreaks[i];
+		const int y1 = rowBreaks[i + 1];
+		const int sampledRowCount = std::max(0, (firstSampledRow(y1, m_rowStride) - firstSampledRow(y0, m_rowStride)) / m_rowStride);
+
+		// Same for the left and right edges of the rects that cover this band
+		columnBreaks.clear();
+		for (const cv::Rect& rect : clippedRects) {
+			if (rect.empty() || rect.y > y0 || rect.y + rect.height <= y0) continue;
+			columnBreaks.push_back(rect.x);
+			columnBreaks.push_back(rect.x + rect.width);
+		}
+		if (columnBreaks.empty()) continue; // <- Nothing to sample in this band (the center of the screen)
+
+		std::sort(columnBreaks.begin(), columnBreaks.end());
+		columnBreaks.erase(std::unique(columnBreaks.begin(), columnBreaks.end()), columnBreaks.end());
+
+		Band band = { y0, y1, (int)m_segments.size(), (int)m_segments.size() };
+		for (size_t j = 0; j + 1 < columnBreaks.size(); j++) {
+			Segment segment = { columnBreaks[j], columnBreaks[j + 1], (int)m_segmentZones.size(), (int)m_segmentZones.size() };
+
+			for (size_t zoneIndex = 0; zoneIndex < clippedRects.size(); zoneIndex++) {
+				const cv::Rect& rect = clippedRects[zoneIndex];
+				if (rect.empty()) continue;
+				if (rect.y > y0 || rect.y + rect.height <= y0) continue;
+				if (rect.x > segment.x0 || rect.x + rect.width <= segment.x0) continue;
+
+				m_segmentZones.push_back((int)zoneIndex);
+				m_pixelCounts[zoneIndex] += (uint64_t)(segment.x1 - segment.x0) * sampledRowCount;
+			}
+
+			segment.zoneEnd = (int)m_segmentZones.size();
+			if (segment.zoneBegin == segment.zoneEnd) continue; // <- Gap between zones
+
+			m_segments.push_back(segment);
+		}
+
+		band.segmentEnd = (int)m_segments.size();
+		if (band.segmentBegin != band.segmentEnd) {
+			m_bands.push_back(band);
+		}
+	}
+}
+
+/// <summary>
+/// Converts a (BT.601, limited range) YUV color to BGR. The same conversion OpenCV uses for YUYV and NV12.
+/// </summary>
+static cv::Vec3b YUVToBGR(int y, int u, int v) {
+	int c = 298 * (y - 16) + 128;
+	int d = u - 128;
+	int e = v - 128;
+
+	return cv::Vec3b(
+		cv::saturate_cast<uchar>((c + 516 * d) >> 8), // Blue
+		cv::saturate_cast<uchar>((c - 100 * d - 208 * e) >> 8), // Green
+		cv::saturate_cast<uchar>((c + 409 * e) >> 8) // Red
+	);
+}
+
+/// <summary>
+/// Turns the summed channels of a zone (Blue, Green, Red or Y, U, V) into its average BGR color.
+/// </summary>
+/// <param name="sums">The (weighted) sums of the 3 channels</param>
+/// <param name="weightTotal">The pixel count, or the sum of the weights of the pixels</param>
+/// <param name="format">The pixel format that was summed, the sums of a 16 bit format are of 10 bit samples</param>
+/// <param name="toneMapper">Maps the average of a 16 bit format</param>
+cv::Vec3b calculateAverageColor(const uint64_t sums[3], uint64_t weightTotal, PixelFormat format, const ToneMapper& toneMapper) {
+	if (weightTotal == 0) return cv::Vec3b(0, 0, 0);
+
+	if (isHighBitDepth(format)) {
+		if (toneMapper.isHDR()) {
+			const float codes[3] = {
+				(float)((double)sums[0] / weightTotal),
+				(float)((double)sums[1] / weightTotal),
+				(float)((double)sums[2] / weightTotal)
+			};
+			return toneMapper.map(codes, format != PixelFormat::BGR16);
+		}
+
+		// A SDR source with more bits: the average of the 10 bit samples at 8 bits, exactly what the 8 bit frame gives
+		weightTotal <<= 2;
+		format = getLayout(format);
+	}
+
+	if (format == PixelFormat::BGR) {
+		// Note: truncates just like assigning the doubles of cv::mean to a uchar did
+		return cv::Vec3b(
+			(uchar)(sums[0] / weightTotal), // Blue
+			(uchar)(sums[1] / weightTotal), // Green
+			(uchar)(sums[2] / weightTotal) // Red
+		);
+	}
+
+	// The conversion is linear, so converting the average is the same as averaging the converted pixels
+	return YUVToBGR(
+		(int)((sums[0] + weightTotal / 2) / weightTotal),
+		(int)((sums[1] + weightTotal / 2) / weightTotal),
+		(int)((sums[2] + weightTotal / 2) / weightTotal)
+	);
+}
+
+/// <summary>
+/// Sums a segment of a row of NV12 (or P010) pixels, the UV row is shared by 2 rows.
+/// </summary>
+template<typename T>
+static inline void sumNV12(const T* yRow, const T* uvRow, int x0, int x1, uint32_t sums[3]) {
+	constexpr int SHIFT = (sizeof(T) == 2) ? HIGH_BIT_DEPTH_SHIFT : 0; // <- P010 is summed on its top 10 bits
+	uint32_t y = 0, u = 0, v = 0;
+	int x = x0;
+
+	if (x & 1) { // <- Second pixel of a pair
+		y += yRow[x] >> SHIFT;
+		u += uvRow[x - 1] >> SHIFT;
+		v += uvRow[x] >> SHIFT;
+		x++;
+	}
+
+	for (; x + 1 < x1; x += 2) {
+		y += (yRow[x] >> SHIFT) + (yRow[x + 1] >> SHIFT);
+		u += (uvRow[x] >> SHIFT) * 2;
+		v += (uvRow[x + 1] >> SHIFT) * 2;
+	}
+
+	if (x < x1) { // <- First pixel of a pair
+		y += yRow[x] >> SHIFT;
+		u += uvRow[x] >> SHIFT;
+		v += uvRow[x + 1] >> SHIFT;
+	}
+
+	sums[0] = y;
+	sums[1] = u;
+	sums[2] = v;
+}
+
+/// <summary>
+/// Sums the top 10 bits of a segment of a row of 16 bit BGR pixels.
+/// </summary>
+static inline void sumBGR16(const uint16_t* row, int x0, int x1, uint32_t sums[3]) {
+	uint32_t b = 0, g = 0, r = 0;
+	for (const uint16_t* pixel = row + x0 * 3; pixel < row + x1 * 3; pixel += 3) {
+		b += pixel[0] >> HIGH_BIT_DEPTH_SHIFT;
+		g += pixel[1] >> HIGH_BIT_DEPTH_SHIFT;
+		r += pixel[2] >> HIGH_BIT_DEPTH_SHIFT;
+	}
+
+	sums[0] = b;
+	sums[1] = g;
+	sums[2] = r;
+}
+
+/// <summary>
+/// Sums the top 10 bits of a segment of a row of Y210 pixels (Y0 U Y1 V), every U and V counts for the 2 pixels of its pair.
+/// </summary>
+static inline void sumY210(const uint16_t* row, int x0, int x1, uint32_t sums[3]) {
+	uint32_t y = 0, u = 0, v = 0;
+	int x = x0;
+
+	if (x & 1) { // <- Second pixel of a pair
+		y += row[x * 2] >> HIGH_BIT_DEPTH_SHIFT;
+		u += row[x * 2 - 1] >> HIGH_BIT_DEPTH_SHIFT;
+		v += row[x * 2 + 1] >> HIGH_BIT_DEPTH_SHIFT;
+		x++;
+	}
+
+	for (; x + 1 < x1; x += 2) {
+		const uint16_t* pair = row + x * 2;
+		y += (pair[0] >> HIGH_BIT_DEPTH_SHIFT) + (pair[2] >> HIGH_BIT_DEPTH_SHIFT);
+		u += (pair[1] >> HIGH_BIT_DEPTH_SHIFT) * 2;
+		v += (pair[3] >> HIGH_BIT_DEPTH_SHIFT) * 2;
+	}
+
+	if (x < x1) { // <- First pixel of a pair
+		y += row[x * 2] >> HIGH_BIT_DEPTH_SHIFT;
+		u += row[x * 2 + 1] >> HIGH_BIT_DEPTH_SHIFT;
+		v += row[x * 2 + 3] >> HIGH_BIT_DEPTH_SHIFT;
+	}
+
+	sums[0] = y;
+	sums[1] = u;
+	sums[2] = v;
+}
+
+/// <summary>
+/// Marks the segments (and bands) that cover at least one dirty zone, all of them when there is no mask.
+/// </summary>
+void BorderReducer::markActiveSegments(const std::vector<uint8_t>* dirtyZones) {
+	m_activeSegments.resize(m_segments.size());
+	m_activeBands.resize(m_bands.size());
+
+	for (size_t b = 0; b < m_bands.size(); b++) {
+		const Band& band = m_bands[b];
+		uint8_t bandActive = 0;
+
+		for (int s = band.segmentBegin; s < band.segmentEnd; s++) {
+			const Segment& segment = m_segments[s];
+			uint8_t segmentActive = (dirtyZones == nullptr);
+
+			for (int z = segment.zoneBegin; z < segment.zoneEnd && !segmentActive; z++) {
+				segmentActive = (*dirtyZones)[m_segmentZones[z]];
+			}
+
+			m_activeSegments[s] = segmentActive;
+			bandActive |= segmentActive;
+		}
+
+		m_activeBands[b] = bandActive;
+	}
+}
+
+/// <summary>
+/// Walks the (sampled) rows of every (active) band once, sums every segment and adds it to the zones covering it.
+/// </summary>
+template<PixelFormat FORMAT>
+void BorderReducer::sumSegments(const cv::Mat& frame) {
+	for (size_t b = 0; b < m_bands.size(); b++) {
+		if (!m_activeBands[b]) continue;
+
+		const Band& band = m_bands[b];
+		for (int y = firstSampledRow(band.y0, m_rowStride); y < band.y1; y += m_rowStride) {
+			const SampleType<FORMAT>* row = frame.ptr<SampleType<FORMAT>>(y);
+			const SampleType<FORMAT>* uvRow = nullptr;
+			if constexpr (getLayout(FORMAT) == PixelFormat::NV12) {
+				uvRow = frame.ptr<SampleType<FORMAT>>(m_frameDimensions.height + y / 2);
+			}
+
+			for (int s = band.segmentBegin; s < band.segmentEnd; s++) {
+				if (!m_activeSegments[s]) continue;
+				const Segment& segment = m_segments[s];
+
+				// Sum the segment once...
+				uint32_t segmentSums[3];
+				if constexpr (FORMAT == PixelFormat::BGR) m_sumKernels->sumBGR(row, segment.x0, segment.x1, segmentSums);
+				if constexpr (FORMAT == PixelFormat::YUYV) m_sumKernels->sumYUYV(row, segment.x0, segment.x1, segmentSums);
+				if constexpr (FORMAT == PixelFormat::NV12) sumNV12(row, uvRow, segment.x0, segment.x1, segmentSums);
+				if constexpr (FORMAT == PixelFormat::BGR16) sumBGR16(row, segment.x0, segment.x1, segmentSums);
+				if constexpr (FORMAT == PixelFormat::Y210) sumY210(row, segment.x0, segment.x1, segmentSums);
+				if constexpr (FORMAT == PixelFormat::P010) sumNV12(row, uvRow, segment.x0, segment.x1, segmentSums);
+
+				// ...and give it to every zone covering it
+				for (int z = segment.zoneBegin; z < segment.zoneEnd; z++) {
+					uint64_t* sum = &m_sums[m_segmentZones[z] * 3];
+					sum[0] += segmentSums[0];
+					sum[1] += segmentSums[1];
+					sum[2] += segmentSums[2];
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Calculates the average color of every zone in one sweep over the frame.
+/// The frame must have the dimensions the reducer was build for.
+/// </summary>
+/// <param name="frame">Frame to calculate the averages on</param>
+/// <param name="averages">Gets resized to the zone count and filled with the average color (BGR) per zone</param>
+/// <param name="format">The pixel format of the frame</param>
+/// <param name="dirtyZones">Optional, 1 for every zone that needs a new average. The averages of the other zones are kept.</param>
+void BorderReducer::reduce(const cv::Mat& frame, std::vector<cv::Vec3b>& averages, PixelFormat format,
+	const std::vector<uint8_t>* dirtyZones) {
+	assert(dirtyZones == nullptr || dirtyZones->size() == m_pixelCounts.size());
+
+	std::fill(m_sums.begin(), m_sums.end(), 0);
+	this->markActiveSegments(dirtyZones);
+
+	switch (format) {
+	case PixelFormat::BGR:
+		assert(frame.type() == CV_8UC3 && m_frameDimensions.equals(frame));
+		this->sumSegments<PixelFormat::BGR>(frame);
+		break;
+
+	case PixelFormat::YUYV:
+		assert(frame.type() == CV_8UC2 && m_frameDimensions.equals(frame));
+		this->sumSegments<PixelFormat::YUYV>(frame);
+		break;
+
+	case PixelFormat::NV12:
+		assert(frame.type() == CV_8UC1 && frame.rows == m_frameDimensions.height * 3 / 2);
+		this->sumSegments<PixelFormat::NV12>(frame);
+		break;
+
+	case PixelFormat::BGR16:
+		assert(frame.type() == CV_16UC3 && m_frameDimensions.equals(frame));
+		this->sumSegments<PixelFormat::BGR16>(frame);
+		break;
+
+	case PixelFormat::Y210:
+		assert(frame.type() == CV_16UC2 && m_frameDimensions.equals(frame));
+		this->sumSegments<PixelFormat::Y210>(frame);
+		break;
+
+	case PixelFormat::P010:
+		assert(frame.type() == CV_16UC1 && frame.rows == m_frameDimensions.height * 3 / 2);
+		this->sumSegments<PixelFormat::P010>(frame);
+		break;
+	}
+
+	averages.resize(m_pixelCounts.size());
+	for (size_t i = 0; i < m_pixelCounts.size(); i++) {
+		if (dirtyZones != nullptr && !(*dirtyZones)[i]) continue;
+
+		averages[i] = calculateAverageColor(&m_sums[i * 3], m_pixelCounts[i], format, *m_toneMapper);
+	}
+}
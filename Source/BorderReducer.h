@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "Dimensions.h"
+#include "PixelFormat.h"
+#include "SumKernels.h"
+#include "ToneMapper.h"
+
+/// <summary>
+/// Calculates the average color of a set of zones in a single sweep over the frame.
+///
+/// Instead of cropping every zone and running cv::mean on it (a pass per zone, and the corners are read twice),
+/// the zone rects are compiled once into a plan of horizontal bands.
+/// Every band is a range of rows that is covered by the same zones, split up into segments.
+/// A segment is a range of columns together with the zones covering it.
+///
+/// Reducing walks the rows of every band top to bottom, sums each segment once
+/// and adds that sum to every zone covering the segment. Pixels outside the zones are never touched.
+///
+/// The BGR and YUYV rows are summed with the fastest SumKernels of the CPU.
+/// YUYV and NV12 frames are summed as they are (Y, U and V), only the average per zone is converted to BGR.
+/// The 16 bit formats (BGR16, Y210, P010) are summed on their top 10 bits, only the average per zone is tone mapped (see ToneMapper).
+///
+/// When a mask of dirty zones is given, segments that only cover clean zones are skipped
+/// and the clean zones keep the average they already had.
+///
+/// With a row stride above 1 only the rows that are a multiple of it are summed (a cheaper, rougher average), see QualityGovernor.
+/// </summary>
+class BorderReducer
+{
+public:
+	// Methods
+	void build(const std::vector<cv::Rect>& zoneRects, Dimensions frameDimensions, int rowStride = 1);
+	void reduce(const cv::Mat& frame, std::vector<cv::Vec3b>& averages, PixelFormat format = PixelFormat::BGR,
+		const std::vector<uint8_t>* dirtyZones = nullptr);
+
+	// Getters & setters
+	size_t getZoneCount() const { return m_pixelCounts.size(); }
+	const Dimensions& getFrameDimensions() const { return m_frameDimensions; }
+	int getRowStride() const { return m_rowStride; }
+	void setSumKernels(const SumKernels& sumKernels) { m_sumKernels = &sumKernels; }
+	void setToneMapper(const ToneMapper& toneMapper) { m_toneMapper = &toneMapper; }
+
+private:
+	struct Segment {
+		int x0; // First column (inclusive)
+		int x1; // Last column (exclusive)
+		int zoneBegin; // Range in m_segmentZones
+		int zoneEnd;
+	};
+
+	struct Band {
+		int y0; // First row (inclusive)
+		int y1; // Last row (exclusive)
+		int segmentBegin; // Range in m_segments
+		int segmentEnd;
+	};
+
+	// Methods
+	void markActiveSegments(const std::vector<uint8_t>* dirtyZones);
+
+	template<PixelFormat FORMAT>
+	void sumSegments(const cv::Mat& frame);
+
+	// Members
+	Dimensions m_frameDimensions = { 0, 0 };
+	int m_rowStride = 1;
+	const SumKernels* m_sumKernels = &getSumKernels();
+	const ToneMapper* m_toneMapper = &getToneMapper(); // <- Only for the 16 bit formats
+
+	std::vector<Band> m_bands;
+	std::vector<Segment> m_segments;
+	std::vector<int> m_segmentZones;
+
+	std::vector<uint8_t> m_activeSegments; // <- 1 for every segment that covers a dirty zone, filled by reduce
+	std::vector<uint8_t> m_activeBands;
+
+	// Scratch buffers of build, members so a rebuild doesn't allocate
+	std::vector<cv::Rect> m_clippedRects;
+	std::vector<int> m_rowBreaks;
+	std::vector<int> m_columnBreaks;
+
+	std::vector<uint64_t> m_sums; // <- 3 per zone (Blue, Green, Red or Y, U, V)
+	std::vector<uint64_t> m_pixelCounts;
+};
+
+/// <summary>
+/// The first row from y on that is sampled with the given row stride.
+/// </summary>
+inline int firstSampledRow(int y, int rowStride) {
+	return (y + rowStride - 1) / rowStride * rowStride;
+}
+
+cv::Vec3b calculateAverageColor(const uint64_t sums[3], uint64_t weightTotal, PixelFormat format, const ToneMapper& toneMapper = getToneMapper());
@@ -0,0 +1,179 @@
+#include "CaptureConnection.h"
+#include "Metrics.h"
+#include "const_config.h"
+
+#include <cstring>
+#include <cerrno>
+#include <thread>
+#include <algorithm>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+CaptureConnection::CaptureConnection(FrameSource& frameSource)
+	: m_frameSource(frameSource), m_backoffDelayMS(Config::CAPTURE_RECONNECT_MIN_DELAY_MS), m_startTime(Clock::now()) {
+	m_disconnectTime = m_startTime;
+
+#ifdef __linux__
+	// Watch for devices that are added, removed or get their permissions set (udev does that right after adding)
+	m_watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_watchFd != -1 && inotify_add_watch(m_watchFd, Config::CAPTURE_DEVICE_DIRECTORY, IN_CREATE | IN_DELETE | IN_ATTRIB) == -1) {
+		LOG_WARNING("Can't watch " << Config::CAPTURE_DEVICE_DIRECTORY << " for capture devices: " << std::strerror(errno)
+			<< ", only using the backoff to reconnect");
+		::close(m_watchFd);
+		m_watchFd = -1;
+	}
+#endif
+}
+
+CaptureConnection::~CaptureConnection() {
+#ifdef __linux__
+	if (m_watchFd != -1) ::close(m_watchFd);
+#endif
+}
+
+/// <summary>
+/// Reads the next frame, (re)connecting the FrameSource when needed.
+/// While disconnected this blocks at most CAPTURE_RECONNECT_MAX_DELAY_MS (or till a signal arrives).
+/// </summary>
+/// <returns>If it could succesfully get a non-empty frame</returns>
+bool CaptureConnection::read(Frame& frame) {
+	if (!m_frameSource.isOpened() && !this->reconnect()) {
+		return false;
+	}
+
+	if (!m_frameSource.read(frame) || frame.empty()) {
+		this->handleReadFailure();
+		return false;
+	}
+
+	frame.timestamp = Clock::now();
+	m_readFailures = 0;
+	if (!m_connected) this->handleFirstFrame();
+
+	return true;
+}
+
+/// <summary>
+/// Tries to open the FrameSource. The first attempt after losing the connection is done right away,
+/// after that it waits for a device event or the backoff delay (which doubles every failed attempt).
+/// </summary>
+bool CaptureConnection::reconnect() {
+	if (m_openAttempts > 0) {
+		if (this->waitForDeviceEvent(m_backoffDelayMS)) {
+			m_backoffDelayMS = Config::CAPTURE_RECONNECT_MIN_DELAY_MS; // <- Something changed, so try again soon
+		}
+		else {
+			m_backoffDelayMS = std::min(m_backoffDelayMS * 2, Config::CAPTURE_RECONNECT_MAX_DELAY_MS);
+		}
+	}
+	m_openAttempts++;
+
+	if (!this->isDevicePresent()) return false; // <- No need to try, wait for it to show up
+
+	if (!m_frameSource.open()) {
+		if (m_openAttempts == 1) {
+			LOG_WARNING("Can't open FrameSource (" << m_frameSource.getName() << ")... Waiting for the capture card!");
+		}
+		return false;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// A read that timed out without a signal (see FrameSource::isWaitingForSignal) keeps the stream open and is read again,
+/// as long as the device node is there. No buffers are unmapped and mapped again every few seconds while the TV is off,
+/// and the first frame of the signal is read right away.
+/// Other failed reads are retried CAPTURE_READ_RETRIES times before the FrameSource is closed,
+/// unless the device is gone, then it's closed right away.
+/// </summary>
+void CaptureConnection::handleReadFailure() {
+	if (m_connected) {
+		LOG_WARNING("Lost the capture card signal...");
+		m_connected = false;
+		m_disconnectTime = Clock::now();
+		m_openAttempts = 0; // <- The first reopen is done right away
+		m_backoffDelayMS = Config::CAPTURE_RECONNECT_MIN_DELAY_MS;
+	}
+
+	const bool devicePresent = this->isDevicePresent();
+	if (m_frameSource.isWaitingForSignal() && devicePresent) return;
+
+	m_readFailures++;
+	if (m_readFailures <= Config::CAPTURE_READ_RETRIES && devicePresent) return;
+
+	LOG_WARNING("Can't read frame... Closing FrameSource so it will fully reconnect!");
+	m_frameSource.close();
+	m_readFailures = 0;
+}
+
+/// <summary>
+/// Updates the metrics once the frames are flowing again.
+/// </summary>
+void CaptureConnection::handleFirstFrame() {
+	Clock::time_point now = Clock::now();
+	m_connected = true;
+	m_openAttempts = 0;
+	m_backoffDelayMS = Config::CAPTURE_RECONNECT_MIN_DELAY_MS;
+
+	if (!m_hadFirstFrame) {
+		m_hadFirstFrame = true;
+		m_timeToFirstLightMS = std::chrono::duration<double, std::milli>(now - m_startTime).count();
+		LOG_INFO("Time to first light: " << m_timeToFirstLightMS << "MS");
+
+		getMetrics().timeToFirstLightSeconds = (now - m_startTime) / std::chrono::duration<double>(1.0);
+	}
+	else {
+		m_reconnectCount++;
+		m_lastReconnectDurationMS = std::chrono::duration<double, std::milli>(now - m_disconnectTime).count();
+		LOG_INFO("Capture card reconnected in " << m_lastReconnectDurationMS << "MS");
+
+		getMetrics().reconnects.fetch_add(1, std::memory_order_relaxed);
+		getMetrics().reconnectDuration.observe(now - m_disconnectTime);
+	}
+}
+
+/// <summary>
+/// Waits till a video device is added, removed or changed, or till the timeout.
+/// Without inotify this is a plain sleep.
+/// </summary>
+/// <returns>True if a video device changed</returns>
+bool CaptureConnection::waitForDeviceEvent(int timeoutMS) {
+#ifdef __linux__
+	if (m_watchFd != -1) {
+		pollfd pollFd = { m_watchFd, POLLIN, 0 };
+		if (poll(&pollFd, 1, timeoutMS) <= 0) return false;
+
+		// Only events of video devices count
+		alignas(inotify_event) char events[4096];
+		bool videoDeviceChanged = false;
+		ssize_t length;
+		while ((length = ::read(m_watchFd, events, sizeof(events))) > 0) {
+			for (char* pointer = events; pointer < events + length; ) {
+				const inotify_event* event = (const inotify_event*)pointer;
+				if (event->len > 0 && std::strncmp(event->name, "video", 5) == 0) videoDeviceChanged = true;
+				pointer += sizeof(inotify_event) + event->len;
+			}
+		}
+		return videoDeviceChanged;
+	}
+#endif
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMS)); // <- do not overload the thread and CPU unnecessarily
+	return false;
+}
+
+/// <summary>
+/// Checks if the device node of the FrameSource exists. Sources without a device node are always present.
+/// </summary>
+bool CaptureConnection::isDevicePresent() const {
+#ifdef __linux__
+	const char* devicePath = m_frameSource.getDevicePath();
+	if (devicePath != nullptr) return access(devicePath, F_OK) == 0;
+#endif
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "FrameSource.h"
+#include "Frame.h"
+
+/// <summary>
+/// Keeps the FrameSource (the capture card) connected, so the leds are dark as short as possible.
+///
+/// - Without a signal (the reads time out) the stream stays open and is read again, it delivers as soon as the signal is back.
+/// - A other failed read is retried a few times before the source is reopened, a HDMI source switch often only drops a few frames.
+///   When the device node is gone the source is closed right away.
+/// - While disconnected it waits for a video device to show up in /dev (inotify) instead of polling with a fixed sleep,
+///   with a bounded exponential backoff between the attempts to reopen.
+///
+/// The time to first light (start-up till the first frame) and the reconnect durations are kept in the Metrics.
+/// Note: both are measured up to the first captured frame, analysing and rendering it adds less than a frame to that.
+/// </summary>
+class CaptureConnection
+{
+public:
+	// Constructor
+	CaptureConnection(FrameSource& frameSource);
+	~CaptureConnection();
+
+	// Methods
+	bool read(Frame& frame);
+
+	// Getters & setters
+	FrameSource& getFrameSource() { return m_frameSource; }
+	bool isConnected() const { return m_connected; }
+
+	double getTimeToFirstLightMS() const { return m_timeToFirstLightMS; } // <- -1 till the first frame
+	double getLastReconnectDurationMS() const { return m_lastReconnectDurationMS; } // <- -1 till the first reconnect
+	uint64_t getReconnectCount() const { return m_reconnectCount; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// Methods
+	bool reconnect();
+	void handleReadFailure();
+	void handleFirstFrame();
+	bool waitForDeviceEvent(int timeoutMS);
+	bool isDevicePresent() const;
+
+	// Members
+	FrameSource& m_frameSource;
+
+	int m_watchFd = -1; // <- inotify on the directory of the video devices, -1 when not available
+
+	int m_backoffDelayMS;
+	int m_openAttempts = 0; // <- Since the connection was lost
+	int m_readFailures = 0; // <- In a row
+
+	std::atomic<bool> m_connected = false; // <- Read frames since the last (re)connect
+	bool m_hadFirstFrame = false;
+	Clock::time_point m_startTime;
+	Clock::time_point m_disconnectTime;
+
+	std::atomic<double> m_timeToFirstLightMS = -1.0;
+	std::atomic<double> m_lastReconnectDurationMS = -1.0;
+	std::atomic<uint64_t> m_reconnectCount = 0;
+};
@@ -0,0 +1,104 @@
+#include "ChangeDetector.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+/*
+	The sample grid per zone, at most this many columns and rows (less when the zone is smaller).
+*/
+static constexpr int SAMPLE_GRID_COLUMNS = 8;
+static constexpr int SAMPLE_GRID_ROWS = 4;
+
+/// <summary>
+/// Places the sample grid in every zone (clipped to the frame).
+/// Everything is marked dirty on the next detect.
+/// </summary>
+void ChangeDetector::build(const std::vector<cv::Rect>& zoneRects, Dimensions frameDimensions) {
+	const cv::Rect frameRect(0, 0, frameDimensions.width, frameDimensions.height);
+
+	// Note: reserved for the biggest grid, so a rebuild for other zone sizes doesn't allocate
+	m_samplePoints.clear();
+	m_samplePoints.reserve(zoneRects.size() * SAMPLE_GRID_COLUMNS * SAMPLE_GRID_ROWS);
+	m_zoneSampleBegin.clear();
+
+	for (const cv::Rect& zoneRect : zoneRects) {
+		m_zoneSampleBegin.push_back((int)m_samplePoints.size());
+
+		cv::Rect rect = zoneRect & frameRect;
+		if (rect.empty()) continue;
+
+		int columns = std::min(SAMPLE_GRID_COLUMNS, rect.width);
+		int rows = std::min(SAMPLE_GRID_ROWS, rect.height);
+		for (int row = 0; row < rows; row++) {
+			for (int column = 0; column < columns; column++) {
+				// Center of every cell of the grid
+				m_samplePoints.push_back(cv::Point(
+					rect.x + (2 * column + 1) * rect.width / (2 * columns),
+					rect.y + (2 * row + 1) * rect.height / (2 * rows)
+				));
+			}
+		}
+	}
+	m_zoneSampleBegin.push_back((int)m_samplePoints.size());
+	m_frameHeight = frameDimensions.height;
+
+	m_previousSamples.reserve(m_samplePoints.capacity() * 3);
+	m_previousSamples.assign(m_samplePoints.size() * 3, 0);
+	m_forceRefresh = true;
+}
+
+/// <summary>
+/// Compares the samples of every zone with the frame the zone was last marked dirty on.
+/// Only the samples of the dirty zones are kept, so a change of less than the threshold per frame still marks the zone dirty once it adds up.
+/// </summary>
+/// <param name="frame">Frame with the dimensions the detector was build for</param>
+/// <param name="format">The pixel format of the frame</param>
+/// <param name="dirtyZones">Gets resized to the zone count, 1 for every zone that changed</param>
+void ChangeDetector::detect(const cv::Mat& frame, PixelFormat format, std::vector<uint8_t>& dirtyZones) {
+	const size_t zoneCount = m_zoneSampleBegin.size() - 1;
+	dirtyZones.resize(zoneCount);
+
+	// Channels per sample: BGR, Y + U or V for YUYV, Y + U + V for NV12 (from the UV plane). The 16 bit formats are compared on their high byte
+	const PixelFormat layout = getLayout(format);
+	const int sampleSize = (layout == PixelFormat::YUYV ? 2 : 3);
+	const bool highBitDepth = isHighBitDepth(format);
+	auto readSample = [&](int x, int y) {
+		return highBitDepth ? (uint8_t)(frame.ptr<uint16_t>(y)[x] >> 8) : frame.ptr<uchar>(y)[x];
+	};
+
+	bool refresh = m_forceRefresh || format != m_lastFormat
+		|| (m_refreshInterval > 0 && m_framesSinceRefresh >= m_refreshInterval);
+
+	for (size_t zone = 0; zone < zoneCount; zone++) {
+		int difference = 0;
+		const int begin = m_zoneSampleBegin[zone];
+		const int end = m_zoneSampleBegin[zone + 1];
+
+		// The samples of this frame, kept on the stack till it is known if the zone is dirty
+		uint8_t samples[SAMPLE_GRID_COLUMNS * SAMPLE_GRID_ROWS * 3] = {};
+		for (int i = begin; i < end; i++) {
+			const cv::Point& point = m_samplePoints[i];
+			uint8_t* sample = &samples[(i - begin) * 3];
+
+			if (layout == PixelFormat::NV12) {
+				sample[0] = readSample(point.x, point.y);
+				sample[1] = readSample(point.x & ~1, m_frameHeight + point.y / 2); // <- U
+				sample[2] = readSample((point.x & ~1) + 1, m_frameHeight + point.y / 2); // <- V
+			}
+			else {
+				for (int c = 0; c < sampleSize; c++) sample[c] = readSample(point.x * sampleSize + c, point.y);
+			}
+
+			const uint8_t* previous = &m_previousSamples[i * 3];
+			for (int c = 0; c < sampleSize; c++) difference += std::abs((int)sample[c] - (int)previous[c]);
+		}
+
+		int sampleBytes = (end - begin) * sampleSize;
+		dirtyZones[zone] = refresh || difference > m_threshold * sampleBytes;
+		if (dirtyZones[zone]) std::copy(samples, samples + (end - begin) * 3, &m_previousSamples[begin * 3]);
+	}
+
+	m_lastFormat = format;
+	m_forceRefresh = false;
+	m_framesSinceRefresh = (refresh ? 0 : m_framesSinceRefresh + 1);
+}
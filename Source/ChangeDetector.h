@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "Dimensions.h"
+#include "PixelFormat.h"
+
+/// <summary>
+/// Cheaply detects which zones changed since the previous frame, so the unchanged zones don't have to be averaged again.
+///
+/// Every zone is sampled on a small grid of pixels. A zone is marked dirty when the mean absolute difference
+/// of its samples with the frame it was last marked dirty on is above the threshold, so a slow fade adds up till the zone is averaged again.
+/// Because a grid can miss small changes, all zones are marked dirty every refreshInterval frames.
+/// </summary>
+class ChangeDetector
+{
+public:
+	// Methods
+	void build(const std::vector<cv::Rect>& zoneRects, Dimensions frameDimensions);
+	void detect(const cv::Mat& frame, PixelFormat format, std::vector<uint8_t>& dirtyZones);
+	void invalidate() { m_forceRefresh = true; }
+
+	// Getters & setters
+	void setThreshold(int value) { m_threshold = value; }
+	void setRefreshInterval(int value) { m_refreshInterval = value; }
+
+private:
+	// Members
+	int m_threshold = 2; // <- Mean absolute difference per sample byte
+	int m_refreshInterval = 30; // <- In frames, 0 never forces a refresh
+	int m_framesSinceRefresh = 0;
+	bool m_forceRefresh = true;
+	PixelFormat m_lastFormat = PixelFormat::BGR;
+	int m_frameHeight = 0; // <- Where the UV plane of NV12 (and P010) starts
+
+	std::vector<cv::Point> m_samplePoints; // <- Grouped per zone
+	std::vector<int> m_zoneSampleBegin; // <- Range of a zone in m_samplePoints, zone count + 1 entries
+	std::vector<uint8_t> m_previousSamples; // <- 3 bytes per sample point, of the frame the zone was last marked dirty on
+};
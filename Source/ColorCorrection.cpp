@@ -0,0 +1,98 @@
+#include "ColorCorrection.h"
+#include "LedColors.h"
+
+#include <cmath>
+#include <algorithm>
+
+ColorCorrection::ColorCorrection(const ColorCorrectionSettings& settings) {
+	this->build(settings);
+}
+
+/// <summary>
+/// Approximates the color of a black body (Tanner Helland's fit of the CIE data) as 0 - 255 per channel.
+/// </summary>
+static cv::Vec3f blackBodyColor(int kelvin) {
+	const float t = std::clamp(kelvin, 1000, 40000) / 100.0f;
+
+	float red = (t <= 66.0f) ? 255.0f : 329.698727446f * std::pow(t - 60.0f, -0.1332047592f);
+	float green = (t <= 66.0f)
+		? 99.4708025861f * std::log(t) - 161.1195681661f
+		: 288.1221695283f * std::pow(t - 60.0f, -0.0755148492f);
+	float blue = (t >= 66.0f) ? 255.0f : (t <= 19.0f ? 0.0f : 138.5177312231f * std::log(t - 10.0f) - 305.0447927307f);
+
+	return cv::Vec3f(std::clamp(blue, 0.0f, 255.0f), std::clamp(green, 0.0f, 255.0f), std::clamp(red, 0.0f, 255.0f));
+}
+
+/// <summary>
+/// The gain per channel (Blue, Green, Red) that makes white look like the given color temperature.
+/// Relative to 6500K (the white of the screen), the strongest channel gets a gain of 1 so nothing clips.
+/// </summary>
+cv::Vec3f colorTemperatureToGains(int kelvin) {
+	const cv::Vec3f color = blackBodyColor(kelvin);
+	const cv::Vec3f neutral = blackBodyColor(6500);
+
+	cv::Vec3f gains;
+	for (int c = 0; c < 3; c++) {
+		gains[c] = color[c] / neutral[c];
+	}
+
+	const float strongest = std::max({ gains[0], gains[1], gains[2] });
+	for (int c = 0; c < 3; c++) {
+		gains[c] /= strongest;
+	}
+
+	return gains;
+}
+
+/// <summary>
+/// Folds gamma, white point and minimum brightness into a lookup table per channel.
+/// The gamma is applied first (from screen values to the linear light of a led), then the gain of the white point,
+/// and at last the 0 - 255 range is squeezed into minimumBrightness - 255.
+/// </summary>
+void ColorCorrection::build(const ColorCorrectionSettings& settings) {
+	m_settings = settings;
+
+	const cv::Vec3f gains = colorTemperatureToGains(settings.colorTemperature);
+	const float gammas[3] = { settings.gammaBlue, settings.gammaGreen, settings.gammaRed };
+	const float floor = settings.minimumBrightness;
+
+	for (int c = 0; c < 3; c++) {
+		for (int value = 0; value < 256; value++) {
+			float corrected = std::pow(value / 255.0f, std::max(gammas[c], 0.01f)) * gains[c] * 255.0f;
+			corrected = floor + corrected * (255.0f - floor) / 255.0f;
+
+			m_tables[c][value] = (uint8_t)std::clamp((int)std::lround(corrected), 0, 255);
+		}
+	}
+}
+
+/// <summary>
+/// Corrects a BGR color and packs it for the led-strip.
+/// With extractWhite the part that all 3 channels have in common is taken out and put on the white led.
+/// </summary>
+uint32_t ColorCorrection::apply(cv::Vec3b color) const {
+	cv::Vec3b corrected(m_tables[0][color[0]], m_tables[1][color[1]], m_tables[2][color[2]]);
+
+	uint8_t white = 0;
+	if (m_settings.extractWhite) {
+		white = std::min({ corrected[0], corrected[1], corrected[2] });
+		corrected[0] -= white;
+		corrected[1] -= white;
+		corrected[2] -= white;
+	}
+
+	return (uint32_t)BGRToWRGBHex(corrected, white);
+}
+
+/// <summary>
+/// Corrects and packs the BGR color of every led.
+/// </summary>
+/// <param name="colors">A BGR color per led.</param>
+/// <param name="ledColors">The buffer with a color per led, gets resized to the led count.</param>
+void ColorCorrection::apply(const std::vector<cv::Vec3b>& colors, std::vector<uint32_t>& ledColors) const {
+	ledColors.resize(colors.size());
+
+	for (size_t i = 0; i < colors.size(); i++) {
+		ledColors[i] = this->apply(colors[i]);
+	}
+}
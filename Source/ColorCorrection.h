@@ -0,0 +1,48 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+/// <summary>
+/// How the led colors are corrected before they are send to the led-strip, see COLOR_CORRECTION in the config.
+/// </summary>
+struct ColorCorrectionSettings {
+	float gammaRed = 1.0f; // <- 1 leaves the channel as it is
+	float gammaGreen = 1.0f;
+	float gammaBlue = 1.0f;
+	int colorTemperature = 6500; // <- White point in Kelvin, 6500 is neutral
+	uint8_t minimumBrightness = 0; // <- Every channel is lifted to at least this (0 - 255)
+	bool extractWhite = false; // <- Moves the white part of a color to the white led (RGBW strips)
+};
+
+/// <summary>
+/// Corrects the led colors and packs them for the led-strip.
+///
+/// Gamma, white point and minimum brightness only depend on the value of one channel,
+/// so they are folded into one lookup table per channel when the settings are build.
+/// Correcting a led is then 3 table lookups, plus taking the white part out for RGBW strips.
+/// </summary>
+class ColorCorrection
+{
+public:
+	// Constructor
+	ColorCorrection(const ColorCorrectionSettings& settings = ColorCorrectionSettings());
+
+	// Methods
+	void build(const ColorCorrectionSettings& settings);
+	void apply(const std::vector<cv::Vec3b>& colors, std::vector<uint32_t>& ledColors) const;
+	uint32_t apply(cv::Vec3b color) const;
+
+	// Getters & setters
+	const ColorCorrectionSettings& getSettings() const { return m_settings; }
+	const std::array<uint8_t, 256>& getTable(int channel) const { return m_tables[channel]; } // <- Blue, Green, Red
+
+private:
+	// Members
+	ColorCorrectionSettings m_settings;
+	std::array<std::array<uint8_t, 256>, 3> m_tables; // <- Blue, Green, Red
+};
+
+cv::Vec3f colorTemperatureToGains(int kelvin);
@@ -0,0 +1,110 @@
+#include "ColorInterpolator.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*
+	Note:
+	Weights are Q15 (32768 == 1.0), so (b - a) * weight always fits in 32 bits for 16 bit values.
+*/
+static constexpr int32_t WEIGHT_ONE = 1 << 15;
+
+/// <summary>
+/// out = from + (to - from) * weight, for every channel.
+/// </summary>
+static void blendChannels(const uint16_t* __restrict from, const uint16_t* __restrict to, uint16_t* __restrict out, size_t count, int32_t weight) {
+	for (size_t i = 0; i < count; i++) {
+		int32_t a = from[i];
+		int32_t b = to[i];
+		out[i] = (uint16_t)(a + (((b - a) * weight) >> 15));
+	}
+}
+
+/// <summary>
+/// values = values + (to - values) * weight, for every channel.
+/// </summary>
+static void blendChannelsInPlace(uint16_t* __restrict values, const uint16_t* __restrict to, size_t count, int32_t weight) {
+	for (size_t i = 0; i < count; i++) {
+		int32_t a = values[i];
+		int32_t b = to[i];
+		values[i] = (uint16_t)(a + (((b - a) * weight) >> 15));
+	}
+}
+
+ColorInterpolator::ColorInterpolator(float smoothingTimeMS, bool interpolate)
+	: m_smoothingTimeMS(smoothingTimeMS), m_interpolate(interpolate) { }
+
+/// <summary>
+/// Sets the newest analysed colors. The interpolation continues from where the output is right now.
+/// </summary>
+/// <param name="colors">BGR color per led</param>
+/// <param name="captureTime">When the frame of the colors was captured, used to estimate the frame interval</param>
+/// <param name="now">The current time of the render clock</param>
+void ColorInterpolator::setTarget(const std::vector<cv::Vec3b>& colors, Clock::time_point captureTime, Clock::time_point now) {
+	const size_t channelCount = colors.size() * 3;
+	const uint8_t* channels = (const uint8_t*)colors.data();
+
+	if (!m_hasTarget || m_target.size() != channelCount) {
+		// First colors (or the led count changed): start there, nothing to interpolate from
+		m_target.resize(channelCount);
+		for (size_t i = 0; i < channelCount; i++) m_target[i] = (uint16_t)(channels[i] << 8);
+
+		m_previous = m_target;
+		m_interpolated = m_target;
+		m_current = m_target;
+		m_lastUpdateTime = now;
+		m_hasTarget = true;
+	}
+	else {
+		// Continue from the current interpolated colors, so there is no jump when a frame comes early
+		std::copy(m_interpolated.begin(), m_interpolated.end(), m_previous.begin());
+		for (size_t i = 0; i < channelCount; i++) m_target[i] = (uint16_t)(channels[i] << 8);
+
+		// The time between two frames is how long the interpolation takes, within sane limits
+		m_frameInterval = std::clamp<Clock::duration>(
+			captureTime - m_targetCaptureTime,
+			std::chrono::milliseconds(5),
+			std::chrono::milliseconds(100)
+		);
+	}
+
+	m_targetCaptureTime = captureTime;
+	m_targetArrivalTime = now;
+}
+
+/// <summary>
+/// Moves the output to the given time of the render clock.
+/// </summary>
+void ColorInterpolator::update(Clock::time_point now) {
+	if (!m_hasTarget) return;
+
+	// Interpolate between the last two analysed color sets
+	double progress = std::chrono::duration<double>(now - m_targetArrivalTime).count()
+		/ std::chrono::duration<double>(m_frameInterval).count();
+	int32_t interpolationWeight = (m_interpolate ? (int32_t)(std::clamp(progress, 0.0, 1.0) * WEIGHT_ONE) : WEIGHT_ONE);
+	blendChannels(m_previous.data(), m_target.data(), m_interpolated.data(), m_interpolated.size(), interpolationWeight);
+
+	// Smooth, alpha = 1 - e^(-dt / timeConstant) gives the same result for every render rate
+	int32_t smoothingWeight = WEIGHT_ONE;
+	if (m_smoothingTimeMS > 0.0f) {
+		double deltaTimeMS = std::chrono::duration<double, std::milli>(now - m_lastUpdateTime).count();
+		smoothingWeight = (int32_t)((1.0 - std::exp(-deltaTimeMS / m_smoothingTimeMS)) * WEIGHT_ONE);
+	}
+	blendChannelsInPlace(m_current.data(), m_interpolated.data(), m_current.size(), smoothingWeight);
+
+	m_lastUpdateTime = now;
+}
+
+/// <summary>
+/// Gets the output rounded to 8 bits per channel.
+/// </summary>
+/// <param name="colors">Gets resized to the led count and filled with a BGR color per led</param>
+void ColorInterpolator::getColors(std::vector<cv::Vec3b>& colors) const {
+	colors.resize(this->getLedCount());
+
+	uint8_t* __restrict channels = (uint8_t*)colors.data();
+	const uint16_t* __restrict current = m_current.data();
+	for (size_t i = 0; i < m_current.size(); i++) {
+		channels[i] = (uint8_t)std::min(255, (current[i] + 128) >> 8);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+/// <summary>
+/// Turns the led colors of the (30 - 60 fps) captured frames into smooth output for a faster render clock.
+///
+/// Between two analysed color sets the colors are interpolated linearly, taking the time between the two frames.
+/// On top of that a exponential smoothing with a time constant is applied, which doesn't depend on the render rate.
+///
+/// All colors are stored as 8.8 fixed-point per channel in flat arrays,
+/// so every step is one branch-less loop over the whole led buffer that the compiler can vectorise.
+/// </summary>
+class ColorInterpolator
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Constructor
+	ColorInterpolator(float smoothingTimeMS, bool interpolate = true);
+
+	// Methods
+	void setTarget(const std::vector<cv::Vec3b>& colors, Clock::time_point captureTime, Clock::time_point now);
+	void update(Clock::time_point now);
+	void getColors(std::vector<cv::Vec3b>& colors) const;
+	void reset() { m_hasTarget = false; } // <- The next target is taken over right away, nothing to interpolate from
+
+	// Getters & setters
+	size_t getLedCount() const { return m_current.size() / 3; }
+	const std::vector<uint16_t>& getCurrent() const { return m_current; } // <- 8.8 fixed-point, B G R per led
+
+private:
+	// Members
+	float m_smoothingTimeMS;
+	bool m_interpolate; // <- When false the target is used right away (only smoothing)
+
+	std::vector<uint16_t> m_previous; // <- Where the interpolation started
+	std::vector<uint16_t> m_target; // <- The newest analysed colors
+	std::vector<uint16_t> m_interpolated; // <- Between m_previous and m_target
+	std::vector<uint16_t> m_current; // <- m_interpolated after smoothing, the output
+
+	Clock::time_point m_targetCaptureTime;
+	Clock::time_point m_targetArrivalTime;
+	Clock::duration m_frameInterval = std::chrono::milliseconds(33);
+	Clock::time_point m_lastUpdateTime;
+	bool m_hasTarget = false;
+};
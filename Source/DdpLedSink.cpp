@@ -0,0 +1,196 @@
+#include "DdpLedSink.h"
+#include "Metrics.h"
+#include "Logger.h"
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+static constexpr uint8_t FLAG_VERSION_1 = 0x40;
+static constexpr uint8_t FLAG_PUSH = 0x01;
+static constexpr uint8_t DATA_TYPE_RGB_8 = 0x0B; // <- Type RGB (001), 8 bits per channel (011)
+static constexpr uint8_t DATA_TYPE_RGBW_8 = 0x1B; // <- Type RGBW (011), 8 bits per channel (011)
+static constexpr uint8_t DESTINATION_DISPLAY = 0x01;
+
+DdpLedSink::DdpLedSink(std::string host, int port, bool rgbw, Clock::duration fullFrameInterval)
+	: m_host(host), m_port(port), m_rgbw(rgbw), m_bytesPerLed(rgbw ? 4 : 3), m_fullFrameInterval(fullFrameInterval) {
+	m_packet.reserve(HEADER_SIZE + MAX_DATA_SIZE);
+}
+
+DdpLedSink::~DdpLedSink() {
+	this->fini();
+}
+
+/// <summary>
+/// Looks up the receiver, opens the UDP socket and starts the send thread.
+/// </summary>
+/// <returns>If the receiver is found and the socket is open</returns>
+bool DdpLedSink::init() {
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	addrinfo* addresses = nullptr;
+	int result = getaddrinfo(m_host.c_str(), std::to_string(m_port).c_str(), &hints, &addresses);
+	if (result != 0 || addresses == nullptr) {
+		LOG_ERROR("Can't find DDP receiver " << m_host << ": " << gai_strerror(result));
+		return false;
+	}
+	std::memcpy(&m_address, addresses->ai_addr, sizeof(m_address));
+	freeaddrinfo(addresses);
+
+	m_socket = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (m_socket == -1) {
+		LOG_ERROR("Can't create the DDP socket: " << std::strerror(errno));
+		return false;
+	}
+
+	m_sentColors.clear();
+	m_nextFullFrameTime = Clock::now();
+
+	m_running = true;
+	m_thread = std::thread(&DdpLedSink::sendLoop, this);
+
+	LOG_INFO("Sending the led colors with DDP to " << m_host << ":" << m_port);
+	return true;
+}
+
+/// <summary>
+/// Hands the colors to the send thread, never waits on the network.
+/// </summary>
+/// <returns>If the sink is initialized</returns>
+bool DdpLedSink::render(const std::vector<uint32_t>& ledColors) {
+	if (!m_running) return false;
+
+	m_frames.back() = ledColors; // <- Copied into the vector of the slot, it only allocates the first time
+	bool droppedFrame = m_frames.publish();
+	if (droppedFrame) getMetrics().networkDroppedFrames.fetch_add(1, std::memory_order_relaxed);
+
+	return true;
+}
+
+/// <summary>
+/// Stops the send thread, turns off the leds of the receiver and closes the socket.
+/// </summary>
+void DdpLedSink::fini() {
+	if (m_thread.joinable()) {
+		m_running = false;
+		m_frames.wakeUp();
+		m_thread.join();
+	}
+
+	if (m_socket == -1) return;
+
+	if (!m_sentColors.empty()) {
+		this->sendFrame(std::vector<uint32_t>(m_sentColors.size(), 0), true);
+	}
+
+	::close(m_socket);
+	m_socket = -1;
+}
+
+void DdpLedSink::sendLoop() {
+	while (m_frames.waitForUpdate(m_running)) {
+		const Clock::time_point now = Clock::now();
+
+		bool fullFrame = now >= m_nextFullFrameTime || m_frames.front().size() != m_sentColors.size();
+		if (fullFrame) m_nextFullFrameTime = now + m_fullFrameInterval;
+
+		this->sendFrame(m_frames.front(), fullFrame);
+	}
+}
+
+/// <summary>
+/// Sends the leds that changed since the last send (or all leds), the last packet pushes the frame.
+/// </summary>
+/// <param name="fullFrame">Sends all leds, not only the changed ones</param>
+void DdpLedSink::sendFrame(const std::vector<uint32_t>& ledColors, bool fullFrame) {
+	// Collect the changed ranges first, only then it is known which packet is the last
+	m_ranges.clear();
+	if (fullFrame) {
+		m_ranges.emplace_back(0, ledColors.size());
+	}
+	else {
+		for (size_t i = 0; i < ledColors.size(); i++) {
+			if (ledColors[i] == m_sentColors[i]) continue;
+
+			if (!m_ranges.empty() && i - (m_ranges.back().first + m_ranges.back().second) <= MERGE_GAP_LEDS) {
+				m_ranges.back().second = i + 1 - m_ranges.back().first;
+			}
+			else {
+				m_ranges.emplace_back(i, 1);
+			}
+		}
+	}
+	if (m_ranges.empty()) return;
+
+	const size_t maxLedsPerPacket = MAX_DATA_SIZE / m_bytesPerLed;
+	for (size_t r = 0; r < m_ranges.size(); r++) {
+		const auto [firstLed, ledCount] = m_ranges[r];
+
+		for (size_t sent = 0; sent < ledCount; sent += maxLedsPerPacket) {
+			const size_t packetLedCount = std::min(maxLedsPerPacket, ledCount - sent);
+			const bool push = (r + 1 == m_ranges.size() && sent + packetLedCount == ledCount);
+			this->sendPacket(ledColors, firstLed + sent, packetLedCount, push);
+		}
+	}
+
+	m_sentColors = ledColors;
+	m_sentFrameCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Sends one DDP packet with the colors of the given leds.
+/// </summary>
+/// <param name="push">Tells the receiver to show the frame, set on the last packet of a frame</param>
+/// <returns>If the packet is sent</returns>
+bool DdpLedSink::sendPacket(const std::vector<uint32_t>& ledColors, size_t firstLed, size_t ledCount, bool push) {
+	const uint32_t offset = (uint32_t)(firstLed * m_bytesPerLed);
+	const uint16_t length = (uint16_t)(ledCount * m_bytesPerLed);
+
+	m_packet.resize(HEADER_SIZE + length);
+	uint8_t* header = m_packet.data();
+	header[0] = FLAG_VERSION_1 | (push ? FLAG_PUSH : 0);
+	header[1] = m_sequence = (uint8_t)(m_sequence % 15 + 1); // <- 1 - 15, 0 means the receiver doesn't check the sequence
+	header[2] = m_rgbw ? DATA_TYPE_RGBW_8 : DATA_TYPE_RGB_8;
+	header[3] = DESTINATION_DISPLAY;
+	header[4] = (uint8_t)(offset >> 24);
+	header[5] = (uint8_t)(offset >> 16);
+	header[6] = (uint8_t)(offset >> 8);
+	header[7] = (uint8_t)offset;
+	header[8] = (uint8_t)(length >> 8);
+	header[9] = (uint8_t)length;
+
+	// The colors are packed as 0xWWBBGGRR (see BGRToWRGBHex), DDP sends R, G, B (, W)
+	uint8_t* data = header + HEADER_SIZE;
+	for (size_t i = firstLed; i < firstLed + ledCount; i++) {
+		const uint32_t color = ledColors[i];
+		const uint8_t white = (uint8_t)(color >> 24);
+		if (m_rgbw) {
+			*data++ = (uint8_t)color;
+			*data++ = (uint8_t)(color >> 8);
+			*data++ = (uint8_t)(color >> 16);
+			*data++ = white;
+		}
+		else {
+			// The colors are corrected for a RGBW strip (STRIP_HAS_WHITE), a RGB receiver gets the white back on its 3 channels
+			*data++ = (uint8_t)std::min<uint32_t>(255, (color & 0xFF) + white);
+			*data++ = (uint8_t)std::min<uint32_t>(255, ((color >> 8) & 0xFF) + white);
+			*data++ = (uint8_t)std::min<uint32_t>(255, ((color >> 16) & 0xFF) + white);
+		}
+	}
+
+	ssize_t sent = sendto(m_socket, m_packet.data(), m_packet.size(), 0, (const sockaddr*)&m_address, sizeof(m_address));
+	if (sent != (ssize_t)m_packet.size()) {
+		LOG_WARNING("Can't send DDP packet to " << m_host << ": " << std::strerror(errno));
+		return false;
+	}
+
+	m_sentPacketCount.fetch_add(1, std::memory_order_relaxed);
+	getMetrics().networkPackets.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <utility>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <netinet/in.h>
+
+#include "LedSink.h"
+#include "TripleBuffer.h"
+
+/// <summary>
+/// A LedSink that sends the led colors over UDP with DDP (Distributed Display Protocol, port 4048),
+/// to drive led controllers elsewhere on the network (WLED, ESPixelStick, xLights, ...).
+///
+/// A render only hands the colors to the send thread (through a triple buffer), so a slow or stalled network never delays the other outputs.
+/// The send thread sends the newest colors as soon as they are rendered, so it follows the render clock, and skips colors it couldn't keep up with.
+/// Only the ranges of leds that changed since the last send are sent (ranges close to each other are merged, a header costs more than a few leds),
+/// split in packets that fit in one ethernet frame. The last packet of a frame has the push flag, so the receiver shows the frame at once.
+/// Every fullFrameInterval all leds are sent, so a receiver that restarted or lost a packet is back in sync.
+///
+/// Packet layout (big endian): flags (version 1, push), sequence (1 - 15), data type (RGB or RGBW, 8 bits), destination (1: display),
+/// byte offset of the first led (uint32), data length (uint16), then the colors.
+/// </summary>
+class DdpLedSink : public LedSink
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr int DEFAULT_PORT = 4048;
+	static constexpr size_t HEADER_SIZE = 10;
+	static constexpr size_t MAX_DATA_SIZE = 1440; // <- 1500 MTU - 28 (IP + UDP) - 10 (DDP), rounded down to whole RGB and RGBW leds
+	static constexpr size_t MERGE_GAP_LEDS = 16; // <- Unchanged leds between two changed ranges that are sent anyway, cheaper than a new packet
+
+	// Constructor
+	DdpLedSink(std::string host, int port, bool rgbw, Clock::duration fullFrameInterval);
+	~DdpLedSink();
+
+	// Methods
+	bool init() override;
+	bool render(const std::vector<uint32_t>& ledColors) override;
+	void fini() override;
+
+	// Getters & setters
+	const char* getName() const override { return "ddp"; }
+	uint64_t getSentPacketCount() const { return m_sentPacketCount; }
+	uint64_t getSentFrameCount() const { return m_sentFrameCount; }
+
+private:
+	// Methods
+	void sendLoop();
+	void sendFrame(const std::vector<uint32_t>& ledColors, bool fullFrame);
+	bool sendPacket(const std::vector<uint32_t>& ledColors, size_t firstLed, size_t ledCount, bool push);
+
+	// Members
+	std::string m_host;
+	int m_port;
+	bool m_rgbw;
+	size_t m_bytesPerLed;
+	Clock::duration m_fullFrameInterval;
+
+	int m_socket = -1;
+	sockaddr_in m_address = {};
+
+	TripleBuffer<std::vector<uint32_t>> m_frames; // <- Render -> send thread
+	std::thread m_thread;
+	std::atomic<bool> m_running = false;
+
+	// Only used by the send thread
+	std::vector<uint32_t> m_sentColors;
+	std::vector<std::pair<size_t, size_t>> m_ranges; // <- First led and led count of every changed range
+	std::vector<uint8_t> m_packet;
+	uint8_t m_sequence = 0;
+	Clock::time_point m_nextFullFrameTime;
+
+	std::atomic<uint64_t> m_sentPacketCount = 0;
+	std::atomic<uint64_t> m_sentFrameCount = 0;
+};
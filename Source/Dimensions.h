@@ -9,11 +9,11 @@ struct Dimensions {
 	int width;
 	int height;
 
-	bool operator==(const Dimensions& value) {
+	bool operator==(const Dimensions& value) const {
 		return width == value.width && height == value.height;
 	}
 
-	bool equals(cv::Mat value) {
+	bool equals(const cv::Mat& value) const {
 		return width == value.cols && height == value.rows;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,287 @@
+#include "DominantColorReducer.h"
+#include "BorderReducer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+static_assert(DominantColorReducer::BITS_PER_CHANNEL == 4, "toBin takes the top 4 bits of every channel");
+
+/// <summary>
+/// The histogram bin of a packed sample (0x00CCBBAA): the top 4 bits of every channel.
+/// </summary>
+static inline int toBin(uint32_t sample) {
+	return (int)(((sample >> 4) & 0x00F) | ((sample >> 8) & 0x0F0) | ((sample >> 12) & 0xF00));
+}
+
+/// <summary>
+/// Reads the channels of a pixel (B, G, R or Y, U, V) packed as 0x00CCBBAA, the 16 bit formats with their high byte.
+/// </summary>
+/// <param name="row">The row of the pixel (the Y row for NV12 and P010)</param>
+/// <param name="uvRow">The UV row of the pixel, only for NV12 and P010</param>
+template<PixelFormat FORMAT>
+static inline uint32_t readSample(const SampleType<FORMAT>* row, const SampleType<FORMAT>* uvRow, int x) {
+	constexpr int SHIFT = isHighBitDepth(FORMAT) ? 8 : 0;
+
+	if constexpr (getLayout(FORMAT) == PixelFormat::BGR) {
+		const SampleType<FORMAT>* pixel = row + x * 3;
+		return (pixel[0] >> SHIFT) | ((pixel[1] >> SHIFT) << 8) | ((pixel[2] >> SHIFT) << 16);
+	}
+	else if constexpr (getLayout(FORMAT) == PixelFormat::YUYV) {
+		const SampleType<FORMAT>* pair = row + (x & ~1) * 2; // <- Y0 U Y1 V
+		return (row[x * 2] >> SHIFT) | ((pair[1] >> SHIFT) << 8) | ((pair[3] >> SHIFT) << 16);
+	}
+	else {
+		const SampleType<FORMAT>* uv = uvRow + (x & ~1);
+		return (row[x] >> SHIFT) | ((uv[0] >> SHIFT) << 8) | ((uv[1] >> SHIFT) << 16);
+	}
+}
+
+/// <summary>
+/// The average of the summed (8 bit) channels. The 16 bit formats were read with their high byte,
+/// the sums are scaled to 10 bits so the average can still be tone mapped.
+/// </summary>
+template<PixelFormat FORMAT>
+static inline cv::Vec3b calculateSampleAverage(uint64_t sums[3], uint64_t count, const ToneMapper& toneMapper) {
+	if constexpr (isHighBitDepth(FORMAT)) {
+		for (int c = 0; c < 3; c++) sums[c] <<= 16 - HIGH_BIT_DEPTH_SHIFT - 8;
+	}
+	return calculateAverageColor(sums, count, FORMAT, toneMapper);
+}
+
+/// <summary>
+/// Places the sample grid in every zone (clipped to the frame), centered in the zone.
+/// Everything is counted again on the next reduce.
+/// </summary>
+/// <param name="sampleStep">Only every this many columns and rows are sampled, grows for zones that would get more than MAX_SAMPLES_PER_ZONE</param>
+/// <param name="rowStride">The rows are sampled rowStride times further apart, see QualityGovernor</param>
+void DominantColorReducer::build(const std::vector<cv::Rect>& zoneRects, Dimensions frameDimensions, int sampleStep, int rowStride) {
+	const cv::Rect frameRect(0, 0, frameDimensions.width, frameDimensions.height);
+	m_frameDimensions = frameDimensions;
+
+	m_zones.clear();
+	int sampleCount = 0;
+	for (const cv::Rect& zoneRect : zoneRects) {
+		const cv::Rect rect = zoneRect & frameRect;
+
+		int step = std::max(sampleStep, 1);
+		int columns = 0, rows = 0;
+		while (true) {
+			columns = (rect.width + step - 1) / step;
+			rows = (rect.height + step * rowStride - 1) / (step * rowStride);
+			if ((int64_t)columns * rows <= MAX_SAMPLES_PER_ZONE) break;
+			step++;
+		}
+
+		Zone zone;
+		zone.columnStep = step;
+		zone.rowStep = step * std::max(rowStride, 1);
+		zone.x0 = rect.x + (rect.width > 0 ? (rect.width - 1) % zone.columnStep / 2 : 0);
+		zone.x1 = rect.x + rect.width;
+		zone.y0 = rect.y + (rect.height > 0 ? (rect.height - 1) % zone.rowStep / 2 : 0);
+		zone.y1 = rect.y + rect.height;
+		zone.sampleBegin = sampleCount;
+		zone.sampleEnd = sampleCount += columns * rows;
+		zone.dominantBin = 0;
+		zone.dominantRank = 0;
+		m_zones.push_back(zone);
+	}
+
+	m_histograms.assign(m_zones.size() * BIN_COUNT, 0);
+	m_samples.assign(sampleCount, 0);
+	m_rebuild = true;
+}
+
+/// <summary>
+/// Weights every bin by the saturation of the color at its center: 1 for grey, 1 + saturationWeight for a fully saturated color.
+/// The saturation is the chroma (max - min of B, G, R), or the distance of U and V from grey.
+/// </summary>
+void DominantColorReducer::buildBinWeights(PixelFormat format) {
+	for (int bin = 0; bin < BIN_COUNT; bin++) {
+		const int c0 = ((bin & 0xF) << 4) + 8;
+		const int c1 = (((bin >> 4) & 0xF) << 4) + 8;
+		const int c2 = (((bin >> 8) & 0xF) << 4) + 8;
+
+		int chroma;
+		if (getLayout(format) == PixelFormat::BGR) {
+			chroma = std::max({ c0, c1, c2 }) - std::min({ c0, c1, c2 });
+		}
+		else {
+			chroma = std::min(255, 2 * std::max(std::abs(c1 - 128), std::abs(c2 - 128)));
+		}
+
+		const float weight = 256.0f * (1.0f + m_saturationWeight * chroma / 255.0f);
+		m_binWeights[bin] = (uint16_t)std::clamp(weight, 1.0f, (float)UINT16_MAX);
+	}
+
+	m_weightsFormat = format;
+	m_weightsFormatValid = true;
+}
+
+/// <summary>
+/// Calculates the dominant color of the (dirty) zones and puts it in the colors.
+/// </summary>
+/// <param name="frame">Frame with the dimensions the reducer was build for</param>
+/// <param name="colors">Gets resized to the zone count, the clean zones keep their color</param>
+/// <param name="format">The pixel format of the frame</param>
+/// <param name="dirtyZones">Optional, only the zones that are 1 are calculated</param>
+void DominantColorReducer::reduce(const cv::Mat& frame, std::vector<cv::Vec3b>& colors, PixelFormat format,
+	const std::vector<uint8_t>* dirtyZones) {
+	assert(dirtyZones == nullptr || dirtyZones->size() == m_zones.size());
+
+	// The kept samples (and the weights) are of another pixel format
+	if (format != m_lastFormat) {
+		m_lastFormat = format;
+		m_rebuild = true;
+	}
+	if (!m_weightsFormatValid || m_weightsFormat != format) {
+		this->buildBinWeights(format);
+		m_rebuild = true;
+	}
+
+	colors.resize(m_zones.size());
+	for (size_t i = 0; i < m_zones.size(); i++) {
+		if (!m_rebuild && dirtyZones && !(*dirtyZones)[i]) continue;
+
+		switch (format) {
+		case PixelFormat::BGR:
+			assert(frame.type() == CV_8UC3 && m_frameDimensions.equals(frame));
+			this->reduceZone<PixelFormat::BGR>(frame, i, colors[i]);
+			break;
+
+		case PixelFormat::YUYV:
+			assert(frame.type() == CV_8UC2 && m_frameDimensions.equals(frame));
+			this->reduceZone<PixelFormat::YUYV>(frame, i, colors[i]);
+			break;
+
+		case PixelFormat::NV12:
+			assert(frame.type() == CV_8UC1 && frame.rows == m_frameDimensions.height * 3 / 2);
+			this->reduceZone<PixelFormat::NV12>(frame, i, colors[i]);
+			break;
+
+		case PixelFormat::BGR16:
+			assert(frame.type() == CV_16UC3 && m_frameDimensions.equals(frame));
+			this->reduceZone<PixelFormat::BGR16>(frame, i, colors[i]);
+			break;
+
+		case PixelFormat::Y210:
+			assert(frame.type() == CV_16UC2 && m_frameDimensions.equals(frame));
+			this->reduceZone<PixelFormat::Y210>(frame, i, colors[i]);
+			break;
+
+		case PixelFormat::P010:
+			assert(frame.type() == CV_16UC1 && frame.rows == m_frameDimensions.height * 3 / 2);
+			this->reduceZone<PixelFormat::P010>(frame, i, colors[i]);
+			break;
+		}
+	}
+
+	m_rebuild = false;
+}
+
+/// <summary>
+/// The count of a bin times its weight, with the lower bin winning a tie. No 2 bins get the same rank,
+/// so the incremental search ends on the exact same bin as a search of the whole histogram.
+/// </summary>
+inline uint64_t DominantColorReducer::getRank(const uint16_t* histogram, int bin) const {
+	return ((uint64_t)histogram[bin] * m_binWeights[bin] << (3 * BITS_PER_CHANNEL)) | (uint64_t)(BIN_COUNT - 1 - bin);
+}
+
+/// <summary>
+/// Samples a zone, updates its histogram with the samples that moved to another bin and picks the dominant bin.
+///
+/// The dominant bin is followed while counting: the bin that grew the highest becomes the dominant one when it passes the rank the dominant bin had.
+/// Only when the dominant bin shrank and no bin took its place the histogram has to be searched again.
+/// </summary>
+template<PixelFormat FORMAT>
+void DominantColorReducer::reduceZone(const cv::Mat& frame, size_t zoneIndex, cv::Vec3b& color) {
+	Zone& zone = m_zones[zoneIndex];
+	const int sampleCount = zone.sampleEnd - zone.sampleBegin;
+	if (sampleCount == 0) {
+		color = cv::Vec3b(0, 0, 0);
+		return;
+	}
+
+	uint16_t* histogram = m_histograms.data() + zoneIndex * BIN_COUNT;
+	uint32_t* samples = m_samples.data() + zone.sampleBegin;
+	if (m_rebuild) std::fill(histogram, histogram + BIN_COUNT, 0);
+
+	// The bin that grew the highest, it becomes the dominant one when it passes the rank the dominant bin had
+	const uint64_t previousRank = m_rebuild ? UINT64_MAX : zone.dominantRank;
+	int grownBin = zone.dominantBin;
+	uint64_t grownRank = 0;
+
+	uint64_t sums[3] = {};
+	uint32_t* sample = samples;
+	for (int y = zone.y0; y < zone.y1; y += zone.rowStep) {
+		const SampleType<FORMAT>* row = frame.ptr<SampleType<FORMAT>>(y);
+		const SampleType<FORMAT>* uvRow = (getLayout(FORMAT) == PixelFormat::NV12) ? frame.ptr<SampleType<FORMAT>>(m_frameDimensions.height + y / 2) : nullptr;
+
+		for (int x = zone.x0; x < zone.x1; x += zone.columnStep, sample++) {
+			const uint32_t value = readSample<FORMAT>(row, uvRow, x);
+			sums[0] += value & 0xFF;
+			sums[1] += (value >> 8) & 0xFF;
+			sums[2] += value >> 16;
+
+			if (m_rebuild) {
+				histogram[toBin(value)]++;
+				*sample = value;
+				continue;
+			}
+			if (value == *sample) continue;
+
+			const int bin = toBin(value);
+			const int oldBin = toBin(*sample);
+			*sample = value;
+			if (bin == oldBin) continue;
+
+			histogram[oldBin]--;
+			histogram[bin]++;
+			const uint64_t rank = this->getRank(histogram, bin);
+			if (rank > grownRank) {
+				grownBin = bin;
+				grownRank = rank;
+			}
+		}
+	}
+
+	// The bins that didn't grow rank below the previous rank of the dominant bin, and the grown ones at most as high as the grown bin got.
+	// So the histogram only has to be searched again when neither the dominant nor the grown bin (still) reaches both
+	const uint64_t dominantRank = this->getRank(histogram, zone.dominantBin);
+	const uint64_t finalGrownRank = this->getRank(histogram, grownBin); // <- Could have shrunk again after it grew
+	const uint64_t bestRank = std::max(dominantRank, finalGrownRank);
+	if (bestRank >= previousRank && bestRank >= grownRank) {
+		if (finalGrownRank > dominantRank) zone.dominantBin = grownBin;
+		zone.dominantRank = bestRank;
+	}
+	else {
+		zone.dominantRank = 0;
+		for (int bin = 0; bin < BIN_COUNT; bin++) {
+			const uint64_t rank = this->getRank(histogram, bin);
+			if (rank > zone.dominantRank) {
+				zone.dominantBin = bin;
+				zone.dominantRank = rank;
+			}
+		}
+		m_rescanCount++;
+	}
+
+	// No color stands out, the mean is better than a slice of a gradient
+	const int dominantCount = histogram[zone.dominantBin];
+	if (dominantCount == 0 || dominantCount < m_minShare * sampleCount) {
+		color = calculateSampleAverage<FORMAT>(sums, sampleCount, *m_toneMapper);
+		return;
+	}
+
+	// The mean of the samples in the dominant bin, not the center of the bin (that would step between the bins)
+	uint64_t binSums[3] = {};
+	for (int i = 0; i < sampleCount; i++) {
+		const uint32_t value = samples[i];
+		if (toBin(value) != zone.dominantBin) continue;
+
+		binSums[0] += value & 0xFF;
+		binSums[1] += (value >> 8) & 0xFF;
+		binSums[2] += value >> 16;
+	}
+	color = calculateSampleAverage<FORMAT>(binSums, dominantCount, *m_toneMapper);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "Dimensions.h"
+#include "PixelFormat.h"
+#include "ToneMapper.h"
+
+/// <summary>
+/// What color a zone gets.
+/// </summary>
+enum class ZoneColorMode {
+	AVERAGE, // <- The (weighted) mean of its pixels, see BorderReducer and WeightedReducer
+	DOMINANT // <- The most common color, see DominantColorReducer
+};
+
+/// <summary>
+/// Calculates the dominant color of a set of zones, instead of the average.
+/// A zone with a red logo on grey gets red instead of a muddy mix of the two, and a small bright object doesn't tint the whole zone.
+///
+/// Every zone is sampled on a grid (every sampleStep pixels and rows) and the samples are counted in a coarse histogram,
+/// 4 bits per channel (4096 bins) of B, G, R or Y, U, V (of the high byte for the 16 bit formats). The bins are weighted by their saturation,
+/// so a colorful bin wins from a grey one that is a bit bigger. The zone gets the mean of the samples in the winning bin.
+/// The mean of all samples is summed in the same pass, it is used when no bin holds at least minShare of the samples (a gradient or noise).
+///
+/// The samples of the last frame are kept, so the histogram of a zone is updated incrementally:
+/// only the samples that moved to another bin are counted again and the histogram is never cleared.
+/// Zones the dirty mask marks as clean are skipped completely and keep their color.
+/// </summary>
+class DominantColorReducer
+{
+public:
+	static constexpr int BITS_PER_CHANNEL = 4;
+	static constexpr int BIN_COUNT = 1 << (3 * BITS_PER_CHANNEL);
+	static constexpr int MAX_SAMPLES_PER_ZONE = UINT16_MAX; // <- The bins are 16 bits, the sample step grows for bigger zones
+
+	// Methods
+	void build(const std::vector<cv::Rect>& zoneRects, Dimensions frameDimensions, int sampleStep, int rowStride = 1);
+	void reduce(const cv::Mat& frame, std::vector<cv::Vec3b>& colors, PixelFormat format = PixelFormat::BGR,
+		const std::vector<uint8_t>* dirtyZones = nullptr);
+
+	// Getters & setters
+	size_t getZoneCount() const { return m_zones.size(); }
+	void setSaturationWeight(float value) { m_saturationWeight = value; m_weightsFormatValid = false; }
+	void setMinShare(float value) { m_minShare = value; }
+	void setToneMapper(const ToneMapper& toneMapper) { m_toneMapper = &toneMapper; }
+	uint64_t getRescanCount() const { return m_rescanCount; }
+
+private:
+	struct Zone {
+		int x0; // First sampled column (inclusive)
+		int x1; // Last column (exclusive)
+		int y0; // First sampled row (inclusive)
+		int y1; // Last row (exclusive)
+		int columnStep; // Between the sampled columns
+		int rowStep; // Between the sampled rows
+		int sampleBegin; // Range in m_samples
+		int sampleEnd;
+		int dominantBin;
+		uint64_t dominantRank; // See getRank
+	};
+
+	// Methods
+	void buildBinWeights(PixelFormat format);
+	uint64_t getRank(const uint16_t* histogram, int bin) const;
+	template<PixelFormat FORMAT>
+	void reduceZone(const cv::Mat& frame, size_t zoneIndex, cv::Vec3b& color);
+
+	// Members
+	std::vector<Zone> m_zones;
+	std::vector<uint16_t> m_histograms; // <- BIN_COUNT per zone
+	std::vector<uint32_t> m_samples; // <- Grouped per zone, the channels of the last frame packed as 0x00CCBBAA (B, G, R or Y, U, V)
+	Dimensions m_frameDimensions;
+
+	std::array<uint16_t, BIN_COUNT> m_binWeights = {}; // <- 256 is a weight of 1
+	PixelFormat m_weightsFormat = PixelFormat::BGR;
+	bool m_weightsFormatValid = false;
+	float m_saturationWeight = 2.0f;
+	float m_minShare = 0.1f;
+	const ToneMapper* m_toneMapper = &getToneMapper(); // <- Only for the 16 bit formats
+
+	bool m_rebuild = true; // <- The samples and histograms don't belong to the frames anymore
+	PixelFormat m_lastFormat = PixelFormat::BGR;
+	uint64_t m_rescanCount = 0; // <- Times the histogram of a zone was searched for the dominant bin again
+};
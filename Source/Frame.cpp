@@ -0,0 +1,45 @@
+#include "Frame.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+/// <summary>
+/// Converts the full frame to BGR.
+/// Note: this is slow on a Pi, only use it for debugging. The zone averages don't need it.
+/// </summary>
+/// <param name="frame">Frame to convert</param>
+/// <param name="bgrImage">Output, points to the image of the frame when it already is BGR</param>
+void convertToBGR(const Frame& frame, cv::Mat& bgrImage) {
+	switch (frame.format) {
+	case PixelFormat::BGR:
+		bgrImage = frame.image;
+		break;
+
+	case PixelFormat::YUYV:
+		cv::cvtColor(frame.image, bgrImage, cv::COLOR_YUV2BGR_YUYV);
+		break;
+
+	case PixelFormat::NV12:
+		cv::cvtColor(frame.image, bgrImage, cv::COLOR_YUV2BGR_NV12);
+		break;
+
+	// The high byte of the 16 bit formats, without tone mapping
+	case PixelFormat::BGR16:
+		frame.image.convertTo(bgrImage, CV_8U, 1.0 / 256.0);
+		break;
+
+	case PixelFormat::Y210: {
+		cv::Mat yuyvImage;
+		frame.image.convertTo(yuyvImage, CV_8U, 1.0 / 256.0);
+		cv::cvtColor(yuyvImage, bgrImage, cv::COLOR_YUV2BGR_YUYV);
+		break;
+	}
+
+	case PixelFormat::P010: {
+		cv::Mat nv12Image;
+		frame.image.convertTo(nv12Image, CV_8U, 1.0 / 256.0);
+		cv::cvtColor(nv12Image, bgrImage, cv::COLOR_YUV2BGR_NV12);
+		break;
+	}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <memory>
+#include <chrono>
+#include <algorithm>
+
+#include <opencv2/core.hpp>
+
+#include "Dimensions.h"
+#include "PixelFormat.h"
+
+/// <summary>
+/// A captured frame together with its pixel format.
+/// The image can point straight into the buffer of the capture driver (zero-copy),
+/// in that case the bufferLease keeps the driver from reusing the buffer.
+/// The buffer is given back as soon as the last copy of the lease is gone.
+/// </summary>
+struct Frame {
+	cv::Mat image;
+	PixelFormat format = PixelFormat::BGR;
+	std::shared_ptr<void> bufferLease;
+	std::chrono::steady_clock::time_point timestamp; // <- When the frame was captured
+	cv::Rect contentRect; // <- Only set by a replay: the content rect the frame was recorded with, the letterbox detection is skipped
+
+	bool empty() const {
+		return image.empty();
+	}
+
+	/// <summary>
+	/// The dimensions in pixels (not the dimensions of the image, NV12 and P010 have 1.5 times the rows).
+	/// </summary>
+	Dimensions getDimensions() const {
+		int height = (getLayout(format) == PixelFormat::NV12 ? image.rows * 2 / 3 : image.rows);
+		return Dimensions(image.cols, height);
+	}
+
+	/// <summary>
+	/// Gives the driver buffer back (if any) and empties the frame.
+	/// </summary>
+	void release() {
+		image.release();
+		bufferLease.reset();
+		contentRect = cv::Rect();
+	}
+};
+
+void convertToBGR(const Frame& frame, cv::Mat& bgrImage);
+
+/// <summary>
+/// The brightness of a pixel, for YUV the Y and for BGR the brightest channel. 0 - 255, the 16 bit formats give their high byte.
+/// </summary>
+inline int getBrightness(const cv::Mat& image, PixelFormat format, int x, int y) {
+	const uchar* row = image.ptr<uchar>(y);
+	const uint16_t* wideRow = image.ptr<uint16_t>(y);
+
+	switch (format) {
+	case PixelFormat::BGR: return std::max({ row[x * 3], row[x * 3 + 1], row[x * 3 + 2] });
+	case PixelFormat::YUYV: return row[x * 2];
+	case PixelFormat::NV12: return row[x];
+	case PixelFormat::BGR16: return std::max({ wideRow[x * 3], wideRow[x * 3 + 1], wideRow[x * 3 + 2] }) >> 8;
+	case PixelFormat::Y210: return wideRow[x * 2] >> 8;
+	case PixelFormat::P010: return wideRow[x] >> 8;
+	}
+	return 0;
+}
@@ -0,0 +1,39 @@
+#include "FrameSource.h"
+#include "OpenCvFrameSource.h"
+#include "const_config.h"
+
+#ifdef __linux__
+#include "V4l2FrameSource.h"
+#include "RawFileFrameSource.h"
+#include "ReplayFrameSource.h"
+#endif
+
+#include <memory>
+
+/// <summary>
+/// Creates the FrameSource of the given type.
+/// </summary>
+/// <returns>The created FrameSource or nullptr if the type is not available on this platform</returns>
+std::unique_ptr<FrameSource> createFrameSource(FrameSourceType type) {
+	switch (type) {
+	case FrameSourceType::OPENCV:
+		return std::make_unique<OpenCvFrameSource>(Config::VIDEO_CAPTURE_INDEX);
+
+#ifdef __linux__
+	case FrameSourceType::V4L2:
+		return std::make_unique<V4l2FrameSource>(Config::V4L2_DEVICE_PATH, Config::V4L2_PIXEL_FORMAT, Config::V4L2_BUFFER_COUNT);
+
+	case FrameSourceType::RAW_FILE:
+		return std::make_unique<RawFileFrameSource>(
+			Config::RAW_FILE_PATH, Config::RAW_FILE_DIMENSIONS, Config::RAW_FILE_PIXEL_FORMAT, Config::RAW_FILE_FPS
+		);
+
+	case FrameSourceType::REPLAY:
+		return std::make_unique<ReplayFrameSource>(Config::REPLAY_FILE_PATH, Config::REPLAY_REAL_TIME);
+#endif
+
+	default:
+		LOG_INFO("The given FrameSourceType is not available on this platform.");
+		return nullptr;
+	}
+}
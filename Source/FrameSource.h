@@ -0,0 +1,58 @@
+#pragma once
+#include <memory>
+
+#include "Frame.h"
+
+enum class FrameSourceType {
+	OPENCV, // <- cv::VideoCapture, converts every frame to BGR
+	V4L2, // <- Straight from the V4L2 driver, no copies and no color conversion (linux only)
+	RAW_FILE, // <- Raw frames from a file, stand-in for a capture card
+	REPLAY // <- The border strips of a BorderRecorder, plays back what the zones sampled (linux only)
+};
+
+/// <summary>
+/// The input the frames are read from (the capture card).
+/// The rest of the program only talks to this, so it doesn't care how the frames are captured.
+/// </summary>
+class FrameSource
+{
+public:
+	virtual ~FrameSource() = default;
+
+	// Methods
+
+	/// <summary>
+	/// Opens (or reopens) the source.
+	/// </summary>
+	/// <returns>If the source is ready to read frames</returns>
+	virtual bool open() = 0;
+
+	/// <summary>
+	/// Releases the source. Frames that are still in use stay valid.
+	/// </summary>
+	virtual void close() = 0;
+
+	/// <summary>
+	/// Reads the next frame, blocks until there is one.
+	/// The frame that is passed in is released first, so its buffer can be reused.
+	/// </summary>
+	/// <returns>If it could read a frame</returns>
+	virtual bool read(Frame& frame) = 0;
+
+	// Getters & setters
+	virtual bool isOpened() const = 0;
+	virtual const char* getName() const = 0;
+
+	/// <summary>
+	/// The device node the source reads from, used to see if the device is still there. nullptr when there is none.
+	/// </summary>
+	virtual const char* getDevicePath() const { return nullptr; }
+
+	/// <summary>
+	/// If the last failed read only timed out (no signal, the TV or the HDMI source is off) while the source is still streaming.
+	/// It can be read again without reopening it, the next frame comes as soon as the signal is back.
+	/// </summary>
+	virtual bool isWaitingForSignal() const { return false; }
+};
+
+std::unique_ptr<FrameSource> createFrameSource(FrameSourceType type);
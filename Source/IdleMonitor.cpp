@@ -0,0 +1,69 @@
+#include "IdleMonitor.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+IdleMonitor::IdleMonitor(int blackLevel, Clock::duration blackTime, Clock::duration probeInterval)
+	: m_blackLevel(blackLevel), m_blackTime(blackTime), m_probeInterval(probeInterval) { }
+
+/// <summary>
+/// Checks the averages of a analysed frame, goes idle when all zones were black for the black time.
+/// </summary>
+/// <param name="zoneColors">The zone averages (BGR) of the frame</param>
+/// <returns>If it is idle now, the frames after this one are only probed</returns>
+bool IdleMonitor::update(const std::vector<cv::Vec3b>& zoneColors, Clock::time_point now) {
+	const bool black = std::all_of(zoneColors.begin(), zoneColors.end(),
+		[this](const cv::Vec3b& color) { return std::max({ color[0], color[1], color[2] }) <= m_blackLevel; });
+
+	if (!black) {
+		m_black = false;
+		return false;
+	}
+
+	if (!m_black) {
+		m_black = true;
+		m_blackSince = now;
+	}
+
+	if (now - m_blackSince < m_blackTime) return false;
+
+	m_idle = true;
+	m_nextProbeTime = now + m_probeInterval;
+	LOG_INFO("The screen is black, going idle till there is content again.");
+	return true;
+}
+
+/// <summary>
+/// Call for every frame while idle, looks at the frame every probe interval.
+/// </summary>
+/// <returns>If it woke up, the frame has to be analysed</returns>
+bool IdleMonitor::probe(const Frame& frame, Clock::time_point now) {
+	if (now < m_nextProbeTime) return false;
+	m_nextProbeTime = now + m_probeInterval;
+
+	if (this->isBlack(frame)) return false;
+
+	m_idle = false;
+	m_black = false;
+	LOG_INFO("Content on the screen, waking up.");
+	return true;
+}
+
+/// <summary>
+/// Looks at a grid of PROBE_COLUMNS x PROBE_ROWS pixels (spread over the frame, not on the edges) instead of the whole frame.
+/// </summary>
+/// <returns>If none of the pixels is brighter than the black level</returns>
+bool IdleMonitor::isBlack(const Frame& frame) const {
+	const Dimensions dimensions = frame.getDimensions();
+	if (dimensions.width <= 0 || dimensions.height <= 0) return true;
+
+	for (int row = 0; row < PROBE_ROWS; row++) {
+		const int y = (2 * row + 1) * dimensions.height / (2 * PROBE_ROWS);
+		for (int column = 0; column < PROBE_COLUMNS; column++) {
+			const int x = (2 * column + 1) * dimensions.width / (2 * PROBE_COLUMNS);
+			if (getBrightness(frame.image, frame.format, x, y) > m_blackLevel) return false;
+		}
+	}
+
+	return true;
+}
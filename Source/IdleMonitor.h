@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <chrono>
+
+#include <opencv2/core.hpp>
+
+#include "Frame.h"
+
+/// <summary>
+/// Puts the analysis stage to sleep while the screen is black (the TV is off or the source shows nothing), the units run 24/7.
+///
+/// After every analysed frame the zone averages are checked: when every zone stayed at or below the black level for blackTime, it goes idle.
+/// While idle the frames are not analysed, only every probeInterval a grid of a few pixels of the newest frame is looked at.
+/// As soon as one of them is brighter than the black level it wakes up and the frame is analysed right away,
+/// so the leds come back within a probe interval and a frame.
+///
+/// The render stage fades the led-strip out and stops rendering when the analysis stage goes idle (or no frames come at all, no signal).
+/// </summary>
+class IdleMonitor
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr int PROBE_COLUMNS = 16;
+	static constexpr int PROBE_ROWS = 9;
+
+	// Constructor
+	IdleMonitor(int blackLevel, Clock::duration blackTime, Clock::duration probeInterval);
+
+	// Methods
+	bool update(const std::vector<cv::Vec3b>& zoneColors, Clock::time_point now);
+	bool probe(const Frame& frame, Clock::time_point now);
+
+	// Getters & setters
+	bool isIdle() const { return m_idle; }
+
+private:
+	// Methods
+	bool isBlack(const Frame& frame) const;
+
+	// Members
+	int m_blackLevel; // <- Brightness (max of B, G, R or Y) that still counts as black
+	Clock::duration m_blackTime;
+	Clock::duration m_probeInterval;
+
+	bool m_idle = false;
+	bool m_black = false; // <- The last analysed frame was black
+	Clock::time_point m_blackSince;
+	Clock::time_point m_nextProbeTime;
+};
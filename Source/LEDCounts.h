@@ -12,8 +12,10 @@ struct LEDCounts {
 	/// Adds up all the counts and returns the sum.
 	/// </summary>
 	/// <returns>The sum of all leds</returns>
-	unsigned int all() const {
+	constexpr unsigned int all() const {
 		return top + bottom + left + right;
 	}
+
+	constexpr bool operator==(const LEDCounts&) const = default;
 };
 
@@ -0,0 +1,78 @@
+#include "LedColors.h"
+#include "ZoneManager.h"
+
+#include <cstdlib>
+#include <algorithm>
+
+#include <opencv2/core.hpp>
+
+/// <summary>
+/// Puts the last calculated average colors of the zones in the order of the leds on the strip.
+/// </summary>
+/// <param name="colors">The buffer with a BGR color per led, gets resized to the led count.</param>
+/// <param name="zoneManager">A refrence of the zoneManager's.</param>
+void getLedColors(std::vector<cv::Vec3b>& colors, ZoneManager& zoneManager) {
+	// Note: the zone table is already in the order of the leds (see STRIP_START_CORNER and STRIP_DIRECTION in the config)
+	const std::vector<cv::Vec3b>& zoneColors = zoneManager.getZoneTable().colors;
+	colors.assign(zoneColors.begin(), zoneColors.end());
+}
+
+/// <summary>
+/// Corrects the BGR colors per led and converts them to the values the led-strip expects.
+/// </summary>
+/// <param name="colors">A BGR color per led.</param>
+/// <param name="ledColors">The buffer with a color per led, gets resized to the led count.</param>
+/// <param name="colorCorrection">The correction that is applied to every led.</param>
+void packLedColors(const std::vector<cv::Vec3b>& colors, std::vector<uint32_t>& ledColors, const ColorCorrection& colorCorrection) {
+	colorCorrection.apply(colors, ledColors);
+}
+
+/// <summary>
+/// Scales the brightness of every led, used to fade the led-strip out.
+/// </summary>
+/// <param name="colors">A BGR color per led.</param>
+/// <param name="factor">0 (off) - 1 (unchanged).</param>
+void scaleColors(std::vector<cv::Vec3b>& colors, float factor) {
+	const int scale = (int)(std::clamp(factor, 0.0f, 1.0f) * 256.0f); // <- 8.8 fixed-point
+
+	for (cv::Vec3b& color : colors) {
+		color[0] = (uint8_t)((color[0] * scale) >> 8);
+		color[1] = (uint8_t)((color[1] * scale) >> 8);
+		color[2] = (uint8_t)((color[2] * scale) >> 8);
+	}
+}
+
+/// <summary>
+/// Checks if any color channel of any led differs more than the threshold from the last rendered colors.
+/// </summary>
+/// <param name="ledColors">The packed colors that are about to be rendered.</param>
+/// <param name="lastRenderedColors">The packed colors of the last render.</param>
+/// <param name="threshold">Biggest difference per channel (0 - 255) that doesn't count as a change, -1 counts everything as a change.</param>
+bool hasLedColorsChanged(const std::vector<uint32_t>& ledColors, const std::vector<uint32_t>& lastRenderedColors, int threshold) {
+	if (threshold < 0 || ledColors.size() != lastRenderedColors.size()) return true;
+
+	for (size_t i = 0; i < ledColors.size(); i++) {
+		uint32_t a = ledColors[i];
+		uint32_t b = lastRenderedColors[i];
+		if (a == b) continue;
+
+		for (int shift = 0; shift < 32; shift += 8) {
+			int difference = std::abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF));
+			if (difference > threshold) return true;
+		}
+	}
+
+	return false;
+}
+
+/// <summary>
+/// Converts a BGR value to a WBGR hex value.
+/// Note: White is only used by RGBW strips, see ColorCorrection.
+/// </summary>
+/// <param name="color">The color to be converted.</param>
+/// <param name="white">The value of the white led.</param>
+/// <returns>The WBGR hex value.</returns>
+int BGRToWRGBHex(cv::Vec3b color, uint8_t white) {
+	//		  White				Blue 			   Green		   Red
+	return ((white << 24) | (color[0] << 16) | (color[1] << 8) | color[2]);
+}
\ No newline at end of file
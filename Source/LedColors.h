@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "ZoneManager.h"
+#include "ColorCorrection.h"
+
+/*
+	Purpose:
+	Turns the calculated zone averages into the colors that are send to the led-strip.
+	This has no dependency on the led-strip library, so it can also be used without a led-strip attached.
+*/
+
+/// <summary>
+/// The colors of all leds (in the order of the strip) calculated from one frame.
+/// </summary>
+struct LedFrame {
+	std::vector<cv::Vec3b> colors; // <- BGR
+	std::chrono::steady_clock::time_point timestamp; // <- When the frame was captured
+	bool idle = false; // <- The analysis stage went idle after this frame (black screen), see IdleMonitor
+};
+
+void getLedColors(std::vector<cv::Vec3b>& colors, ZoneManager& zoneManager);
+void packLedColors(const std::vector<cv::Vec3b>& colors, std::vector<uint32_t>& ledColors, const ColorCorrection& colorCorrection);
+void scaleColors(std::vector<cv::Vec3b>& colors, float factor);
+bool hasLedColorsChanged(const std::vector<uint32_t>& ledColors, const std::vector<uint32_t>& lastRenderedColors, int threshold);
+int BGRToWRGBHex(cv::Vec3b color, uint8_t white = 0);
@@ -0,0 +1,65 @@
+#include "LedSink.h"
+#include "NullLedSink.h"
+#include "RecordingLedSink.h"
+#include "MockLedSink.h"
+#include "const_config.h"
+
+#ifdef WITH_WS2811
+#include "Ws2811LedSink.h"
+#endif
+#ifdef __linux__
+#include "DdpLedSink.h"
+#endif
+
+#include <memory>
+#include <chrono>
+
+/// <summary>
+/// Creates the LedSink of the given type.
+/// </summary>
+/// <returns>The created LedSink or nullptr if the type is not available in this build</returns>
+std::unique_ptr<LedSink> createLedSink(LedSinkType type) {
+	switch (type) {
+	case LedSinkType::WS2811:
+#ifdef WITH_WS2811
+		return std::make_unique<Ws2811LedSink>();
+#else
+		LOG_INFO("The ws2811 led sink is not available, the program is build without rpi_ws281x.");
+		return nullptr;
+#endif
+
+	case LedSinkType::NONE:
+		return std::make_unique<NullLedSink>();
+
+	case LedSinkType::RECORDING:
+		return std::make_unique<RecordingLedSink>(Config::LED_RECORDING_FILE_PATH);
+
+	case LedSinkType::MOCK:
+		return std::make_unique<MockLedSink>(Config::STRIP_HAS_WHITE ? 32 : 24);
+
+	case LedSinkType::DDP:
+		return createLedSink(type, Config::DDP_HOST);
+
+	default:
+		LOG_INFO("A unknown LedSinkType is given while creating the led sink.");
+		return nullptr;
+	}
+}
+
+/// <summary>
+/// Creates the LedSink of the given type, a DDP sink sends to the given host.
+/// </summary>
+/// <param name="host">The led controller of a LedSinkType::DDP sink, nullptr is DDP_HOST. Not used by the other types</param>
+/// <returns>The created LedSink or nullptr if the type is not available in this build</returns>
+std::unique_ptr<LedSink> createLedSink(LedSinkType type, const char* host) {
+	if (type != LedSinkType::DDP) return createLedSink(type);
+
+#ifdef __linux__
+	return std::make_unique<DdpLedSink>(
+		host ? host : Config::DDP_HOST, Config::DDP_PORT, Config::DDP_RGBW, std::chrono::milliseconds(Config::DDP_FULL_FRAME_INTERVAL_MS)
+	);
+#else
+	LOG_INFO("The ddp led sink is only available on linux.");
+	return nullptr;
+#endif
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+enum class LedSinkType {
+	WS2811, // <- The led-strip on the GPIO pin of the Pi (needs rpi_ws281x)
+	NONE, // <- Throws the colors away, for measuring everything before the render
+	RECORDING, // <- Writes the colors with a timestamp to a file
+	MOCK, // <- Takes as long as a WS281x strip and keeps the colors, for testing a layout without the hardware
+	DDP // <- Sends the colors over UDP to a led controller on the network (only on linux)
+};
+
+/// <summary>
+/// The output the led colors are rendered to.
+/// The rest of the program only talks to this, so it doesn't care if there is a led-strip attached or not.
+/// </summary>
+class LedSink
+{
+public:
+	virtual ~LedSink() = default;
+
+	// Methods
+
+	/// <summary>
+	/// Prepares the output, must be called before the first render.
+	/// </summary>
+	/// <returns>If the output is ready to render</returns>
+	virtual bool init() = 0;
+
+	/// <summary>
+	/// Renders a color per led (the interpolated colors, packed by packLedColors).
+	/// </summary>
+	/// <returns>If the colors are rendered succesfully</returns>
+	virtual bool render(const std::vector<uint32_t>& ledColors) = 0;
+
+	/// <summary>
+	/// Turns off all leds and releases the output.
+	/// </summary>
+	virtual void fini() = 0;
+
+	// Getters & setters
+	virtual const char* getName() const = 0;
+};
+
+std::unique_ptr<LedSink> createLedSink(LedSinkType type);
+std::unique_ptr<LedSink> createLedSink(LedSinkType type, const char* host);
@@ -0,0 +1,110 @@
+#include "LetterboxDetector.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <opencv2/core.hpp>
+
+/*
+	Amount of columns (for the top and bottom bar) and rows (for the left and right bar) that are walked.
+*/
+static constexpr int SAMPLE_LINES = 8;
+
+LetterboxDetector::LetterboxDetector(int intervalFrames, int blackLevel, int stableDetections)
+	: m_intervalFrames(std::max(1, intervalFrames)), m_blackLevel(blackLevel), m_stableDetections(std::max(1, stableDetections)) { }
+
+/// <summary>
+/// Call once per frame, runs the detection every intervalFrames frames.
+/// When the frame dimensions change the content rect is reset to the whole frame.
+/// </summary>
+/// <returns>True if the content rect changed</returns>
+bool LetterboxDetector::update(const Frame& frame) {
+	Dimensions frameDimensions = frame.getDimensions();
+	if (!(m_frameDimensions == frameDimensions)) {
+		m_frameDimensions = frameDimensions;
+		m_contentRect = cv::Rect(0, 0, frameDimensions.width, frameDimensions.height);
+		m_candidateCount = 0;
+		m_frameCounter = 0;
+		return true;
+	}
+
+	if (++m_frameCounter < m_intervalFrames) return false;
+	m_frameCounter = 0;
+
+	cv::Rect contentRect;
+	if (!this->detect(frame, contentRect)) {
+		m_candidateCount = 0; // <- Too dark to tell, keep the current rect
+		return false;
+	}
+
+	if (this->isSimilar(contentRect, m_contentRect)) {
+		m_candidateCount = 0;
+		return false;
+	}
+
+	// Hysteresis, the same rect has to be detected a few times in a row
+	if (m_candidateCount > 0 && this->isSimilar(contentRect, m_candidateRect)) m_candidateCount++;
+	else {
+		m_candidateRect = contentRect;
+		m_candidateCount = 1;
+	}
+
+	if (m_candidateCount < m_stableDetections) return false;
+
+	m_contentRect = m_candidateRect;
+	m_candidateCount = 0;
+	return true;
+}
+
+/// <summary>
+/// Walks the sample lines from every edge to the first pixel that isn't black.
+/// </summary>
+/// <param name="contentRect">The rect of the content, only set on success</param>
+/// <returns>False if a edge has no content in its outer quarter (a dark scene)</returns>
+bool LetterboxDetector::detect(const Frame& frame, cv::Rect& contentRect) const {
+	const int width = m_frameDimensions.width;
+	const int height = m_frameDimensions.height;
+	const int maxBarHeight = height / 4;
+	const int maxBarWidth = width / 4;
+
+	int top = maxBarHeight, bottom = maxBarHeight, left = maxBarWidth, right = maxBarWidth;
+
+	for (int i = 0; i < SAMPLE_LINES; i++) {
+		const int x = (2 * i + 1) * width / (2 * SAMPLE_LINES);
+		const int y = (2 * i + 1) * height / (2 * SAMPLE_LINES);
+
+		// Note: the bar can only get smaller, so every line stops at the smallest bar found so far
+		for (int bar = 0; bar < top; bar++) {
+			if (getBrightness(frame.image, frame.format, x, bar) > m_blackLevel) { top = bar; break; }
+		}
+		for (int bar = 0; bar < bottom; bar++) {
+			if (getBrightness(frame.image, frame.format, x, height - 1 - bar) > m_blackLevel) { bottom = bar; break; }
+		}
+		for (int bar = 0; bar < left; bar++) {
+			if (getBrightness(frame.image, frame.format, bar, y) > m_blackLevel) { left = bar; break; }
+		}
+		for (int bar = 0; bar < right; bar++) {
+			if (getBrightness(frame.image, frame.format, width - 1 - bar, y) > m_blackLevel) { right = bar; break; }
+		}
+	}
+
+	if (top == maxBarHeight || bottom == maxBarHeight || left == maxBarWidth || right == maxBarWidth) return false;
+
+	// Bars are always symmetric, the smallest one wins
+	int barHeight = std::min(top, bottom);
+	int barWidth = std::min(left, right);
+
+	contentRect = cv::Rect(barWidth, barHeight, width - 2 * barWidth, height - 2 * barHeight);
+	return true;
+}
+
+/// <summary>
+/// Two rects are similar when every edge is within 1% of the frame dimensions, so noise on the edge of a bar doesn't count as a change.
+/// </summary>
+bool LetterboxDetector::isSimilar(const cv::Rect& a, const cv::Rect& b) const {
+	const int toleranceX = std::max(1, m_frameDimensions.width / 100);
+	const int toleranceY = std::max(1, m_frameDimensions.height / 100);
+
+	return std::abs(a.x - b.x) <= toleranceX && std::abs(a.width - b.width) <= 2 * toleranceX
+		&& std::abs(a.y - b.y) <= toleranceY && std::abs(a.height - b.height) <= 2 * toleranceY;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <opencv2/core.hpp>
+
+#include "Dimensions.h"
+#include "Frame.h"
+
+/// <summary>
+/// Detects black bars (letterbox on top and bottom, pillarbox on the left and right) and gives the rect of the content.
+///
+/// Every intervalFrames frames a few columns are walked from the top and bottom edge, and a few rows from the left and right edge,
+/// till a pixel is brighter than the black level. Only the outer quarter of the frame is walked, so it stays cheap.
+/// Opposite bars get the size of the smallest one, so subtitles in a bar or a dark scene can never crop away content.
+///
+/// A new content rect is only taken over after it was detected stableDetections times in a row (hysteresis),
+/// so a dark scene doesn't make the zones jump around.
+/// </summary>
+class LetterboxDetector
+{
+public:
+	// Constructor
+	LetterboxDetector(int intervalFrames, int blackLevel, int stableDetections);
+
+	// Methods
+	bool update(const Frame& frame);
+
+	// Getters & setters
+	const cv::Rect& getContentRect() const { return m_contentRect; }
+
+private:
+	// Methods
+	bool detect(const Frame& frame, cv::Rect& contentRect) const;
+	bool isSimilar(const cv::Rect& a, const cv::Rect& b) const;
+
+	// Members
+	int m_intervalFrames;
+	int m_blackLevel; // <- Brightness (max of B, G, R or Y) of a pixel that still counts as black
+	int m_stableDetections;
+
+	Dimensions m_frameDimensions = { 0, 0 };
+	cv::Rect m_contentRect;
+
+	int m_frameCounter = 0;
+	cv::Rect m_candidateRect;
+	int m_candidateCount = 0;
+};
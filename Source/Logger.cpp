@@ -0,0 +1,175 @@
+#include "Logger.h"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+Logger::Logger() {
+	for (size_t i = 0; i < CAPACITY; i++) {
+		m_entries[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+Logger::~Logger() {
+	this->stop();
+}
+
+/// <summary>
+/// The logger of the program, there is only one.
+/// </summary>
+Logger& getLogger() {
+	static Logger logger;
+	return logger;
+}
+
+/// <summary>
+/// The (reset) message stream of the calling thread.
+/// </summary>
+LogMessageStream& beginLogMessage() {
+	thread_local LogMessageStream stream;
+	stream.reset();
+	return stream;
+}
+
+/// <summary>
+/// Starts the background thread that writes the messages.
+/// </summary>
+void Logger::start() {
+	if (m_running) return;
+
+	m_running = true;
+	m_thread = std::thread(&Logger::drainLoop, this);
+}
+
+/// <summary>
+/// Writes the messages that are left and stops the background thread, call before exiting.
+/// </summary>
+void Logger::stop() {
+	if (!m_running) return;
+
+	m_running = false;
+	if (m_thread.joinable()) m_thread.join();
+	this->drain(); // <- A message can be pushed right before the thread stopped
+}
+
+/// <summary>
+/// Hands a formatted message to the background thread. Never blocks.
+/// </summary>
+void Logger::submit(LogLevel level, const char* text, size_t length) {
+	if (!m_running) {
+		write(level, text, length);
+		std::cout.flush();
+		return;
+	}
+
+	if (!this->tryPush(level, text, length)) {
+		m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/// <summary>
+/// Claims a entry by moving the enqueue position and fills it.
+/// </summary>
+/// <returns>False when the ring is full</returns>
+bool Logger::tryPush(LogLevel level, const char* text, size_t length) {
+	Entry* entry;
+	size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+
+	while (true) {
+		entry = &m_entries[position & (CAPACITY - 1)];
+		size_t sequence = entry->sequence.load(std::memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+		if (difference == 0) { // <- Free, try to claim it
+			if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+		}
+		else if (difference < 0) { // <- Not drained yet, so the ring is full
+			return false;
+		}
+		else { // <- Claimed by a other thread
+			position = m_enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	entry->level = level;
+	entry->length = (uint16_t)std::min(length, MESSAGE_SIZE);
+	std::memcpy(entry->text, text, entry->length);
+	entry->sequence.store(position + 1, std::memory_order_release); // <- Ready to be drained
+
+	return true;
+}
+
+/// <summary>
+/// Writes all messages in the ring to stdout with one flush.
+/// </summary>
+/// <returns>The amount of written messages</returns>
+size_t Logger::drain() {
+	size_t count = 0;
+
+	while (true) {
+		Entry& entry = m_entries[m_dequeuePosition & (CAPACITY - 1)];
+		if (entry.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1) break; // <- Empty
+
+		write(entry.level, entry.text, entry.length);
+		entry.sequence.store(m_dequeuePosition + CAPACITY, std::memory_order_release); // <- Free for the next round
+		m_dequeuePosition++;
+		count++;
+	}
+
+	if (count > 0) std::cout.flush();
+	return count;
+}
+
+void Logger::drainLoop() {
+	uint64_t reportedDroppedCount = 0;
+
+	while (m_running) {
+		this->drain();
+
+		uint64_t droppedCount = m_droppedCount.load(std::memory_order_relaxed);
+		if (droppedCount != reportedDroppedCount) {
+			std::cout << "[warning] The log is full, dropped " << (droppedCount - reportedDroppedCount) << " messages" << std::endl;
+			reportedDroppedCount = droppedCount;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20)); // <- Nobody waits for the log, so no need to wake up sooner
+	}
+}
+
+void Logger::write(LogLevel level, const char* text, size_t length) {
+	switch (level) {
+	case LogLevel::VERBOSE: std::cout << "[verbose] "; break;
+	case LogLevel::INFO: std::cout << "[info] "; break;
+	case LogLevel::WARNING: std::cout << "[warning] "; break;
+	case LogLevel::ERROR: std::cout << "[error] "; break;
+	}
+
+	std::cout.write(text, length);
+	std::cout.put('\n');
+}
+
+/// <summary>
+/// Counts the message in the current interval, starts a new interval when the last one is over.
+/// </summary>
+/// <param name="suppressedCount">Set to the amount of messages suppressed in the last interval, when a new interval starts</param>
+/// <returns>If the message can be logged</returns>
+bool LogRateLimit::allow(uint32_t& suppressedCount) {
+	const Logger& logger = getLogger();
+	int64_t nowMS = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	int64_t intervalStartMS = m_intervalStartMS.load(std::memory_order_relaxed);
+	if (nowMS - intervalStartMS >= logger.getRateLimitIntervalMS()
+		&& m_intervalStartMS.compare_exchange_strong(intervalStartMS, nowMS, std::memory_order_relaxed)) {
+		suppressedCount = m_suppressedCount.exchange(0, std::memory_order_relaxed);
+		m_count.store(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	if ((int)m_count.fetch_add(1, std::memory_order_relaxed) < logger.getRateLimitMessages()) {
+		return true;
+	}
+
+	m_suppressedCount.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <thread>
+#include <ostream>
+#include <streambuf>
+#include <cstdint>
+#include <cstddef>
+
+enum class LogLevel {
+	VERBOSE,
+	INFO,
+	WARNING,
+	ERROR
+};
+
+/// <summary>
+/// A lock-free logger, so the stages never block on stdout (a slow console or journald).
+///
+/// A log call formats the message in a fixed buffer of the calling thread and pushes it on a bounded
+/// multi producer / single consumer ring (Vyukov's bounded queue). A background thread drains the ring
+/// and writes the messages to stdout, with one flush per batch.
+/// When the ring is full the message is dropped (and counted) instead of waiting.
+/// Before start and after stop messages are written straight to stdout.
+///
+/// Use the LOG_* macros, they also rate limit every call site (see LogRateLimit).
+/// </summary>
+class Logger
+{
+public:
+	static constexpr size_t MESSAGE_SIZE = 240; // <- Longer messages are cut off
+	static constexpr size_t CAPACITY = 1024; // <- Messages, must be a power of 2
+
+	// Constructor
+	Logger();
+	~Logger();
+
+	// Methods
+	void start();
+	void stop();
+	void submit(LogLevel level, const char* text, size_t length);
+
+	// Getters & setters
+	bool isEnabled(LogLevel level) const { return level >= m_level.load(std::memory_order_relaxed); }
+	void setLevel(LogLevel level) { m_level = level; }
+
+	void setRateLimit(int messagesPerInterval, int intervalMS) { m_rateLimitMessages = messagesPerInterval; m_rateLimitIntervalMS = intervalMS; }
+	int getRateLimitMessages() const { return m_rateLimitMessages.load(std::memory_order_relaxed); }
+	int getRateLimitIntervalMS() const { return m_rateLimitIntervalMS.load(std::memory_order_relaxed); }
+
+	uint64_t getDroppedCount() const { return m_droppedCount; }
+
+private:
+	struct Entry {
+		std::atomic<size_t> sequence;
+		LogLevel level;
+		uint16_t length;
+		char text[MESSAGE_SIZE];
+	};
+
+	// Methods
+	bool tryPush(LogLevel level, const char* text, size_t length);
+	size_t drain();
+	void drainLoop();
+	static void write(LogLevel level, const char* text, size_t length);
+
+	// Members
+	std::array<Entry, CAPACITY> m_entries;
+	alignas(64) std::atomic<size_t> m_enqueuePosition = 0; // <- Shared by the producers
+	alignas(64) size_t m_dequeuePosition = 0; // <- Only touched by the drain thread
+
+	std::atomic<LogLevel> m_level = LogLevel::INFO;
+	std::atomic<int> m_rateLimitMessages = 5;
+	std::atomic<int> m_rateLimitIntervalMS = 1000;
+
+	std::atomic<bool> m_running = false;
+	std::atomic<uint64_t> m_droppedCount = 0;
+	std::thread m_thread;
+};
+
+Logger& getLogger();
+
+/// <summary>
+/// A ostream that formats into a fixed buffer, so formatting a message doesn't allocate.
+/// Every thread has one, see beginLogMessage.
+/// </summary>
+class LogMessageStream : private std::streambuf, public std::ostream
+{
+public:
+	// Constructor
+	LogMessageStream() : std::ostream(this) { this->reset(); }
+
+	// Methods
+	void reset() {
+		this->setp(m_buffer, m_buffer + sizeof(m_buffer));
+		this->clear();
+	}
+
+	// Getters & setters
+	const char* getText() const { return this->pbase(); }
+	size_t getLength() const { return (size_t)(this->pptr() - this->pbase()); }
+
+private:
+	int overflow(int) override { return std::char_traits<char>::eof(); } // <- Full, the rest is cut off
+
+	// Members
+	char m_buffer[Logger::MESSAGE_SIZE];
+};
+
+LogMessageStream& beginLogMessage();
+
+/// <summary>
+/// Rate limits a single call site: at most getRateLimitMessages() messages per interval,
+/// the amount of suppressed messages is added to the first message of the next interval.
+/// So a message that is logged every frame (a retry, a timeout) shows up a few times per second at most.
+/// </summary>
+class LogRateLimit
+{
+public:
+	// Constructor
+	constexpr LogRateLimit() = default;
+
+	// Methods
+	bool allow(uint32_t& suppressedCount);
+
+private:
+	// Members
+	std::atomic<int64_t> m_intervalStartMS = INT64_MIN / 2;
+	std::atomic<uint32_t> m_count = 0;
+	std::atomic<uint32_t> m_suppressedCount = 0;
+};
+
+/*
+	Log a message like it's written to a std::ostream: LOG_INFO("Streaming " << devicePath << " at " << width << "x" << height);
+	The message is only formatted when the level is enabled and the call site isn't rate limited.
+*/
+#define LOG(level, message) \
+	do { \
+		static LogRateLimit logRateLimit_; \
+		uint32_t logSuppressedCount_ = 0; \
+		if (getLogger().isEnabled(level) && logRateLimit_.allow(logSuppressedCount_)) { \
+			LogMessageStream& logStream_ = beginLogMessage(); \
+			logStream_ << message; \
+			if (logSuppressedCount_ > 0) logStream_ << " (" << logSuppressedCount_ << " more suppressed)"; \
+			getLogger().submit(level, logStream_.getText(), logStream_.getLength()); \
+		} \
+	} while (false)
+
+#define LOG_VERBOSE(message) LOG(LogLevel::VERBOSE, message)
+#define LOG_INFO(message) LOG(LogLevel::INFO, message)
+#define LOG_WARNING(message) LOG(LogLevel::WARNING, message)
+#define LOG_ERROR(message) LOG(LogLevel::ERROR, message)
@@ -0,0 +1,41 @@
+#include "Metrics.h"
+
+/// <summary>
+/// The metrics of the program, there is only one set of them.
+/// </summary>
+Metrics& getMetrics() {
+	static Metrics metrics;
+	return metrics;
+}
+
+/// <summary>
+/// Estimates a percentile from the buckets, interpolating linearly inside the bucket it falls in.
+/// </summary>
+/// <param name="p">The percentile as a fraction (0.99 for p99)</param>
+/// <returns>The estimate in microseconds, 0 when nothing is observed</returns>
+double Histogram::estimatePercentileUS(double p) const {
+	uint64_t counts[BUCKET_COUNT + 1];
+	uint64_t total = 0;
+	for (size_t i = 0; i <= BUCKET_COUNT; i++) {
+		counts[i] = this->getBucketCount(i);
+		total += counts[i];
+	}
+	if (total == 0) return 0.0;
+
+	double rank = p * total;
+	uint64_t cumulative = 0;
+	for (size_t i = 0; i <= BUCKET_COUNT; i++) {
+		if (counts[i] == 0 || cumulative + counts[i] < rank) {
+			cumulative += counts[i];
+			continue;
+		}
+
+		if (i == BUCKET_COUNT) return (double)BUCKET_BOUNDS_US[BUCKET_COUNT - 1]; // <- Above the last bound, can't tell more
+
+		double lower = (i == 0 ? 0.0 : (double)BUCKET_BOUNDS_US[i - 1]);
+		double upper = (double)BUCKET_BOUNDS_US[i];
+		return lower + (upper - lower) * (rank - cumulative) / counts[i];
+	}
+
+	return (double)BUCKET_BOUNDS_US[BUCKET_COUNT - 1];
+}
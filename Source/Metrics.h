@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// A lock-free histogram with fixed buckets for durations.
+/// Observing is a few relaxed atomic adds, so it can be done on the hot path from any thread.
+/// The buckets go from 10 microseconds to 1 second (roughly 1-2.5-5 steps), the last bucket is everything above.
+/// </summary>
+class Histogram
+{
+public:
+	static constexpr size_t BUCKET_COUNT = 16;
+	static constexpr std::array<int64_t, BUCKET_COUNT> BUCKET_BOUNDS_US = {
+		10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000
+	};
+
+	// Methods
+	void observe(std::chrono::steady_clock::duration duration) {
+		int64_t durationUS = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+
+		size_t bucket = 0;
+		while (bucket < BUCKET_COUNT && durationUS > BUCKET_BOUNDS_US[bucket]) bucket++;
+
+		m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_sumNS.fetch_add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+	}
+
+	double estimatePercentileUS(double p) const;
+
+	// Getters & setters
+	uint64_t getCount() const { return m_count.load(std::memory_order_relaxed); }
+	double getSumSeconds() const { return m_sumNS.load(std::memory_order_relaxed) / 1e9; }
+	uint64_t getBucketCount(size_t bucket) const { return m_buckets[bucket].load(std::memory_order_relaxed); } // <- Not cumulative, BUCKET_COUNT is above the last bound
+
+private:
+	// Members
+	std::array<std::atomic<uint64_t>, BUCKET_COUNT + 1> m_buckets = {};
+	std::atomic<uint64_t> m_count = 0;
+	std::atomic<uint64_t> m_sumNS = 0;
+};
+
+/// <summary>
+/// All metrics of the program, written by the stages and read by the MetricsExporter.
+/// Everything is atomic, so there are no locks between the stages and the exporter.
+/// </summary>
+struct Metrics {
+	// Durations per stage
+	Histogram captureWait; // <- Waiting for and reading a frame (the OpenCV source also converts to BGR in here)
+	Histogram reduce; // <- Zone averages
+	Histogram analysis; // <- The whole analysis stage of a frame
+	Histogram interpolate;
+	Histogram pack;
+	Histogram render; // <- LedSink render, for the led-strip that includes waiting for the DMA of the previous render
+	Histogram frameLatency; // <- Captured till rendered
+	Histogram renderJitter; // <- How late the render stage woke up for a tick of the render clock
+	Histogram reconnectDuration;
+
+	// Counters
+	std::atomic<uint64_t> capturedFrames = 0;
+	std::atomic<uint64_t> droppedFrames = 0; // <- Captured but never analysed
+	std::atomic<uint64_t> analysedFrames = 0;
+	std::atomic<uint64_t> renders = 0;
+	std::atomic<uint64_t> skippedRenders = 0; // <- The colors didn't change
+	std::atomic<uint64_t> calculatedZones = 0;
+	std::atomic<uint64_t> skippedZones = 0; // <- The zone didn't change
+	std::atomic<uint64_t> reconnects = 0;
+	std::atomic<uint64_t> qualityChanges = 0; // <- Steps of the QualityGovernor
+	std::atomic<uint64_t> networkPackets = 0; // <- Sent by the DdpLedSink
+	std::atomic<uint64_t> networkDroppedFrames = 0; // <- Rendered but never sent by the DdpLedSink, the network couldn't keep up
+	std::atomic<uint64_t> missedRenderTicks = 0; // <- Ticks of the render clock that are skipped because the render stage was behind
+
+	// Gauges
+	std::atomic<double> timeToFirstLightSeconds = -1.0;
+	std::atomic<int> qualityLevel = 0; // <- Index in QUALITY_LEVELS, 0 is the full quality
+	std::atomic<double> socTemperatureCelsius = -1.0; // <- -1 till it is read, NAN when there is no sensor
+	std::atomic<int> idle = 0; // <- 1 while the led-strip is off and not rendered (black screen or no signal)
+	std::atomic<double> renderJitterMaxSeconds = 0.0; // <- Only written by the render stage
+};
+
+Metrics& getMetrics();
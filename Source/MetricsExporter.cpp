@@ -0,0 +1,178 @@
+#include "MetricsExporter.h"
+#include "const_config.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <chrono>
+#include <utility>
+#include <string>
+#include <cmath>
+
+MetricsExporter::MetricsExporter(const Metrics& metrics, std::string filePath, int intervalMS)
+	: m_metrics(metrics), m_filePath(std::move(filePath)), m_intervalMS(intervalMS) { }
+
+MetricsExporter::~MetricsExporter() {
+	this->stop();
+}
+
+/// <summary>
+/// Starts the export thread.
+/// </summary>
+void MetricsExporter::start() {
+	if (m_thread.joinable()) return;
+
+	m_running = true;
+	m_thread = std::thread(&MetricsExporter::exportLoop, this);
+}
+
+/// <summary>
+/// Stops the export thread, the file is written one last time.
+/// </summary>
+void MetricsExporter::stop() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_wakeUp.notify_all();
+
+	if (m_thread.joinable()) m_thread.join();
+}
+
+void MetricsExporter::exportLoop() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_running) {
+		m_wakeUp.wait_for(lock, std::chrono::milliseconds(m_intervalMS), [this] { return !m_running; });
+
+		if (!m_filePath.empty()) this->writeFile();
+
+#if DEBUG
+		printMetricsSummary(m_metrics, std::cout);
+#endif
+	}
+}
+
+/// <summary>
+/// Writes the metrics to the file (through a temporary file and a rename).
+/// </summary>
+/// <returns>If the file is written</returns>
+bool MetricsExporter::writeFile() const {
+	const std::string temporaryFilePath = m_filePath + ".tmp";
+	{
+		std::ofstream file(temporaryFilePath, std::ios::trunc);
+		if (!file) {
+			LOG_ERROR("Can't write metrics to " << temporaryFilePath << "!");
+			return false;
+		}
+		writePrometheusText(m_metrics, file);
+	}
+
+	return std::rename(temporaryFilePath.c_str(), m_filePath.c_str()) == 0;
+}
+
+static void writeHistogram(std::ostream& stream, const char* name, const char* labels, const Histogram& histogram) {
+	uint64_t cumulative = 0;
+	for (size_t i = 0; i < Histogram::BUCKET_COUNT; i++) {
+		cumulative += histogram.getBucketCount(i);
+		stream << name << "_bucket{" << labels << ",le=\"" << Histogram::BUCKET_BOUNDS_US[i] / 1e6 << "\"} " << cumulative << "\n";
+	}
+	cumulative += histogram.getBucketCount(Histogram::BUCKET_COUNT);
+	stream << name << "_bucket{" << labels << ",le=\"+Inf\"} " << cumulative << "\n";
+	stream << name << "_sum{" << labels << "} " << histogram.getSumSeconds() << "\n";
+	stream << name << "_count{" << labels << "} " << cumulative << "\n";
+}
+
+static void writeCounter(std::ostream& stream, const char* name, const char* help, const std::atomic<uint64_t>& counter) {
+	stream << "# HELP " << name << " " << help << "\n";
+	stream << "# TYPE " << name << " counter\n";
+	stream << name << " " << counter.load(std::memory_order_relaxed) << "\n";
+}
+
+/// <summary>
+/// Writes the metrics in the Prometheus text format.
+/// </summary>
+void writePrometheusText(const Metrics& metrics, std::ostream& stream) {
+	const std::pair<const char*, const Histogram*> stages[] = {
+		{ "capture_wait", &metrics.captureWait },
+		{ "reduce", &metrics.reduce },
+		{ "analysis", &metrics.analysis },
+		{ "interpolate", &metrics.interpolate },
+		{ "pack", &metrics.pack },
+		{ "render", &metrics.render }
+	};
+
+	stream << "# HELP tv_ambient_lighting_stage_duration_seconds Duration of a stage of the pipeline.\n";
+	stream << "# TYPE tv_ambient_lighting_stage_duration_seconds histogram\n";
+	for (const auto& [stage, histogram] : stages) {
+		std::string labels = std::string("stage=\"") + stage + "\"";
+		writeHistogram(stream, "tv_ambient_lighting_stage_duration_seconds", labels.c_str(), *histogram);
+	}
+
+	stream << "# HELP tv_ambient_lighting_frame_latency_seconds Time from capturing a frame till rendering its colors.\n";
+	stream << "# TYPE tv_ambient_lighting_frame_latency_seconds histogram\n";
+	writeHistogram(stream, "tv_ambient_lighting_frame_latency_seconds", "source=\"capture\"", metrics.frameLatency);
+
+	stream << "# HELP tv_ambient_lighting_render_jitter_seconds Time the render stage woke up too late for a tick of the render clock.\n";
+	stream << "# TYPE tv_ambient_lighting_render_jitter_seconds histogram\n";
+	writeHistogram(stream, "tv_ambient_lighting_render_jitter_seconds", "source=\"render\"", metrics.renderJitter);
+
+	stream << "# HELP tv_ambient_lighting_reconnect_duration_seconds Time the capture card was disconnected.\n";
+	stream << "# TYPE tv_ambient_lighting_reconnect_duration_seconds histogram\n";
+	writeHistogram(stream, "tv_ambient_lighting_reconnect_duration_seconds", "source=\"capture\"", metrics.reconnectDuration);
+
+	writeCounter(stream, "tv_ambient_lighting_captured_frames_total", "Frames read from the capture card.", metrics.capturedFrames);
+	writeCounter(stream, "tv_ambient_lighting_dropped_frames_total", "Captured frames that were never analysed.", metrics.droppedFrames);
+	writeCounter(stream, "tv_ambient_lighting_analysed_frames_total", "Frames the zone averages are calculated on.", metrics.analysedFrames);
+	writeCounter(stream, "tv_ambient_lighting_renders_total", "Renders to the led sink.", metrics.renders);
+	writeCounter(stream, "tv_ambient_lighting_skipped_renders_total", "Renders skipped because the colors didn't change.", metrics.skippedRenders);
+	writeCounter(stream, "tv_ambient_lighting_calculated_zones_total", "Zone averages that are calculated.", metrics.calculatedZones);
+	writeCounter(stream, "tv_ambient_lighting_skipped_zones_total", "Zone averages that are skipped because the zone didn't change.", metrics.skippedZones);
+	writeCounter(stream, "tv_ambient_lighting_reconnects_total", "Times the capture card is reconnected.", metrics.reconnects);
+	writeCounter(stream, "tv_ambient_lighting_quality_changes_total", "Times the quality governor changed the quality level.", metrics.qualityChanges);
+	writeCounter(stream, "tv_ambient_lighting_network_packets_total", "DDP packets sent to network led controllers.", metrics.networkPackets);
+	writeCounter(stream, "tv_ambient_lighting_network_dropped_frames_total", "Rendered frames that were never sent to the network led controllers.", metrics.networkDroppedFrames);
+	writeCounter(stream, "tv_ambient_lighting_missed_render_ticks_total", "Ticks of the render clock skipped because the render stage was behind.", metrics.missedRenderTicks);
+
+	stream << "# HELP tv_ambient_lighting_time_to_first_light_seconds Time from start-up till the first frame, -1 till then.\n";
+	stream << "# TYPE tv_ambient_lighting_time_to_first_light_seconds gauge\n";
+	stream << "tv_ambient_lighting_time_to_first_light_seconds " << metrics.timeToFirstLightSeconds.load(std::memory_order_relaxed) << "\n";
+
+	stream << "# HELP tv_ambient_lighting_quality_level Quality level of the quality governor, 0 is the full quality.\n";
+	stream << "# TYPE tv_ambient_lighting_quality_level gauge\n";
+	stream << "tv_ambient_lighting_quality_level " << metrics.qualityLevel.load(std::memory_order_relaxed) << "\n";
+
+	stream << "# HELP tv_ambient_lighting_idle 1 while the led-strip is faded out and not rendered (black screen or no signal).\n";
+	stream << "# TYPE tv_ambient_lighting_idle gauge\n";
+	stream << "tv_ambient_lighting_idle " << metrics.idle.load(std::memory_order_relaxed) << "\n";
+
+	stream << "# HELP tv_ambient_lighting_render_jitter_max_seconds The latest the render stage ever woke up for a tick of the render clock.\n";
+	stream << "# TYPE tv_ambient_lighting_render_jitter_max_seconds gauge\n";
+	stream << "tv_ambient_lighting_render_jitter_max_seconds " << metrics.renderJitterMaxSeconds.load(std::memory_order_relaxed) << "\n";
+
+	const double temperature = metrics.socTemperatureCelsius.load(std::memory_order_relaxed);
+	stream << "# HELP tv_ambient_lighting_soc_temperature_celsius Temperature of the SoC, -1 till it is read.\n";
+	stream << "# TYPE tv_ambient_lighting_soc_temperature_celsius gauge\n";
+	stream << "tv_ambient_lighting_soc_temperature_celsius " << (std::isnan(temperature) ? "NaN" : std::to_string(temperature)) << "\n";
+}
+
+/// <summary>
+/// Prints the p50/p99 of every stage (estimated from the buckets), the p99/max render jitter and the most important counters on one line.
+/// </summary>
+void printMetricsSummary(const Metrics& metrics, std::ostream& stream) {
+	const std::pair<const char*, const Histogram*> stages[] = {
+		{ "capture", &metrics.captureWait },
+		{ "reduce", &metrics.reduce },
+		{ "analysis", &metrics.analysis },
+		{ "render", &metrics.render },
+		{ "latency", &metrics.frameLatency }
+	};
+
+	stream << "Metrics (p50/p99 in US):";
+	for (const auto& [stage, histogram] : stages) {
+		stream << " " << stage << " " << (int)histogram->estimatePercentileUS(0.50) << "/" << (int)histogram->estimatePercentileUS(0.99);
+	}
+	stream << " jitter " << (int)metrics.renderJitter.estimatePercentileUS(0.99) << "/" << (int)(metrics.renderJitterMaxSeconds * 1e6);
+	stream << " | dropped frames: " << metrics.droppedFrames << ", skipped renders: " << metrics.skippedRenders << ", missed ticks: " << metrics.missedRenderTicks
+		<< ", skipped zones: " << metrics.skippedZones << ", reconnects: " << metrics.reconnects
+		<< ", quality level: " << metrics.qualityLevel << (metrics.idle ? ", idle" : "") << std::endl;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+
+#include "Metrics.h"
+
+/// <summary>
+/// Periodically writes the metrics as a Prometheus text file (for the textfile collector of node_exporter),
+/// so the latency of a deployed unit can be seen without a debug build.
+/// The file is written to a temporary file first and then renamed, so a reader never sees half a file.
+///
+/// Runs on its own (not pinned) thread and only reads the atomics in Metrics, so it never blocks the stages.
+/// In a DEBUG build a summary is also printed every interval.
+/// </summary>
+class MetricsExporter
+{
+public:
+	// Constructor
+	MetricsExporter(const Metrics& metrics, std::string filePath, int intervalMS);
+	~MetricsExporter();
+
+	// Methods
+	void start();
+	void stop();
+	bool writeFile() const;
+
+private:
+	// Methods
+	void exportLoop();
+
+	// Members
+	const Metrics& m_metrics;
+	std::string m_filePath;
+	int m_intervalMS;
+
+	std::thread m_thread;
+	std::mutex m_mutex; // <- Only for waking up the thread on stop
+	std::condition_variable m_wakeUp;
+	bool m_running = false;
+};
+
+void writePrometheusText(const Metrics& metrics, std::ostream& stream);
+void printMetricsSummary(const Metrics& metrics, std::ostream& stream);
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+
+#include "LedSink.h"
+
+/// <summary>
+/// A LedSink that acts like a WS281x strip without the hardware: it keeps the last rendered colors
+/// and takes as long as the transfer to a real strip would.
+///
+/// Like rpi_ws281x, a render waits for the transfer of the previous render and then starts its own transfer in the background.
+/// A WS281x bit takes 1.25 us (800 kHz), every led has 24 bits (32 for RGBW) and every transfer ends with a 55 us reset.
+/// Used to check the mapping of the leds to the outputs and the render rate of a layout.
+/// </summary>
+class MockLedSink : public LedSink
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Constructor
+	MockLedSink(int bitsPerLed = 24) : m_bitsPerLed(bitsPerLed) { }
+
+	// Methods
+	bool init() override { return true; }
+
+	bool render(const std::vector<uint32_t>& ledColors) override {
+		std::this_thread::sleep_until(m_transferEndTime); // <- Waits for the previous transfer, like ws2811_wait
+
+		const auto transferTime = std::chrono::nanoseconds(ledColors.size() * m_bitsPerLed * 1250) + std::chrono::microseconds(55);
+		m_transferEndTime = Clock::now() + transferTime;
+		m_totalTransferTime += transferTime;
+
+		m_ledColors = ledColors;
+		m_renderCount++;
+		return true;
+	}
+
+	void fini() override { std::this_thread::sleep_until(m_transferEndTime); }
+
+	// Getters & setters
+	const char* getName() const override { return "mock"; }
+	const std::vector<uint32_t>& getLedColors() const { return m_ledColors; } // <- Of the last render
+	uint64_t getRenderCount() const { return m_renderCount; }
+	Clock::duration getTotalTransferTime() const { return m_totalTransferTime; }
+
+private:
+	// Members
+	int m_bitsPerLed;
+	std::vector<uint32_t> m_ledColors;
+	uint64_t m_renderCount = 0;
+	Clock::time_point m_transferEndTime;
+	Clock::duration m_totalTransferTime = Clock::duration::zero();
+};
@@ -0,0 +1,199 @@
+#include "MultiLedSink.h"
+#include "const_config.h"
+
+#ifdef WITH_WS2811
+#include "Ws2811LedSink.h"
+#endif
+
+#include <iterator>
+
+MultiLedSink::MultiLedSink(const std::vector<LedSegment>& segments)
+	: m_segments(segments) { }
+
+MultiLedSink::~MultiLedSink() {
+	this->fini();
+}
+
+/// <summary>
+/// Adds a output that gets the leds of the given channels, must be called before init.
+/// </summary>
+/// <param name="sink">The output, not initialized yet</param>
+/// <param name="channels">The channels the output renders, the leds of the first channel first</param>
+void MultiLedSink::addOutput(std::unique_ptr<LedSink> sink, const std::vector<int>& channels) {
+	auto output = std::make_unique<Output>();
+	output->sink = std::move(sink);
+
+	for (int channel : channels) {
+		for (const LedSegment& segment : m_segments) {
+			if (segment.channel != channel) continue;
+
+			for (unsigned int i = 0; i < segment.ledCount; i++) {
+				output->ledIndices.push_back(segment.reversed ? segment.firstLed + segment.ledCount - 1 - i : segment.firstLed + i);
+			}
+		}
+	}
+	output->colors.resize(output->ledIndices.size());
+
+	m_name += (m_name.empty() ? "" : " + ") + std::string(output->sink->getName());
+	m_outputs.push_back(std::move(output));
+}
+
+/// <summary>
+/// Initializes every output and starts a thread for every output but the first.
+/// </summary>
+/// <returns>If all outputs are ready to render</returns>
+bool MultiLedSink::init() {
+	for (size_t i = 0; i < m_outputs.size(); i++) {
+		if (m_outputs[i]->sink->init()) continue;
+
+		for (size_t j = 0; j < i; j++) {
+			m_outputs[j]->sink->fini();
+		}
+		return false;
+	}
+
+	m_stopping = false;
+	for (size_t i = 1; i < m_outputs.size(); i++) {
+		m_outputs[i]->thread = std::thread(&MultiLedSink::renderLoop, this, std::ref(*m_outputs[i]), m_renderGeneration);
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Splits the colors over the outputs and renders all outputs at the same time.
+/// </summary>
+/// <param name="ledColors">A color per led, in the order of LED_ORDER</param>
+/// <returns>If every output is rendered succesfully</returns>
+bool MultiLedSink::render(const std::vector<uint32_t>& ledColors) {
+	for (std::unique_ptr<Output>& output : m_outputs) {
+		for (size_t i = 0; i < output->ledIndices.size(); i++) {
+			const uint32_t ledIndex = output->ledIndices[i];
+			output->colors[i] = (ledIndex < ledColors.size()) ? ledColors[ledIndex] : 0;
+		}
+	}
+
+	if (m_outputs.size() > 1) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pendingOutputs = m_outputs.size() - 1;
+		m_renderGeneration++;
+	}
+	m_renderStarted.notify_all();
+
+	bool rendered = m_outputs.empty() || m_outputs[0]->sink->render(m_outputs[0]->colors);
+
+	if (m_outputs.size() > 1) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_renderDone.wait(lock, [this]() { return m_pendingOutputs == 0; });
+
+		for (size_t i = 1; i < m_outputs.size(); i++) {
+			rendered &= m_outputs[i]->rendered;
+		}
+	}
+
+	return rendered;
+}
+
+/// <summary>
+/// Renders a output (not the first) every time a render is started.
+/// </summary>
+/// <param name="renderedGeneration">The generation when the thread was started, so a render that comes before the thread runs is not missed</param>
+void MultiLedSink::renderLoop(Output& output, uint64_t renderedGeneration) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true) {
+		m_renderStarted.wait(lock, [&]() { return m_stopping || m_renderGeneration != renderedGeneration; });
+		if (m_stopping) return;
+		renderedGeneration = m_renderGeneration;
+
+		lock.unlock();
+		bool rendered = output.sink->render(output.colors);
+		lock.lock();
+
+		output.rendered = rendered;
+		if (--m_pendingOutputs == 0) m_renderDone.notify_one();
+	}
+}
+
+/// <summary>
+/// Stops the output threads and turns off every output.
+/// </summary>
+void MultiLedSink::fini() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_renderStarted.notify_all();
+
+	for (std::unique_ptr<Output>& output : m_outputs) {
+		if (output->thread.joinable()) output->thread.join();
+		output->sink->fini();
+	}
+}
+
+/// <summary>
+/// Creates the outputs of the given channels, with the leds of the given segments.
+/// All WS2811 channels share one Ws2811LedSink (one DMA transfer for both PWM channels), every other channel gets its own LedSink.
+/// </summary>
+/// <param name="ledCount">The amount of leds the segments are taken from</param>
+/// <returns>The created LedSink or nullptr if the layout is not valid or a output is not available in this build</returns>
+std::unique_ptr<LedSink> createLedOutput(const std::vector<LedChannel>& channels, const std::vector<LedSegment>& segments, unsigned int ledCount) {
+	std::vector<int> channelLedCounts(channels.size(), 0);
+	for (const LedSegment& segment : segments) {
+		if (segment.channel < 0 || segment.channel >= (int)channels.size()) {
+			LOG_ERROR("A led segment is on channel " << segment.channel << ", but there are only " << channels.size() << " channels.");
+			return nullptr;
+		}
+		if (segment.firstLed + segment.ledCount > ledCount) {
+			LOG_ERROR("A led segment goes to led " << segment.firstLed + segment.ledCount << ", but there are only " << ledCount << " leds.");
+			return nullptr;
+		}
+
+		channelLedCounts[segment.channel] += segment.ledCount;
+	}
+
+	auto multiLedSink = std::make_unique<MultiLedSink>(segments);
+
+	std::vector<int> ws2811ChannelIndices;
+	for (int c = 0; c < (int)channels.size(); c++) {
+		if (channels[c].type == LedSinkType::WS2811) {
+			ws2811ChannelIndices.push_back(c);
+			continue;
+		}
+
+		std::unique_ptr<LedSink> sink = createLedSink(channels[c].type, channels[c].host);
+		if (!sink) return nullptr;
+		multiLedSink->addOutput(std::move(sink), { c });
+	}
+
+	if (!ws2811ChannelIndices.empty()) {
+#ifdef WITH_WS2811
+		if (ws2811ChannelIndices.size() > RPI_PWM_CHANNELS) {
+			LOG_ERROR("There are " << ws2811ChannelIndices.size() << " ws2811 channels, but the Pi only has " << RPI_PWM_CHANNELS << " PWM channels.");
+			return nullptr;
+		}
+
+		std::vector<Ws2811Channel> ws2811Channels;
+		for (int c : ws2811ChannelIndices) {
+			ws2811Channels.push_back({ channels[c].gpioPin, channelLedCounts[c] });
+		}
+		multiLedSink->addOutput(std::make_unique<Ws2811LedSink>(ws2811Channels), ws2811ChannelIndices);
+#else
+		LOG_INFO("The ws2811 led sink is not available, the program is build without rpi_ws281x.");
+		return nullptr;
+#endif
+	}
+
+	return multiLedSink;
+}
+
+/// <summary>
+/// Creates the outputs of LED_CHANNELS and LED_SEGMENTS in the config.
+/// </summary>
+std::unique_ptr<LedSink> createLedOutput() {
+	return createLedOutput(
+		std::vector<LedChannel>(std::begin(Config::LED_CHANNELS), std::end(Config::LED_CHANNELS)),
+		std::vector<LedSegment>(std::begin(Config::LED_SEGMENTS), std::end(Config::LED_SEGMENTS)),
+		Config::LED_COUNTS.all()
+	);
+}
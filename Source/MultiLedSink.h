@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include "LedSink.h"
+
+/// <summary>
+/// A output channel: a strip (or other output) the leds of one or more segments are send to.
+/// </summary>
+struct LedChannel {
+	LedSinkType type;
+	int gpioPin = 0; // <- Only used by LedSinkType::WS2811, see Ws2811Channel
+	const char* host = nullptr; // <- Only used by LedSinkType::DDP, nullptr is DDP_HOST
+};
+
+/// <summary>
+/// A range of leds (in the order of LED_ORDER) that is send to one channel.
+/// </summary>
+struct LedSegment {
+	int channel; // <- Index of the channel
+	unsigned int firstLed;
+	unsigned int ledCount;
+	bool reversed = false; // <- The strip of this segment runs the other way
+};
+
+/// <summary>
+/// A LedSink that splits the leds over several outputs and renders them at the same time,
+/// so a long installation doesn't have to wait for one long strip.
+///
+/// Every output is a LedSink that gets the leds of its channels (in order), which are the leds of their segments (in order).
+/// The mapping is compiled to a index per output led once, so splitting the colors is one gather per output.
+/// The first output is rendered on the calling thread, every other output on its own thread.
+/// A render returns when all outputs are rendered.
+/// </summary>
+class MultiLedSink : public LedSink
+{
+public:
+	// Constructor
+	MultiLedSink(const std::vector<LedSegment>& segments);
+	~MultiLedSink();
+
+	// Methods
+	void addOutput(std::unique_ptr<LedSink> sink, const std::vector<int>& channels);
+	bool init() override;
+	bool render(const std::vector<uint32_t>& ledColors) override;
+	void fini() override;
+
+	// Getters & setters
+	const char* getName() const override { return m_name.c_str(); }
+	size_t getOutputCount() const { return m_outputs.size(); }
+	LedSink& getOutput(size_t index) { return *m_outputs[index]->sink; }
+
+private:
+	struct Output {
+		std::unique_ptr<LedSink> sink;
+		std::vector<uint32_t> ledIndices; // <- The led (in the order of LED_ORDER) of every led of this output
+		std::vector<uint32_t> colors;
+		bool rendered = false; // <- Result of the last render
+		std::thread thread; // <- Not used by the first output
+	};
+
+	// Methods
+	void renderLoop(Output& output, uint64_t renderedGeneration);
+
+	// Members
+	std::vector<LedSegment> m_segments;
+	std::vector<std::unique_ptr<Output>> m_outputs;
+	std::string m_name;
+
+	std::mutex m_mutex;
+	std::condition_variable m_renderStarted;
+	std::condition_variable m_renderDone;
+	uint64_t m_renderGeneration = 0; // <- Counts up for every render, so a output thread knows there is a new one
+	size_t m_pendingOutputs = 0;
+	bool m_stopping = false;
+};
+
+std::unique_ptr<LedSink> createLedOutput(const std::vector<LedChannel>& channels, const std::vector<LedSegment>& segments, unsigned int ledCount);
+std::unique_ptr<LedSink> createLedOutput();
@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "LedSink.h"
+
+/// <summary>
+/// A LedSink that throws the colors away.
+/// Used to measure the throughput of everything before the render, without a led-strip attached.
+/// </summary>
+class NullLedSink : public LedSink
+{
+public:
+	// Methods
+	bool init() override { return true; }
+	bool render(const std::vector<uint32_t>& ledColors) override { m_renderCount++; return true; }
+	void fini() override { }
+
+	// Getters & setters
+	const char* getName() const override { return "none"; }
+	uint64_t getRenderCount() const { return m_renderCount; }
+
+private:
+	// Members
+	uint64_t m_renderCount = 0;
+};
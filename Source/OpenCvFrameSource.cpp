@@ -0,0 +1,25 @@
+#include "OpenCvFrameSource.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+OpenCvFrameSource::OpenCvFrameSource(int videoCaptureIndex)
+	: m_videoCaptureIndex(videoCaptureIndex) { }
+
+bool OpenCvFrameSource::open() {
+	return m_vCap.open(m_videoCaptureIndex, cv::CAP_ANY);
+}
+
+void OpenCvFrameSource::close() {
+	m_vCap.release();
+}
+
+bool OpenCvFrameSource::read(Frame& frame) {
+	frame.bufferLease.reset();
+	frame.format = PixelFormat::BGR;
+
+	// The image can still be shared (with the preview), it gets a new one instead of being overwritten while it is read
+	if (frame.image.u && frame.image.u->refcount > 1) frame.image.release();
+
+	return m_vCap.read(frame.image); // <- Reuses the image of the frame when the size didn't change and it isn't shared
+}
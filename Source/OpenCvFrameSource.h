@@ -0,0 +1,30 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "FrameSource.h"
+
+/// <summary>
+/// A FrameSource that reads BGR frames with cv::VideoCapture.
+/// Works on every platform, but OpenCV copies and converts every frame to BGR.
+/// </summary>
+class OpenCvFrameSource : public FrameSource
+{
+public:
+	// Constructor
+	OpenCvFrameSource(int videoCaptureIndex);
+
+	// Methods
+	bool open() override;
+	void close() override;
+	bool read(Frame& frame) override;
+
+	// Getters & setters
+	bool isOpened() const override { return m_vCap.isOpened(); }
+	const char* getName() const override { return "opencv"; }
+
+private:
+	// Members
+	int m_videoCaptureIndex;
+	cv::VideoCapture m_vCap;
+};
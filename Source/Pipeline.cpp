@@ -0,0 +1,333 @@
+#include "Pipeline.h"
+#include "ZoneManager.h"
+#include "LedColors.h"
+#include "ColorInterpolator.h"
+#include "Metrics.h"
+#include "QualityGovernor.h"
+#include "IdleMonitor.h"
+#include "RealTime.h"
+#include "const_config.h"
+
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include "BorderRecorder.h"
+#endif
+
+#include <opencv2/core.hpp>
+
+Pipeline::Pipeline(CaptureConnection& captureConnection, ZoneManager& zoneManager, LedSink& ledSink)
+	: m_captureConnection(captureConnection), m_zoneManager(zoneManager), m_ledSink(ledSink),
+	m_ledFrames(LedFrame{ .colors = std::vector<cv::Vec3b>(zoneManager.getLEDCounts().all()) }),
+	m_letterboxDetector(Config::LETTERBOX_DETECTION_INTERVAL_FRAMES, Config::LETTERBOX_BLACK_LEVEL, Config::LETTERBOX_STABLE_DETECTIONS),
+	m_previewService(Config::PREVIEW_INTERVAL_FRAMES, Config::PREVIEW_WIDTH, Config::PREVIEW_JPEG_QUALITY, Config::PREVIEW_FILE_PATH, Config::PREVIEW_FILE_MAX_BYTES, Config::PREVIEW_PORT) { }
+
+Pipeline::~Pipeline() {
+	this->stop();
+}
+
+/// <summary>
+/// Starts the capture, analysis and render thread, with real-time priority in REAL_TIME mode.
+/// </summary>
+void Pipeline::start() {
+	if (m_running) return;
+	m_running = true;
+
+	if (Config::PREVIEW) m_previewService.start();
+	m_captureThread = std::thread(&Pipeline::captureLoop, this);
+	m_analysisThread = std::thread(&Pipeline::analysisLoop, this);
+	m_renderThread = std::thread(&Pipeline::renderLoop, this);
+
+	pinThreadToCore(m_captureThread, Config::CAPTURE_CPU_CORE);
+	pinThreadToCore(m_analysisThread, Config::ANALYSIS_CPU_CORE);
+	pinThreadToCore(m_renderThread, Config::RENDER_CPU_CORE);
+
+	if (Config::REAL_TIME) {
+		setThreadRealTimePriority(m_captureThread, Config::CAPTURE_REAL_TIME_PRIORITY);
+		setThreadRealTimePriority(m_analysisThread, Config::ANALYSIS_REAL_TIME_PRIORITY);
+		setThreadRealTimePriority(m_renderThread, Config::RENDER_REAL_TIME_PRIORITY);
+	}
+}
+
+/// <summary>
+/// Stops all threads and waits for them to finish.
+/// </summary>
+void Pipeline::stop() {
+	m_running = false;
+
+	// Wake up the stages that are waiting on the stage before them
+	m_frames.wakeUp();
+	m_ledFrames.wakeUp();
+
+	if (m_captureThread.joinable()) m_captureThread.join();
+	if (m_analysisThread.joinable()) m_analysisThread.join();
+	if (m_renderThread.joinable()) m_renderThread.join();
+
+	m_previewService.stop();
+}
+
+/// <summary>
+/// Capture stage: reads frames from the capture card and hands them to the analysis stage.
+/// </summary>
+void Pipeline::captureLoop() {
+	using Clock = std::chrono::steady_clock;
+	Metrics& metrics = getMetrics();
+	if (Config::REAL_TIME) prefaultStack(Config::REAL_TIME_STACK_PREFAULT_BYTES);
+
+	while (m_running) {
+		Clock::time_point startTime = Clock::now();
+
+		// Get frame from capture card (straight into the back slot, so nothing is copied)
+		// Note: waiting for the capture card to (re)connect is done by the CaptureConnection
+		if (!m_captureConnection.read(m_frames.back())) continue;
+
+		metrics.captureWait.observe(Clock::now() - startTime);
+		metrics.capturedFrames.fetch_add(1, std::memory_order_relaxed);
+
+		bool droppedFrame = m_frames.publish();
+		if (droppedFrame) metrics.droppedFrames.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/// <summary>
+/// Analysis stage: calculates the averages of the newest frame and turns them into led colors for the render stage.
+/// </summary>
+void Pipeline::analysisLoop() {
+	using Clock = std::chrono::steady_clock;
+	Metrics& metrics = getMetrics();
+	if (Config::REAL_TIME) prefaultStack(Config::REAL_TIME_STACK_PREFAULT_BYTES);
+
+#ifdef __linux__
+	// Recorded here, only the analysis stage knows the zones a frame is sampled with
+	std::unique_ptr<BorderRecorder> borderRecorder;
+	if (Config::BORDER_RECORDING) {
+		borderRecorder = std::make_unique<BorderRecorder>(Config::BORDER_RECORDING_FILE_PATH);
+		if (!borderRecorder->open(m_zoneManager.getLEDCounts())) borderRecorder.reset();
+	}
+#endif
+
+	QualityGovernor qualityGovernor(
+		std::vector<QualityLevel>(std::begin(Config::QUALITY_LEVELS), std::end(Config::QUALITY_LEVELS)),
+		std::chrono::milliseconds(Config::QUALITY_TARGET_LATENCY_MS), Config::QUALITY_MAX_TEMPERATURE_C, Config::SOC_TEMPERATURE_PATH
+	);
+
+	IdleMonitor idleMonitor(Config::IDLE_BLACK_LEVEL, std::chrono::milliseconds(Config::IDLE_BLACK_TIME_MS), std::chrono::milliseconds(Config::IDLE_PROBE_INTERVAL_MS));
+
+	while (m_frames.waitForUpdate(m_running)) {
+		Frame& frame = m_frames.front();
+
+		// While idle (black screen) only a few pixels of a frame are looked at now and then, till there is content again
+		if (Config::IDLE_MODE && idleMonitor.isIdle() && !idleMonitor.probe(frame, Clock::now())) continue;
+
+		// Skip the frames in between when the governor lowered the analysis rate, the render stage keeps interpolating
+		if (Config::QUALITY_GOVERNOR && !qualityGovernor.shouldAnalyse()) continue;
+		Clock::time_point startTime = Clock::now();
+
+		// Calculate averages in zones
+		m_zoneManager.calculateAverages(frame);
+		Clock::time_point reducedTime = Clock::now();
+
+		// Put the calculated averages in the order of the leds
+		LedFrame& ledFrame = m_ledFrames.back();
+		getLedColors(ledFrame.colors, m_zoneManager);
+		ledFrame.timestamp = frame.timestamp;
+		ledFrame.idle = Config::IDLE_MODE && idleMonitor.update(ledFrame.colors, startTime); // <- The render stage fades out
+		m_ledFrames.publish();
+		Clock::time_point publishedTime = Clock::now();
+
+#ifdef __linux__
+		if (borderRecorder) borderRecorder->record(frame, m_zoneManager);
+#endif
+
+		// Search for black bars, the zones are moved for the next frame (a replayed frame brings its own content rect)
+		if (Config::LETTERBOX_DETECTION && frame.contentRect.empty() && m_letterboxDetector.update(frame)) {
+			const cv::Rect& contentRect = m_letterboxDetector.getContentRect();
+			LOG_VERBOSE("Content changed to " << contentRect.width << "x" << contentRect.height
+				<< " at (" << contentRect.x << ", " << contentRect.y << "), moving zones...");
+			m_zoneManager.setContentRect(contentRect);
+		}
+
+		metrics.reduce.observe(reducedTime - startTime);
+		metrics.analysis.observe(Clock::now() - startTime);
+		metrics.analysedFrames.fetch_add(1, std::memory_order_relaxed);
+		metrics.calculatedZones.store(m_zoneManager.getCalculatedZoneCount(), std::memory_order_relaxed);
+		metrics.skippedZones.store(m_zoneManager.getSkippedZoneCount(), std::memory_order_relaxed);
+
+		// Hold the latency under the target, the new row stride is used from the next frame on
+		if (Config::QUALITY_GOVERNOR && qualityGovernor.update(publishedTime - frame.timestamp, publishedTime)) {
+			m_zoneManager.setRowStride(qualityGovernor.getLevel().rowStride);
+		}
+
+		// Drawn and encoded on the preview thread, here it only costs a counter (and a copy of the zones every interval)
+		if (Config::PREVIEW) {
+			m_previewService.offer(frame, m_zoneManager.getZoneTable());
+			if (m_previewService.isQuitRequested()) m_running = false;
+		}
+	}
+}
+
+/// <summary>
+/// Render stage: renders the led colors to the LedSink at RENDER_RATE_HZ,
+/// interpolating between the newest analysed colors.
+/// </summary>
+void Pipeline::renderLoop() {
+	using Clock = std::chrono::steady_clock;
+	Metrics& metrics = getMetrics();
+	if (Config::REAL_TIME) prefaultStack(Config::REAL_TIME_STACK_PREFAULT_BYTES);
+
+	const bool hasRenderClock = Config::RENDER_RATE_HZ > 0;
+	const Clock::duration renderPeriod = std::chrono::nanoseconds(1000000000LL / std::max(1, Config::RENDER_RATE_HZ));
+
+	ColorInterpolator interpolator(Config::LED_SMOOTHING_TIME_MS, hasRenderClock);
+	const ColorCorrection colorCorrection(Config::COLOR_CORRECTION); // <- The lookup tables are build once, here
+	// Allocated up front, the loop only reuses them
+	const size_t ledCount = m_zoneManager.getLEDCounts().all();
+	std::vector<cv::Vec3b> colors;
+	std::vector<uint32_t> ledColors;
+	std::vector<uint32_t> lastRenderedColors;
+	colors.reserve(ledCount);
+	ledColors.reserve(ledCount);
+	lastRenderedColors.reserve(ledCount);
+	double jitterMaxSeconds = 0.0;
+
+	// Nothing to render till the first frame is analysed
+	if (!m_ledFrames.waitForUpdate(m_running)) return;
+	interpolator.setTarget(m_ledFrames.front().colors, m_ledFrames.front().timestamp, Clock::now());
+	bool hasNewTarget = true; // <- For the frame latency, measured on the first render of a new target
+
+	// Idle: fade out when the analysis stage went idle or no frames come (no signal), see IDLE_MODE
+	const bool canFade = Config::IDLE_MODE && hasRenderClock;
+	const Clock::duration noSignalTimeout = std::chrono::milliseconds(Config::IDLE_NO_SIGNAL_TIMEOUT_MS);
+	const float fadeTimeMS = (float)std::max(1, Config::IDLE_FADE_TIME_MS);
+	Clock::time_point targetArrivalTime = Clock::now();
+	Clock::time_point fadeStartTime;
+	bool fading = false;
+
+	Clock::time_point nextRenderTime = Clock::now();
+	while (m_running) {
+		Clock::time_point now = Clock::now();
+
+		if (m_ledFrames.update()) {
+			interpolator.setTarget(m_ledFrames.front().colors, m_ledFrames.front().timestamp, now);
+			hasNewTarget = true;
+			targetArrivalTime = now;
+		}
+
+		interpolator.update(now);
+		interpolator.getColors(colors);
+
+		float brightness = 1.0f;
+		if (canFade && (m_ledFrames.front().idle || now - targetArrivalTime > noSignalTimeout)) {
+			if (!fading) fadeStartTime = now;
+			fading = true;
+
+			brightness = std::max(0.0f, 1.0f - std::chrono::duration<float, std::milli>(now - fadeStartTime).count() / fadeTimeMS);
+			scaleColors(colors, brightness);
+		}
+		else {
+			fading = false;
+		}
+		Clock::time_point interpolatedTime = Clock::now();
+
+		packLedColors(colors, ledColors, colorCorrection);
+		if (brightness == 0.0f) std::fill(ledColors.begin(), ledColors.end(), 0); // <- Off, the color correction can lift black (minimumBrightness)
+		Clock::time_point packedTime = Clock::now();
+
+		metrics.interpolate.observe(interpolatedTime - now);
+		metrics.pack.observe(packedTime - interpolatedTime);
+
+		// Only render when the colors changed, a ws2811_render of the same colors is wasted time (faded out is always rendered, whatever the threshold)
+		if (hasLedColorsChanged(ledColors, lastRenderedColors, brightness == 0.0f ? 0 : Config::RENDER_CHANGE_THRESHOLD)) {
+			handleRenderLedStrip(m_ledSink, ledColors);
+			lastRenderedColors = ledColors;
+
+			// Render time on its own, so the cost of the LedSink can be compared
+			metrics.render.observe(Clock::now() - packedTime);
+			metrics.renders.fetch_add(1, std::memory_order_relaxed);
+		}
+		else {
+			metrics.skippedRenders.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if (hasNewTarget) {
+			metrics.frameLatency.observe(Clock::now() - m_ledFrames.front().timestamp);
+			hasNewTarget = false;
+		}
+
+		// Faded out: nothing to render till there is a new frame, so wait for it instead of ticking the render clock
+		if (brightness == 0.0f) {
+			LOG_INFO("The led-strip is faded out, waiting for a new frame...");
+			metrics.idle.store(1, std::memory_order_relaxed);
+
+			if (!m_ledFrames.waitForUpdate(m_running)) break;
+
+			metrics.idle.store(0, std::memory_order_relaxed);
+			now = Clock::now();
+			interpolator.reset(); // <- Start at the new colors, not at the colors before the fade
+			interpolator.setTarget(m_ledFrames.front().colors, m_ledFrames.front().timestamp, now);
+			hasNewTarget = true;
+			targetArrivalTime = now;
+			fading = false;
+			nextRenderTime = now;
+			continue;
+		}
+
+		// Wait for the next tick of the render clock (or the next analysed frame without a render clock)
+		if (hasRenderClock) {
+			nextRenderTime += renderPeriod;
+			sleepUntil(nextRenderTime); // <- Returns right away when the tick already passed
+
+			// How late the tick is, like cyclictest measures it: against its deadline, so an overrun (slow LedSink, preempted) counts in full
+			const Clock::time_point wokeUpTime = Clock::now();
+			const Clock::duration jitter = wokeUpTime - nextRenderTime;
+			metrics.renderJitter.observe(jitter);
+			jitterMaxSeconds = std::max(jitterMaxSeconds, std::chrono::duration<double>(jitter).count());
+			metrics.renderJitterMaxSeconds.store(jitterMaxSeconds, std::memory_order_relaxed);
+
+			// Behind by one or more ticks, don't try to catch up: the missed ticks are skipped and the clock starts over from now
+			if (jitter >= renderPeriod) {
+				metrics.missedRenderTicks.fetch_add((uint64_t)(jitter / renderPeriod), std::memory_order_relaxed);
+				nextRenderTime = wokeUpTime;
+			}
+		}
+		else if (m_ledFrames.waitForUpdate(m_running)) {
+			interpolator.setTarget(m_ledFrames.front().colors, m_ledFrames.front().timestamp, Clock::now());
+			hasNewTarget = true;
+		}
+	}
+}
+
+/// <summary>
+/// Renders the given led colors to the LedSink.
+/// </summary>
+/// <param name="ledSink">A reference to the LedSink to render to.</param>
+/// <param name="ledColors">The colors per led, the interpolated colors packed by packLedColors.</param>
+bool handleRenderLedStrip(LedSink& ledSink, const std::vector<uint32_t>& ledColors) {
+	return ledSink.render(ledColors);
+}
+
+/// <summary>
+/// Pins the given thread to a CPU core. Does nothing when core is -1 or on non-linux platforms.
+/// </summary>
+/// <param name="thread">The thread to pin</param>
+/// <param name="core">Index of the CPU core, -1 to let the OS decide</param>
+void pinThreadToCore(std::thread& thread, int core) {
+#ifdef __linux__
+	if (core < 0) return;
+
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(core, &cpuSet);
+
+	int result = pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet);
+	if (result != 0) {
+		LOG_WARNING("Can't pin thread to CPU core " << core << "! Error code: " << result);
+	}
+#endif
+}
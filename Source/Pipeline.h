@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "ZoneManager.h"
+#include "CaptureConnection.h"
+#include "Frame.h"
+#include "LedSink.h"
+#include "LedColors.h"
+#include "TripleBuffer.h"
+#include "LetterboxDetector.h"
+#include "PreviewService.h"
+#include "Metrics.h"
+
+/// <summary>
+/// Runs the program as a pipeline of three stages, each on its own thread (and CPU core):
+/// - Capture: reads frames from the capture card, through the CaptureConnection that keeps it connected.
+/// - Analysis: calculates the zone averages and puts them in the order of the leds, and moves the zones when black bars are detected.
+/// - Render: interpolates the led colors on its own clock and sends them to the LedSink (the led-strip).
+///
+/// In REAL_TIME mode the stages run with SCHED_FIFO priorities, see RealTime.h. The render stage measures how late its clock ticks (the render jitter).
+///
+/// The stages hand over their results through lock-free triple buffers.
+/// A stage that is slower than the one before it skips the old results and always picks up the newest one,
+/// so the led-strip always shows the newest frame instead of a queue of old frames.
+///
+/// Every stage records its duration in the Metrics, see MetricsExporter.
+/// The zones can be checked on the preview of the PreviewService, it is drawn off the stages.
+/// </summary>
+class Pipeline
+{
+public:
+	// Constructor
+	Pipeline(CaptureConnection& captureConnection, ZoneManager& zoneManager, LedSink& ledSink);
+	~Pipeline();
+
+	// Methods
+	void start();
+	void stop();
+
+	// Getters & setters
+	bool isRunning() const { return m_running; }
+	uint64_t getDroppedFrameCount() const { return getMetrics().droppedFrames; }
+	uint64_t getRenderCount() const { return getMetrics().renders; }
+	uint64_t getSkippedRenderCount() const { return getMetrics().skippedRenders; }
+
+private:
+	// Methods
+	void captureLoop();
+	void analysisLoop();
+	void renderLoop();
+
+	// Members
+	CaptureConnection& m_captureConnection;
+	ZoneManager& m_zoneManager;
+	LedSink& m_ledSink;
+
+	TripleBuffer<Frame> m_frames; // <- Capture -> Analysis
+	TripleBuffer<LedFrame> m_ledFrames; // <- Analysis -> Render
+
+	LetterboxDetector m_letterboxDetector; // <- Only used by the analysis stage
+	PreviewService m_previewService; // <- Offered every analysed frame, runs on its own thread
+
+	std::atomic<bool> m_running = false; // <- The counters and stage durations are kept in getMetrics()
+
+	std::thread m_captureThread;
+	std::thread m_analysisThread;
+	std::thread m_renderThread;
+};
+
+bool handleRenderLedStrip(LedSink& ledSink, const std::vector<uint32_t>& ledColors);
+void pinThreadToCore(std::thread& thread, int core);
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+/// <summary>
+/// The layouts of the frames the zone averages can be calculated on.
+/// </summary>
+enum class PixelFormat {
+	BGR, // <- 3 bytes per pixel (CV_8UC3), what cv::VideoCapture gives
+	YUYV, // <- 4:2:2, 2 bytes per pixel (CV_8UC2): Y0 U Y1 V
+	NV12, // <- 4:2:0, a Y plane followed by a interleaved UV plane at half resolution (CV_8UC1, height * 3 / 2 rows)
+	BGR16, // <- BGR with 16 bits per channel (CV_16UC3)
+	Y210, // <- YUYV with 16 bit samples, 10 bits in the high bits (CV_16UC2)
+	P010 // <- NV12 with 16 bit samples, 10 bits in the high bits (CV_16UC1, height * 3 / 2 rows)
+};
+
+/*
+	The 16 bit samples are reduced on their top 10 bits (all bits P010 and Y210 have), the sums of a zone stay far from overflowing.
+	The average of a zone is kept as a fraction, so a 10 bit HDR source keeps its precision till the tone mapping.
+*/
+constexpr int HIGH_BIT_DEPTH_SHIFT = 6;
+
+/// <summary>
+/// If the format has 16 bit samples.
+/// </summary>
+constexpr bool isHighBitDepth(PixelFormat format) {
+	return format == PixelFormat::BGR16 || format == PixelFormat::Y210 || format == PixelFormat::P010;
+}
+
+/// <summary>
+/// The 8 bit format with the same layout of the samples, the 16 bit formats are read the same way as it.
+/// </summary>
+constexpr PixelFormat getLayout(PixelFormat format) {
+	switch (format) {
+	case PixelFormat::BGR16: return PixelFormat::BGR;
+	case PixelFormat::Y210: return PixelFormat::YUYV;
+	case PixelFormat::P010: return PixelFormat::NV12;
+	default: return format;
+	}
+}
+
+/// <summary>
+/// The type of a sample (a channel of a pixel) of the format.
+/// </summary>
+template<PixelFormat FORMAT>
+using SampleType = std::conditional_t<isHighBitDepth(FORMAT), uint16_t, uint8_t>;
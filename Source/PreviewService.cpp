@@ -0,0 +1,239 @@
+#include "PreviewService.h"
+#include "ZoneManager.h"
+#include "Logger.h"
+#include "const_config.h"
+
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/highgui.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+PreviewService::PreviewService(int intervalFrames, int width, int jpegQuality, std::string filePath, size_t fileMaxBytes, int port)
+	: m_intervalFrames(std::max(1, intervalFrames)), m_width(width), m_jpegQuality(jpegQuality), m_filePath(filePath), m_fileMaxBytes(fileMaxBytes), m_port(port) { }
+
+PreviewService::~PreviewService() {
+	this->stop();
+}
+
+/// <summary>
+/// Opens the outputs and starts the preview thread.
+/// </summary>
+void PreviewService::start() {
+	if (m_thread.joinable()) return;
+
+	if (!m_filePath.empty()) {
+		m_file = std::fopen(m_filePath.c_str(), "wb");
+		m_fileLength = 0;
+		if (!m_file) LOG_ERROR("Can't open preview file " << m_filePath << ": " << std::strerror(errno));
+	}
+	if (m_port > 0) this->openSocket();
+
+	m_running = true;
+	m_thread = std::thread(&PreviewService::previewLoop, this);
+}
+
+/// <summary>
+/// Stops the preview thread and closes the outputs.
+/// </summary>
+void PreviewService::stop() {
+	m_running = false;
+	m_snapshots.wakeUp();
+	if (m_thread.joinable()) m_thread.join();
+
+	if (m_file) std::fclose(m_file);
+	m_file = nullptr;
+
+#ifdef __linux__
+	for (int client : m_clients) ::close(client);
+	if (m_listenSocket != -1) ::close(m_listenSocket);
+#endif
+	m_clients.clear();
+	m_listenSocket = -1;
+}
+
+/// <summary>
+/// Called by the analysis stage for every analysed frame. Every intervalFrames frames the frame (the image is shared, not copied)
+/// and the zones are handed to the preview thread, the other frames cost a counter.
+/// </summary>
+/// <param name="frame">The analysed frame</param>
+/// <param name="zones">The zones the frame is analysed with, with their averages</param>
+void PreviewService::offer(const Frame& frame, const ZoneTable& zones) {
+	if (!m_running || m_offeredFrameCount++ % m_intervalFrames != 0) return;
+
+	Snapshot& snapshot = m_snapshots.back();
+	snapshot.frame = frame;
+	snapshot.zones.slots = zones.slots; // <- Copied into the vectors of the slot, they only allocate the first time
+	snapshot.zones.rects = zones.rects;
+	snapshot.zones.colors = zones.colors;
+	m_snapshots.publish();
+
+	// The slot we got back can still hold a snapshot the preview thread skipped, give its capture buffer back right away
+	m_snapshots.back().frame.release();
+}
+
+void PreviewService::previewLoop() {
+#ifdef __linux__
+	// Only runs when the cores have nothing else to do, so it never takes time from the pipeline
+	sched_param schedParam = {};
+	int result = pthread_setschedparam(pthread_self(), SCHED_IDLE, &schedParam);
+	if (result != 0) LOG_WARNING("Can't lower the priority of the preview thread! Error code: " << result);
+#endif
+
+#if DEBUG_WINDOW
+	const std::string windowName = "TV ambient lighting (Raspberry pi) - DEBUG";
+	cv::namedWindow(windowName);
+#endif
+
+	while (m_snapshots.waitForUpdate(m_running)) {
+		this->render(m_snapshots.front());
+
+		if (!cv::imencode(".jpg", m_previewImage, m_jpeg, { cv::IMWRITE_JPEG_QUALITY, m_jpegQuality })) {
+			LOG_ERROR("Can't encode the preview!");
+			continue;
+		}
+		this->publish(m_jpeg);
+
+#if DEBUG_WINDOW
+		cv::imshow(windowName, m_previewImage);
+		char pressedKey = cv::waitKey(1); // <- Is needed to handle OpenCV GUI events (like imshow) (I know its stupid, waitKey??)
+		if (pressedKey == 'q' || pressedKey == 'Q') m_quitRequested = true;
+#endif
+	}
+}
+
+/// <summary>
+/// Downscales the frame of the snapshot to the preview width and draws the zones on it.
+/// The frame is released as soon as it is downscaled, so the capture buffer is given back before the slow part (drawing and encoding).
+/// </summary>
+void PreviewService::render(Snapshot& snapshot) {
+	convertToBGR(snapshot.frame, m_bgrImage);
+
+	const double scale = (m_width > 0 && m_width < m_bgrImage.cols) ? (double)m_width / m_bgrImage.cols : 1.0;
+	if (scale < 1.0) {
+		cv::resize(m_bgrImage, m_previewImage, cv::Size(m_width, std::max(1, (int)std::lround(m_bgrImage.rows * scale))), 0, 0, cv::INTER_AREA);
+	}
+	else {
+		m_bgrImage.copyTo(m_previewImage);
+	}
+
+	// A BGR frame isn't converted, the image shares the capture buffer, so it is dropped together with the frame
+	if (m_bgrImage.data == snapshot.frame.image.data) m_bgrImage.release();
+	snapshot.frame.release();
+
+	drawZones(m_previewImage, snapshot.zones, true, scale);
+}
+
+/// <summary>
+/// Appends the JPEG to the MJPEG file (started over when it reached its max size) and sends it to every client of the socket.
+/// </summary>
+void PreviewService::publish(const std::vector<uint8_t>& jpeg) {
+	if (m_file) {
+		if (m_fileLength + jpeg.size() > m_fileMaxBytes) {
+			m_file = std::freopen(m_filePath.c_str(), "wb", m_file);
+			m_fileLength = 0;
+			if (!m_file) LOG_ERROR("Can't start the preview file " << m_filePath << " over: " << std::strerror(errno));
+		}
+		if (m_file) {
+			m_fileLength += std::fwrite(jpeg.data(), 1, jpeg.size(), m_file);
+			std::fflush(m_file);
+		}
+	}
+
+#ifdef __linux__
+	if (m_listenSocket == -1) return;
+	this->acceptClients();
+
+	const std::string partHeader = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: " + std::to_string(jpeg.size()) + "\r\n\r\n";
+	for (size_t i = 0; i < m_clients.size();) {
+		// Never waits on a client, one that can't keep up (its socket buffer is full) is dropped
+		const int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+		bool sent = send(m_clients[i], partHeader.data(), partHeader.size(), flags) == (ssize_t)partHeader.size()
+			&& send(m_clients[i], jpeg.data(), jpeg.size(), flags) == (ssize_t)jpeg.size()
+			&& send(m_clients[i], "\r\n", 2, flags) == 2;
+
+		if (sent) {
+			i++;
+			continue;
+		}
+
+		LOG_VERBOSE("Preview client dropped.");
+		::close(m_clients[i]);
+		m_clients.erase(m_clients.begin() + i);
+	}
+#endif
+}
+
+/// <summary>
+/// Listens on 127.0.0.1:port, only on linux.
+/// </summary>
+/// <returns>If the socket is listening</returns>
+bool PreviewService::openSocket() {
+#ifdef __linux__
+	m_listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (m_listenSocket == -1) {
+		LOG_ERROR("Can't create the preview socket: " << std::strerror(errno));
+		return false;
+	}
+
+	int reuseAddress = 1;
+	setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons((uint16_t)m_port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(m_listenSocket, (sockaddr*)&address, sizeof(address)) == -1 || listen(m_listenSocket, 4) == -1) {
+		LOG_ERROR("Can't listen for preview clients on port " << m_port << ": " << std::strerror(errno));
+		::close(m_listenSocket);
+		m_listenSocket = -1;
+		return false;
+	}
+
+	LOG_INFO("Preview at http://127.0.0.1:" << m_port << "/");
+	return true;
+#else
+	LOG_WARNING("The preview socket is only available on linux.");
+	return false;
+#endif
+}
+
+/// <summary>
+/// Accepts the clients that connected since the last preview and answers them with the header of the MJPEG stream.
+/// The request itself isn't read, every path gives the stream.
+/// </summary>
+void PreviewService::acceptClients() {
+#ifdef __linux__
+	static const char* const RESPONSE_HEADER =
+		"HTTP/1.0 200 OK\r\n"
+		"Cache-Control: no-cache\r\n"
+		"Connection: close\r\n"
+		"Content-Type: multipart/x-mixed-replace; boundary=frame\r\n\r\n";
+
+	int client;
+	while ((client = accept4(m_listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+		const size_t headerLength = std::strlen(RESPONSE_HEADER);
+		if (send(client, RESPONSE_HEADER, headerLength, MSG_NOSIGNAL) != (ssize_t)headerLength) {
+			::close(client);
+			continue;
+		}
+
+		LOG_VERBOSE("Preview client connected.");
+		m_clients.push_back(client);
+	}
+#endif
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+#include <opencv2/core.hpp>
+
+#include "Frame.h"
+#include "ZoneTable.h"
+#include "TripleBuffer.h"
+
+/// <summary>
+/// Shows the zones on a downscaled copy of the frame, to check the zone alignment of a running unit without a screen.
+///
+/// The analysis stage offers every frame, but only every intervalFrames frames a snapshot (the frame and the zones) is handed over,
+/// through a triple buffer so the analysis stage never waits. Converting, downscaling, drawing and encoding is done on its own low priority thread.
+/// The snapshot is published as MJPEG: appended to a file (started over when it gets too big) and/or streamed to the clients of a local HTTP socket.
+/// With DEBUG_WINDOW it is also shown in a window.
+///
+/// Note: the frame of a snapshot is shared with the frame source until it is downscaled, so the preview holds up to 2 capture buffers.
+/// A frame source that reuses its images must not write into an image that is still shared (see OpenCvFrameSource::read).
+/// </summary>
+class PreviewService
+{
+public:
+	// Constructor
+	PreviewService(int intervalFrames, int width, int jpegQuality, std::string filePath, size_t fileMaxBytes, int port);
+	~PreviewService();
+
+	// Methods
+	void start();
+	void stop();
+	void offer(const Frame& frame, const ZoneTable& zones);
+
+	// Getters & setters
+	bool isQuitRequested() const { return m_quitRequested; } // <- 'q' is pressed in the DEBUG_WINDOW
+
+private:
+	struct Snapshot {
+		Frame frame;
+		ZoneTable zones;
+	};
+
+	// Methods
+	void previewLoop();
+	void render(Snapshot& snapshot);
+	void publish(const std::vector<uint8_t>& jpeg);
+	bool openSocket();
+	void acceptClients();
+
+	// Members
+	int m_intervalFrames;
+	int m_width;
+	int m_jpegQuality;
+	std::string m_filePath;
+	size_t m_fileMaxBytes;
+	int m_port;
+
+	TripleBuffer<Snapshot> m_snapshots; // <- Analysis stage -> preview thread
+	uint64_t m_offeredFrameCount = 0; // <- Only touched by the analysis stage
+
+	cv::Mat m_bgrImage;
+	cv::Mat m_previewImage;
+	std::vector<uint8_t> m_jpeg;
+
+	FILE* m_file = nullptr;
+	size_t m_fileLength = 0;
+	int m_listenSocket = -1;
+	std::vector<int> m_clients;
+
+	std::thread m_thread;
+	std::atomic<bool> m_running = false;
+	std::atomic<bool> m_quitRequested = false;
+};
@@ -0,0 +1,121 @@
+#include "QualityGovernor.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include "const_config.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+QualityGovernor::QualityGovernor(const std::vector<QualityLevel>& levels, Clock::duration targetLatency, float maxTemperature, std::string temperaturePath)
+	: m_levels(levels), m_targetLatency(targetLatency), m_maxTemperature(maxTemperature), m_temperaturePath(temperaturePath),
+	m_temperature(NAN), m_nextDecisionTime(Clock::now() + std::chrono::milliseconds(Config::QUALITY_DECISION_INTERVAL_MS)) {
+	if (m_levels.empty()) m_levels.push_back(QualityLevel());
+
+	getMetrics().qualityLevel.store(0, std::memory_order_relaxed);
+
+#ifdef __linux__
+	m_temperatureFd = ::open(m_temperaturePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (m_temperatureFd == -1) LOG_VERBOSE("No SoC temperature sensor at " << m_temperaturePath << ", the quality governor only looks at the latency.");
+#endif
+}
+
+QualityGovernor::~QualityGovernor() {
+#ifdef __linux__
+	if (m_temperatureFd != -1) ::close(m_temperatureFd);
+#endif
+}
+
+/// <summary>
+/// Reads the temperature of the SoC, the sysfs file holds millidegrees.
+/// The file stays open, sysfs gives the current value on every read from the start of it.
+/// </summary>
+/// <returns>In degrees Celsius, NAN when there is no sensor (not a Pi, or not linux)</returns>
+float QualityGovernor::readTemperature() const {
+#ifdef __linux__
+	if (m_temperatureFd == -1) return NAN;
+
+	char text[32];
+	const ssize_t length = pread(m_temperatureFd, text, sizeof(text) - 1, 0);
+	if (length <= 0) return NAN;
+	text[length] = '\0';
+
+	char* end = nullptr;
+	const long milliDegrees = std::strtol(text, &end, 10);
+	if (end == text) return NAN;
+
+	return milliDegrees / 1000.0f;
+#else
+	return NAN;
+#endif
+}
+
+/// <summary>
+/// Counts the captured frames, with a analysis interval above 1 the frames in between are skipped.
+/// </summary>
+/// <returns>If this frame has to be analysed</returns>
+bool QualityGovernor::shouldAnalyse() {
+	return m_frameCounter++ % this->getLevel().analysisInterval == 0;
+}
+
+void QualityGovernor::setLevel(size_t levelIndex, const char* reason) {
+	m_levelIndex = levelIndex;
+	m_frameCounter = 0;
+
+	const QualityLevel& level = this->getLevel();
+	LOG_INFO("Quality level " << levelIndex << " (" << reason << "): sampling every " << level.rowStride
+		<< " rows, analysing every " << level.analysisInterval << " frames.");
+
+	Metrics& metrics = getMetrics();
+	metrics.qualityLevel.store((int)levelIndex, std::memory_order_relaxed);
+	metrics.qualityChanges.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Adds the latency of a analysed frame and decides on the quality level at the end of every decision interval.
+/// Steps down when the average latency is above the target or the SoC is too hot.
+/// Steps up when the latency stayed below 60% of the target (and the SoC 5 degrees below its limit) for QUALITY_RECOVER_INTERVALS intervals,
+/// the headroom keeps it from stepping up and down all the time.
+/// </summary>
+/// <param name="latency">Captured till analysed, of the frame that was just analysed</param>
+/// <returns>If the quality level changed</returns>
+bool QualityGovernor::update(Clock::duration latency, Clock::time_point now) {
+	m_latencySum += latency;
+	m_latencyCount++;
+
+	if (now < m_nextDecisionTime) return false;
+	m_nextDecisionTime = now + std::chrono::milliseconds(Config::QUALITY_DECISION_INTERVAL_MS);
+
+	const Clock::duration averageLatency = m_latencySum / std::max(m_latencyCount, 1);
+	m_latencySum = Clock::duration::zero();
+	m_latencyCount = 0;
+
+	m_temperature = this->readTemperature();
+	getMetrics().socTemperatureCelsius.store(m_temperature, std::memory_order_relaxed);
+	const bool hot = !std::isnan(m_temperature) && m_temperature >= m_maxTemperature;
+	const bool cool = std::isnan(m_temperature) || m_temperature < m_maxTemperature - 5.0f;
+
+	if (averageLatency > m_targetLatency || hot) {
+		m_calmIntervals = 0;
+		if (m_levelIndex + 1 >= m_levels.size()) return false;
+
+		this->setLevel(m_levelIndex + 1, hot ? "SoC too hot" : "latency above target");
+		return true;
+	}
+
+	if (averageLatency * 10 < m_targetLatency * 6 && cool) {
+		if (++m_calmIntervals < Config::QUALITY_RECOVER_INTERVALS || m_levelIndex == 0) return false;
+
+		m_calmIntervals = 0;
+		this->setLevel(m_levelIndex - 1, "room below target");
+		return true;
+	}
+
+	m_calmIntervals = 0;
+	return false;
+}
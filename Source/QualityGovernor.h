@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+/// <summary>
+/// A step on the quality ladder of the QualityGovernor, from the full quality down.
+/// </summary>
+struct QualityLevel {
+	int rowStride = 1; // <- Only every this many rows of the zones are sampled, see ZoneManager::setRowStride
+	int analysisInterval = 1; // <- Only every this many captured frames are analysed, the render stage keeps interpolating in between
+};
+
+/// <summary>
+/// Holds the analysis latency (captured till analysed) under a target when the CPU can't keep up, for example when the Pi throttles because it is too hot.
+///
+/// The analysis stage reports the latency of every frame. Every decision interval the governor compares the average latency with the target
+/// and reads the temperature of the SoC: when the latency is above the target (or the SoC is too hot) it steps down the quality ladder,
+/// when there is plenty of room (and the SoC cooled down) for a few intervals in a row it steps back up.
+/// Every step is logged and counted in the Metrics.
+/// </summary>
+class QualityGovernor
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Constructor
+	QualityGovernor(const std::vector<QualityLevel>& levels, Clock::duration targetLatency, float maxTemperature, std::string temperaturePath);
+	~QualityGovernor();
+	QualityGovernor(const QualityGovernor&) = delete;
+	QualityGovernor& operator=(const QualityGovernor&) = delete;
+
+	// Methods
+	bool shouldAnalyse();
+	bool update(Clock::duration latency, Clock::time_point now);
+
+	// Getters & setters
+	const QualityLevel& getLevel() const { return m_levels[m_levelIndex]; }
+	int getLevelIndex() const { return (int)m_levelIndex; }
+	float getTemperature() const { return m_temperature; } // <- In degrees Celsius, NAN when there is no sensor
+
+private:
+	// Methods
+	float readTemperature() const;
+	void setLevel(size_t levelIndex, const char* reason);
+
+	// Members
+	std::vector<QualityLevel> m_levels;
+	Clock::duration m_targetLatency;
+	float m_maxTemperature;
+	std::string m_temperaturePath;
+	int m_temperatureFd = -1; // <- Kept open, so a read on the analysis stage doesn't open a file or allocate
+
+	size_t m_levelIndex = 0;
+	float m_temperature;
+	uint64_t m_frameCounter = 0; // <- For the analysis interval
+
+	Clock::time_point m_nextDecisionTime;
+	Clock::duration m_latencySum = Clock::duration::zero(); // <- Of the current decision interval
+	int m_latencyCount = 0;
+	int m_calmIntervals = 0; // <- Decision intervals in a row with room to step back up
+};
@@ -0,0 +1,115 @@
+#include "RawFileFrameSource.h"
+#include "Logger.h"
+
+#include <thread>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <opencv2/core.hpp>
+
+RawFileFrameSource::RawFileFrameSource(std::string filePath, Dimensions dimensions, PixelFormat format, int framesPerSecond)
+	: m_filePath(filePath), m_dimensions(dimensions), m_format(format),
+	m_frameInterval(std::chrono::nanoseconds(1000000000LL / (framesPerSecond > 0 ? framesPerSecond : 1))) { }
+
+RawFileFrameSource::~RawFileFrameSource() {
+	this->close();
+}
+
+size_t RawFileFrameSource::getFrameSize() const {
+	size_t pixelCount = (size_t)m_dimensions.width * m_dimensions.height;
+	switch (m_format) {
+	case PixelFormat::BGR: return pixelCount * 3;
+	case PixelFormat::YUYV: return pixelCount * 2;
+	case PixelFormat::NV12: return pixelCount * 3 / 2;
+	case PixelFormat::BGR16: return pixelCount * 6;
+	case PixelFormat::Y210: return pixelCount * 4;
+	case PixelFormat::P010: return pixelCount * 3;
+	}
+	return 0;
+}
+
+bool RawFileFrameSource::open() {
+	this->close();
+
+	int fd = ::open(m_filePath.c_str(), O_RDONLY);
+	if (fd == -1) {
+		LOG_ERROR("Can't open raw frame file " << m_filePath << ": " << std::strerror(errno));
+		return false;
+	}
+
+	struct stat fileStat = {};
+	fstat(fd, &fileStat);
+	m_length = (size_t)fileStat.st_size;
+	m_frameCount = (getFrameSize() > 0 ? m_length / getFrameSize() : 0);
+	if (m_frameCount == 0) {
+		LOG_ERROR("Raw frame file " << m_filePath << " doesn't hold a single frame of the configured size!");
+		::close(fd);
+		return false;
+	}
+
+	// Private + writable, so drawing on a frame for debugging doesn't touch the file
+	void* data = mmap(nullptr, m_length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {
+		LOG_ERROR("Can't mmap raw frame file " << m_filePath << ": " << std::strerror(errno));
+		return false;
+	}
+
+	size_t length = m_length;
+	m_mapping = std::shared_ptr<unsigned char>((unsigned char*)data, [length](unsigned char* data) {
+		munmap(data, length);
+	});
+	m_frameIndex = 0;
+	m_nextFrameTime = std::chrono::steady_clock::now();
+	return true;
+}
+
+/// <summary>
+/// Releases the file. It stays mapped till the last frame using it is released.
+/// </summary>
+void RawFileFrameSource::close() {
+	m_mapping.reset();
+}
+
+bool RawFileFrameSource::read(Frame& frame) {
+	frame.release();
+
+	if (!m_mapping) return false;
+
+	// Play back at the frame rate of a capture card
+	std::this_thread::sleep_until(m_nextFrameTime);
+	m_nextFrameTime += m_frameInterval;
+
+	unsigned char* start = m_mapping.get() + getFrameSize() * m_frameIndex;
+	m_frameIndex = (m_frameIndex + 1) % m_frameCount;
+
+	switch (m_format) {
+	case PixelFormat::BGR:
+		frame.image = cv::Mat(m_dimensions.height, m_dimensions.width, CV_8UC3, start);
+		break;
+	case PixelFormat::YUYV:
+		frame.image = cv::Mat(m_dimensions.height, m_dimensions.width, CV_8UC2, start);
+		break;
+	case PixelFormat::NV12:
+		frame.image = cv::Mat(m_dimensions.height * 3 / 2, m_dimensions.width, CV_8UC1, start);
+		break;
+	case PixelFormat::BGR16:
+		frame.image = cv::Mat(m_dimensions.height, m_dimensions.width, CV_16UC3, start);
+		break;
+	case PixelFormat::Y210:
+		frame.image = cv::Mat(m_dimensions.height, m_dimensions.width, CV_16UC2, start);
+		break;
+	case PixelFormat::P010:
+		frame.image = cv::Mat(m_dimensions.height * 3 / 2, m_dimensions.width, CV_16UC1, start);
+		break;
+	}
+	frame.format = m_format;
+	frame.bufferLease = m_mapping;
+
+	return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <chrono>
+#include <memory>
+#include <cstddef>
+
+#include "FrameSource.h"
+#include "PixelFormat.h"
+
+/// <summary>
+/// A FrameSource that plays back a file of raw frames (for example a dump of a capture card made with v4l2-ctl),
+/// used as a stand-in for a capture card.
+/// The file is mmap'ed and the frames point straight into it, just like the V4L2 buffers. It loops at the given frame rate.
+/// </summary>
+class RawFileFrameSource : public FrameSource
+{
+public:
+	// Constructor
+	RawFileFrameSource(std::string filePath, Dimensions dimensions, PixelFormat format, int framesPerSecond);
+	~RawFileFrameSource();
+
+	// Methods
+	bool open() override;
+	void close() override;
+	bool read(Frame& frame) override;
+
+	// Getters & setters
+	bool isOpened() const override { return m_mapping != nullptr; }
+	const char* getName() const override { return "raw-file"; }
+
+private:
+	// Methods
+	size_t getFrameSize() const;
+
+	// Members
+	std::string m_filePath;
+	Dimensions m_dimensions;
+	PixelFormat m_format;
+	std::chrono::nanoseconds m_frameInterval;
+
+	std::shared_ptr<unsigned char> m_mapping; // <- Unmapped when the last frame using it is released
+	size_t m_length = 0;
+	size_t m_frameCount = 0;
+	size_t m_frameIndex = 0;
+	std::chrono::steady_clock::time_point m_nextFrameTime;
+};
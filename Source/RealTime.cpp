@@ -0,0 +1,125 @@
+#include "RealTime.h"
+#include "Logger.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <alloca.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#endif
+
+/// <summary>
+/// Locks all memory of the program, now and what is mapped later (the frames, OpenCV), so it is never paged out.
+/// The heap is grown by heapPrefaultBytes and touched, and is never given back to the OS (or mmapped per allocation),
+/// so the allocations after start-up don't fault either.
+/// </summary>
+/// <returns>If the memory is locked</returns>
+bool lockMemory(size_t heapPrefaultBytes) {
+#ifdef __linux__
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+		LOG_WARNING("Can't lock the memory (run as root or raise the memlock limit): " << std::strerror(errno));
+		return false;
+	}
+
+	// Only once the memory is locked: freed memory stays in the heap, big allocations come from the (locked) heap too
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+
+	if (heapPrefaultBytes > 0) {
+		const long pageSize = sysconf(_SC_PAGESIZE);
+		volatile char* heap = (volatile char*)std::malloc(heapPrefaultBytes);
+		if (heap) {
+			for (size_t i = 0; i < heapPrefaultBytes; i += pageSize) heap[i] = 0;
+			std::free((void*)heap);
+		}
+	}
+
+	LOG_INFO("Memory locked, " << heapPrefaultBytes / (1024 * 1024) << " MB of heap prefaulted");
+	return true;
+#else
+	return false;
+#endif
+}
+
+/// <summary>
+/// Unlocks the memory that lockMemory locked (the heap stays as it is).
+/// </summary>
+void unlockMemory() {
+#ifdef __linux__
+	munlockall();
+#endif
+}
+
+#ifdef __linux__
+static bool setRealTimePriority(pthread_t thread, int priority) {
+	sched_param schedParam = {};
+	schedParam.sched_priority = priority > 0 ? priority : 0;
+
+	int result = pthread_setschedparam(thread, priority > 0 ? SCHED_FIFO : SCHED_OTHER, &schedParam);
+	if (result != 0) {
+		LOG_WARNING("Can't give the thread real-time priority " << priority << " (run as root or give CAP_SYS_NICE)! Error code: " << result);
+		return false;
+	}
+	return true;
+}
+#endif
+
+/// <summary>
+/// Runs the given thread with SCHED_FIFO, it runs before every normal task (and every SCHED_FIFO task with a lower priority) till it blocks.
+/// </summary>
+/// <param name="priority">1 (lowest) - 99 (highest), 0 makes it a normal task again</param>
+/// <returns>If the priority is set</returns>
+bool setThreadRealTimePriority(std::thread& thread, int priority) {
+#ifdef __linux__
+	return setRealTimePriority(thread.native_handle(), priority);
+#else
+	return false;
+#endif
+}
+
+/// <summary>
+/// Runs the calling thread with SCHED_FIFO, see setThreadRealTimePriority(std::thread&, int).
+/// </summary>
+bool setThreadRealTimePriority(int priority) {
+#ifdef __linux__
+	return setRealTimePriority(pthread_self(), priority);
+#else
+	return false;
+#endif
+}
+
+/// <summary>
+/// Touches the given amount of stack of the calling thread, so with the memory locked its stack never faults.
+/// Call it at the start of the thread.
+/// </summary>
+void prefaultStack(size_t bytes) {
+#ifdef __linux__
+	const long pageSize = sysconf(_SC_PAGESIZE);
+	volatile char* stack = (volatile char*)alloca(bytes);
+	for (size_t i = 0; i < bytes; i += pageSize) stack[i] = 0;
+#endif
+}
+
+/// <summary>
+/// Sleeps till the given time. On linux with clock_nanosleep on the absolute time of CLOCK_MONOTONIC (the clock of steady_clock),
+/// a sleep that is interrupted or starts late doesn't drift.
+/// </summary>
+void sleepUntil(std::chrono::steady_clock::time_point time) {
+#ifdef __linux__
+	const int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+	timespec timeSpec = {};
+	timeSpec.tv_sec = (time_t)(nanoseconds / 1000000000);
+	timeSpec.tv_nsec = (long)(nanoseconds % 1000000000);
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &timeSpec, nullptr) == EINTR) { }
+#else
+	std::this_thread::sleep_until(time);
+#endif
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <chrono>
+#include <thread>
+#include <cstddef>
+
+/*
+	Purpose:
+	The real-time mode (REAL_TIME) of the pipeline, so other services on the Pi (Kodi, SSH, log rotation) can't make the leds stutter:
+	- The stages run with SCHED_FIFO, above every normal task, on the cores they are pinned to (see pinThreadToCore).
+	- All memory is locked (mlockall) and the heap and the stacks of the stages are touched at start-up,
+	  so the hot path never waits for a page fault or for a page that was swapped out.
+	- The render clock sleeps till an absolute time (clock_nanosleep), like cyclictest does.
+	Everything needs root, or CAP_SYS_NICE and a memlock limit. Without it a warning is logged and the program runs as a normal task.
+	Does nothing on non-linux platforms.
+*/
+
+bool lockMemory(size_t heapPrefaultBytes);
+void unlockMemory();
+bool setThreadRealTimePriority(std::thread& thread, int priority);
+bool setThreadRealTimePriority(int priority);
+void prefaultStack(size_t bytes);
+void sleepUntil(std::chrono::steady_clock::time_point time);
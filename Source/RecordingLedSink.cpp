@@ -0,0 +1,63 @@
+#include "RecordingLedSink.h"
+#include "Logger.h"
+
+#include <chrono>
+#include <cstdio>
+
+RecordingLedSink::RecordingLedSink(std::string filePath)
+	: m_filePath(filePath) { }
+
+RecordingLedSink::~RecordingLedSink() {
+	this->fini();
+}
+
+bool RecordingLedSink::init() {
+	m_file = std::fopen(m_filePath.c_str(), "wb");
+	if (m_file == nullptr) {
+		LOG_ERROR("Can't open led recording file: " << m_filePath);
+		return false;
+	}
+
+	// Big buffer, so a frame is a memcpy most of the time instead of a write
+	std::setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+
+	m_startTime = std::chrono::steady_clock::now();
+	uint64_t startTimeNS = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()
+	).count();
+
+	const char magic[8] = { 'L', 'E', 'D', 'R', 'E', 'C', '0', '2' };
+	const uint32_t byteOrderMark[2] = { 0x01020304, 0 }; // <- The second keeps the start time 8 byte aligned
+	std::fwrite(magic, sizeof(magic), 1, m_file);
+	std::fwrite(byteOrderMark, sizeof(byteOrderMark), 1, m_file);
+	std::fwrite(&startTimeNS, sizeof(startTimeNS), 1, m_file);
+
+	return true;
+}
+
+bool RecordingLedSink::render(const std::vector<uint32_t>& ledColors) {
+	if (m_file == nullptr) return false;
+
+	uint64_t timestampNS = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - m_startTime
+	).count();
+	uint32_t ledCount = (uint32_t)ledColors.size();
+
+	std::fwrite(&timestampNS, sizeof(timestampNS), 1, m_file);
+	std::fwrite(&ledCount, sizeof(ledCount), 1, m_file);
+	size_t written = std::fwrite(ledColors.data(), sizeof(uint32_t), ledCount, m_file);
+
+	if (written != ledCount) {
+		LOG_ERROR("Can't write to led recording file: " << m_filePath);
+		return false;
+	}
+
+	return true;
+}
+
+void RecordingLedSink::fini() {
+	if (m_file == nullptr) return;
+
+	std::fclose(m_file);
+	m_file = nullptr;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+#include "LedSink.h"
+
+/// <summary>
+/// A LedSink that writes every rendered frame of led colors with a timestamp to a file.
+/// Can be used to regression-test the output without a led-strip attached.
+///
+/// File layout (native byte order, the numbers are written as they are in memory):
+/// - Header: "LEDREC02" (8 bytes), byte order mark 0x01020304 (uint32) in the byte order of the machine that recorded it, 0 (uint32),
+///   start time in nanoseconds since the unix epoch (uint64)
+/// - Per frame: nanoseconds since the start (uint64), led count (uint32), a color per led (uint32 each)
+/// </summary>
+class RecordingLedSink : public LedSink
+{
+public:
+	// Constructor
+	RecordingLedSink(std::string filePath);
+	~RecordingLedSink();
+
+	// Methods
+	bool init() override;
+	bool render(const std::vector<uint32_t>& ledColors) override;
+	void fini() override;
+
+	// Getters & setters
+	const char* getName() const override { return "recording"; }
+
+private:
+	// Members
+	std::string m_filePath;
+	FILE* m_file = nullptr;
+	std::chrono::steady_clock::time_point m_startTime;
+};
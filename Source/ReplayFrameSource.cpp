@@ -0,0 +1,212 @@
+#include "ReplayFrameSource.h"
+#include "Logger.h"
+#include "const_config.h"
+
+#include <thread>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace BorderRecording;
+
+ReplayFrameSource::ReplayFrameSource(std::string filePath, bool realTime)
+	: m_filePath(filePath), m_realTime(realTime) { }
+
+ReplayFrameSource::~ReplayFrameSource() {
+	this->close();
+}
+
+bool ReplayFrameSource::open() {
+	this->close();
+
+	int fd = ::open(m_filePath.c_str(), O_RDONLY);
+	if (fd == -1) {
+		LOG_ERROR("Can't open border recording " << m_filePath << ": " << std::strerror(errno));
+		return false;
+	}
+
+	struct stat fileStat = {};
+	fstat(fd, &fileStat);
+	m_length = (size_t)fileStat.st_size;
+	if (m_length < sizeof(Header)) {
+		LOG_ERROR(m_filePath << " is not a border recording!");
+		::close(fd);
+		return false;
+	}
+
+	void* data = mmap(nullptr, m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {
+		LOG_ERROR("Can't mmap border recording " << m_filePath << ": " << std::strerror(errno));
+		return false;
+	}
+	m_mapping = (uint8_t*)data;
+
+	if (!this->index()) {
+		this->close();
+		return false;
+	}
+
+	m_frameIndex = 0;
+	m_startTime = std::chrono::steady_clock::now();
+	return true;
+}
+
+void ReplayFrameSource::close() {
+	if (m_mapping) munmap(m_mapping, m_length);
+	m_mapping = nullptr;
+	m_layouts.clear();
+	m_frames.clear();
+	m_buffers.clear(); // <- Frames that are still in use keep their buffer
+}
+
+/// <summary>
+/// Walks the records of the recording and remembers where every frame and its layout is.
+/// A recording that was cut off (the program was killed) is played back up to the last whole frame.
+/// </summary>
+/// <returns>If the recording holds at least one frame</returns>
+bool ReplayFrameSource::index() {
+	Header header;
+	std::memcpy(&header, m_mapping, sizeof(Header));
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+		LOG_ERROR(m_filePath << " is not a border recording!");
+		return false;
+	}
+	if (header.byteOrderMark != BYTE_ORDER_MARK) {
+		LOG_ERROR("Border recording " << m_filePath << " is made on a machine with an other byte order, it can't be played back here!");
+		return false;
+	}
+
+	const LEDCounts& LEDCounts = Config::LED_COUNTS;
+	if (header.ledCounts[0] != LEDCounts.top || header.ledCounts[1] != LEDCounts.bottom || header.ledCounts[2] != LEDCounts.left || header.ledCounts[3] != LEDCounts.right) {
+		LOG_WARNING("Border recording " << m_filePath << " is made with other led counts, the zones will sample other pixels than the recorded strips.");
+	}
+
+	size_t frameSize = 0;
+	size_t offset = sizeof(Header);
+	while (offset + sizeof(RecordHeader) <= m_length) {
+		RecordHeader recordHeader;
+		std::memcpy(&recordHeader, m_mapping + offset, sizeof(RecordHeader));
+
+		const uint8_t* payload = m_mapping + offset + sizeof(RecordHeader);
+		offset += sizeof(RecordHeader) + pad(recordHeader.size);
+		if (recordHeader.type == RecordType::END || offset > m_length) break;
+
+		if (recordHeader.type == RecordType::LAYOUT && recordHeader.size == sizeof(Layout)) {
+			Layout layout;
+			std::memcpy(&layout, payload, sizeof(Layout));
+
+			if (layout.width <= 0 || layout.height <= 0 || layout.pixelFormat > (uint32_t)PixelFormat::P010) {
+				LOG_ERROR("Border recording " << m_filePath << " has a frame layout that is not valid!");
+				return false;
+			}
+
+			const PixelFormat format = (PixelFormat)layout.pixelFormat;
+			const cv::Rect frameRect(0, 0, layout.width, layout.height);
+			frameSize = 0;
+			for (const Rect& strip : layout.strips) {
+				const cv::Rect stripRect = toRect(strip);
+				if (stripRect.width < 0 || stripRect.height < 0 || (stripRect & frameRect) != stripRect
+					|| alignStrip(stripRect, format, Dimensions(layout.width, layout.height)) != stripRect) {
+					LOG_ERROR("Border recording " << m_filePath << " has a strip outside of its frame!");
+					return false;
+				}
+				frameSize += getStripSize(stripRect, format);
+			}
+
+			m_layouts.push_back(layout);
+		}
+		else if (recordHeader.type == RecordType::FRAME && !m_layouts.empty() && recordHeader.size == sizeof(int64_t) + frameSize) {
+			int64_t timestamp;
+			std::memcpy(&timestamp, payload, sizeof(int64_t));
+			m_frames.push_back({ timestamp, payload + sizeof(int64_t), (int)m_layouts.size() - 1 });
+		}
+	}
+
+	if (m_frames.empty()) {
+		LOG_ERROR("Border recording " << m_filePath << " doesn't hold a single frame!");
+		return false;
+	}
+
+	LOG_INFO("Replaying " << m_frames.size() << " frames from " << m_filePath << (m_realTime ? "" : " as fast as possible"));
+	return true;
+}
+
+/// <summary>
+/// A buffer that isn't used by a frame anymore, or a new one.
+/// </summary>
+std::shared_ptr<ReplayFrameSource::Buffer> ReplayFrameSource::getFreeBuffer() {
+	for (std::shared_ptr<Buffer>& buffer : m_buffers) {
+		if (buffer.use_count() == 1) return buffer;
+	}
+
+	m_buffers.push_back(std::make_shared<Buffer>());
+	return m_buffers.back();
+}
+
+bool ReplayFrameSource::read(Frame& frame) {
+	frame.release();
+
+	if (!m_mapping) return false;
+
+	const RecordedFrame& recorded = m_frames[m_frameIndex];
+	const Layout& layout = m_layouts[recorded.layoutIndex];
+
+	// Play back at the recorded speed
+	if (m_realTime) std::this_thread::sleep_until(m_startTime + std::chrono::nanoseconds(recorded.timestamp));
+
+	// A black frame of the layout, only made again when the layout changed since the buffer was used
+	std::shared_ptr<Buffer> buffer = this->getFreeBuffer();
+	if (buffer->layoutIndex != recorded.layoutIndex) {
+		Frame& bufferFrame = buffer->frame;
+		bufferFrame.format = (PixelFormat)layout.pixelFormat;
+		switch (bufferFrame.format) {
+		case PixelFormat::BGR:
+			bufferFrame.image.create(layout.height, layout.width, CV_8UC3);
+			break;
+		case PixelFormat::YUYV:
+			bufferFrame.image.create(layout.height, layout.width, CV_8UC2);
+			break;
+		case PixelFormat::NV12:
+			bufferFrame.image.create(layout.height * 3 / 2, layout.width, CV_8UC1);
+			break;
+		case PixelFormat::BGR16:
+			bufferFrame.image.create(layout.height, layout.width, CV_16UC3);
+			break;
+		case PixelFormat::Y210:
+			bufferFrame.image.create(layout.height, layout.width, CV_16UC2);
+			break;
+		case PixelFormat::P010:
+			bufferFrame.image.create(layout.height * 3 / 2, layout.width, CV_16UC1);
+			break;
+		}
+		fillBlack(bufferFrame);
+		buffer->layoutIndex = recorded.layoutIndex;
+	}
+
+	const uint8_t* bytes = recorded.strips;
+	for (const Rect& strip : layout.strips) {
+		const cv::Rect stripRect = toRect(strip);
+		unpackStrip(bytes, stripRect, buffer->frame);
+		bytes += getStripSize(stripRect, buffer->frame.format);
+	}
+
+	frame.image = buffer->frame.image;
+	frame.format = buffer->frame.format;
+	frame.bufferLease = buffer;
+	frame.contentRect = toRect(layout.contentRect);
+	frame.timestamp = std::chrono::steady_clock::now();
+
+	// Loop
+	m_frameIndex++;
+	if (m_frameIndex == m_frames.size()) {
+		m_frameIndex = 0;
+		m_startTime = std::chrono::steady_clock::now();
+	}
+
+	return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "FrameSource.h"
+#include "BorderRecording.h"
+
+/// <summary>
+/// A FrameSource that plays back a border recording (made by the BorderRecorder), so the same frames can be run again without a capture card.
+///
+/// The recording is mmap'ed and indexed when opened. Every frame is build from the recorded border strips on a black frame,
+/// so the zones sample the exact same pixels as when it was recorded. The frame brings the content rect it was recorded with,
+/// so the zones are also laid out the same (the letterbox detection is skipped).
+/// Plays back at the recorded timestamps, or as fast as the frames are read when realTime is off. It loops at the end.
+/// </summary>
+class ReplayFrameSource : public FrameSource
+{
+public:
+	// Constructor
+	ReplayFrameSource(std::string filePath, bool realTime);
+	~ReplayFrameSource();
+
+	// Methods
+	bool open() override;
+	void close() override;
+	bool read(Frame& frame) override;
+
+	// Getters & setters
+	bool isOpened() const override { return m_mapping != nullptr; }
+	const char* getName() const override { return "replay"; }
+	size_t getFrameCount() const { return m_frames.size(); }
+
+private:
+	struct RecordedFrame {
+		int64_t timestamp; // <- Nanoseconds since the first frame
+		const uint8_t* strips;
+		int layoutIndex;
+	};
+
+	/// <summary>
+	/// A frame that is handed out, reused once the pipeline let go of it. Only its strips are written again when the layout stays the same.
+	/// </summary>
+	struct Buffer {
+		Frame frame;
+		int layoutIndex = -1; // <- The layout the black frame and the strips are made for
+	};
+
+	// Methods
+	bool index();
+	std::shared_ptr<Buffer> getFreeBuffer();
+
+	// Members
+	std::string m_filePath;
+	bool m_realTime;
+
+	uint8_t* m_mapping = nullptr; // <- The frames are build from it, so it can be unmapped while they are still in use
+	size_t m_length = 0;
+	std::vector<BorderRecording::Layout> m_layouts;
+	std::vector<RecordedFrame> m_frames;
+	std::vector<std::shared_ptr<Buffer>> m_buffers;
+
+	size_t m_frameIndex = 0;
+	std::chrono::steady_clock::time_point m_startTime; // <- Of the current loop
+};
@@ -0,0 +1,565 @@
+#include "SumKernels.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define SUM_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__ARM_NEON)
+#define SUM_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+// MSVC can use the AVX2 intrinsics in any function, GCC and Clang need to be told which functions may use them
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+/*
+* Scalar (the reference)
+*/
+
+static void sumBGRScalar(const uint8_t* row, int x0, int x1, uint32_t sums[3]) {
+	uint32_t blue = 0, green = 0, red = 0; // <- A row of a 8K frame still fits in 32 bits
+	const uint8_t* pixel = row + x0 * 3;
+	const uint8_t* end = row + x1 * 3;
+	for (; pixel != end; pixel += 3) {
+		blue += pixel[0];
+		green += pixel[1];
+		red += pixel[2];
+	}
+
+	sums[0] = blue;
+	sums[1] = green;
+	sums[2] = red;
+}
+
+/// <summary>
+/// YUYV pixels come in pairs (Y0 U Y1 V), so a segment can start and end on a odd pixel.
+/// </summary>
+static void sumYUYVScalar(const uint8_t* row, int x0, int x1, uint32_t sums[3]) {
+	uint32_t y = 0, u = 0, v = 0;
+	int x = x0;
+
+	if (x & 1) { // <- Second pixel of a pair
+		const uint8_t* pair = row + (x - 1) * 2;
+		y += pair[2];
+		u += pair[1];
+		v += pair[3];
+		x++;
+	}
+
+	for (; x + 1 < x1; x += 2) {
+		const uint8_t* pair = row + x * 2;
+		y += pair[0] + pair[2];
+		u += pair[1] * 2;
+		v += pair[3] * 2;
+	}
+
+	if (x < x1) { // <- First pixel of a pair
+		const uint8_t* pair = row + x * 2;
+		y += pair[0];
+		u += pair[1];
+		v += pair[3];
+	}
+
+	sums[0] = y;
+	sums[1] = u;
+	sums[2] = v;
+}
+
+static void accumulateWeightedScalar(const uint8_t* first, const uint8_t* second, int count, uint32_t firstWeight, uint32_t secondWeight,
+	uint32_t* profile) {
+	for (int i = 0; i < count; i++) {
+		profile[i] += firstWeight * first[i] + secondWeight * second[i];
+	}
+}
+
+/// <summary>
+/// Adds the lanes (lane i holds channel i % CHANNEL_COUNT) and the weighted bytes that are left to the channels.
+/// </summary>
+template<int CHANNEL_COUNT>
+static inline void addWeightedLanes(const uint32_t* lanes, int laneCount, const uint8_t* bytes, const uint16_t* weights, int count, uint32_t sums[4]) {
+	for (int l = 0; l < laneCount; l++) {
+		sums[l % CHANNEL_COUNT] += lanes[l];
+	}
+	for (int i = 0; i < count; i++) {
+		sums[i % CHANNEL_COUNT] += (uint32_t)weights[i] * bytes[i];
+	}
+}
+
+/// <summary>
+/// The weighted sums run once per row of a strip, so the channel count is made a constant instead of dividing per byte.
+/// </summary>
+static inline void addWeightedLanes(const uint32_t* lanes, int laneCount, const uint8_t* bytes, const uint16_t* weights, int count,
+	int channelCount, uint32_t sums[4]) {
+	switch (channelCount) {
+	case 1: addWeightedLanes<1>(lanes, laneCount, bytes, weights, count, sums); break;
+	case 2: addWeightedLanes<2>(lanes, laneCount, bytes, weights, count, sums); break;
+	case 3: addWeightedLanes<3>(lanes, laneCount, bytes, weights, count, sums); break;
+	case 4: addWeightedLanes<4>(lanes, laneCount, bytes, weights, count, sums); break;
+	}
+}
+
+static void sumWeightedScalar(const uint8_t* bytes, const uint16_t* weights, int count, int channelCount, uint32_t sums[4]) {
+	addWeightedLanes(nullptr, 0, bytes, weights, count, channelCount, sums);
+}
+
+/*
+* SSE2 and AVX2
+*
+* The bytes are not deinterleaved, every byte of a chunk is added to its own 16 bit lane instead.
+* A chunk is a multiple of the pixel size (48 bytes for BGR, 16 for YUYV), so every lane always holds the same channel.
+* Every 256 chunks (before they can overflow) and at the end, the lanes are widened to 32 bits and added to a few totals,
+* lanes that hold the same channels share a total. Only those totals are added to their channel.
+*/
+#ifdef SUM_KERNELS_X86
+
+static constexpr int LANE_FLUSH_CHUNKS = 256; // <- 256 * 255 still fits in 16 bits
+
+/// <summary>
+/// Adds every byte of the chunks (VECTORS * 16 bytes) to its lane.
+/// The channel of a byte repeats every PERIOD bytes, lane i of the totals holds channel i % PERIOD.
+/// </summary>
+/// <param name="totals">Filled with 12 lanes for a PERIOD of 3, 4 for a PERIOD of 4</param>
+template<int VECTORS, int PERIOD>
+static void sumLanesSSE2(const uint8_t* data, int chunkCount, uint32_t* totals) {
+	constexpr int TOTAL_COUNT = (PERIOD == 3) ? 3 : 1; // <- The channels of 4 lanes repeat every 3 vectors (BGR) or every vector (YUYV)
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i totalVectors[TOTAL_COUNT];
+	for (int t = 0; t < TOTAL_COUNT; t++) totalVectors[t] = zero;
+
+	while (chunkCount > 0) {
+		const int batchCount = std::min(chunkCount, LANE_FLUSH_CHUNKS);
+
+		__m128i accumulators[VECTORS * 2];
+		for (int v = 0; v < VECTORS * 2; v++) accumulators[v] = zero;
+
+		for (int c = 0; c < batchCount; c++, data += VECTORS * 16) {
+			for (int v = 0; v < VECTORS; v++) {
+				__m128i bytes = _mm_loadu_si128((const __m128i*)(data + v * 16));
+				accumulators[v * 2] = _mm_add_epi16(accumulators[v * 2], _mm_unpacklo_epi8(bytes, zero)); // Bytes 0 - 7
+				accumulators[v * 2 + 1] = _mm_add_epi16(accumulators[v * 2 + 1], _mm_unpackhi_epi8(bytes, zero)); // Bytes 8 - 15
+			}
+		}
+
+		// Accumulator v holds the bytes from 8 * v, its low and high half become the 4 lanes from byte 4 * (2 * v) and 4 * (2 * v + 1)
+		for (int v = 0; v < VECTORS * 2; v++) {
+			__m128i& lowTotal = totalVectors[(v * 2) % TOTAL_COUNT];
+			__m128i& highTotal = totalVectors[(v * 2 + 1) % TOTAL_COUNT];
+			lowTotal = _mm_add_epi32(lowTotal, _mm_unpacklo_epi16(accumulators[v], zero));
+			highTotal = _mm_add_epi32(highTotal, _mm_unpackhi_epi16(accumulators[v], zero));
+		}
+
+		chunkCount -= batchCount;
+	}
+
+	for (int t = 0; t < TOTAL_COUNT; t++) {
+		_mm_storeu_si128((__m128i*)(totals + t * 4), totalVectors[t]);
+	}
+}
+
+/// <summary>
+/// Same as sumLanesSSE2, with 16 lanes per accumulator.
+/// </summary>
+/// <param name="totals">Filled with 24 lanes for a PERIOD of 3, 8 for a PERIOD of 4</param>
+template<int VECTORS, int PERIOD>
+TARGET_AVX2 static void sumLanesAVX2(const uint8_t* data, int chunkCount, uint32_t* totals) {
+	constexpr int TOTAL_COUNT = (PERIOD == 3) ? 3 : 1;
+
+	__m256i totalVectors[TOTAL_COUNT];
+	for (int t = 0; t < TOTAL_COUNT; t++) totalVectors[t] = _mm256_setzero_si256();
+
+	while (chunkCount > 0) {
+		const int batchCount = std::min(chunkCount, LANE_FLUSH_CHUNKS);
+
+		__m256i accumulators[VECTORS];
+		for (int v = 0; v < VECTORS; v++) accumulators[v] = _mm256_setzero_si256();
+
+		for (int c = 0; c < batchCount; c++, data += VECTORS * 16) {
+			for (int v = 0; v < VECTORS; v++) {
+				__m128i bytes = _mm_loadu_si128((const __m128i*)(data + v * 16));
+				accumulators[v] = _mm256_add_epi16(accumulators[v], _mm256_cvtepu8_epi16(bytes));
+			}
+		}
+
+		// Accumulator v holds the bytes from 16 * v, its low and high half become the 8 lanes from byte 8 * (2 * v) and 8 * (2 * v + 1)
+		for (int v = 0; v < VECTORS; v++) {
+			__m256i& lowTotal = totalVectors[(v * 2) % TOTAL_COUNT];
+			__m256i& highTotal = totalVectors[(v * 2 + 1) % TOTAL_COUNT];
+			lowTotal = _mm256_add_epi32(lowTotal, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(accumulators[v])));
+			highTotal = _mm256_add_epi32(highTotal, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(accumulators[v], 1)));
+		}
+
+		chunkCount -= batchCount;
+	}
+
+	for (int t = 0; t < TOTAL_COUNT; t++) {
+		_mm256_storeu_si256((__m256i*)(totals + t * 8), totalVectors[t]);
+	}
+}
+
+/// <summary>
+/// Sums the whole chunks of the segment with SUM_LANES, the pixels that are left with the scalar kernel.
+/// </summary>
+template<int CHUNK_PIXELS, int LANE_COUNT, void (*SUM_LANES)(const uint8_t*, int, uint32_t*)>
+static void sumBGRLanes(const uint8_t* row, int x0, int x1, uint32_t sums[3]) {
+	const int chunkCount = (x1 - x0) / CHUNK_PIXELS;
+	uint32_t lanes[LANE_COUNT];
+	SUM_LANES(row + x0 * 3, chunkCount, lanes);
+
+	sumBGRScalar(row, x0 + chunkCount * CHUNK_PIXELS, x1, sums);
+	for (int i = 0; i < LANE_COUNT; i++) {
+		sums[i % 3] += lanes[i];
+	}
+}
+
+/// <summary>
+/// Sums the whole chunks of the segment with SUM_LANES, a odd first pixel and the pixels that are left with the scalar kernel.
+/// </summary>
+template<int CHUNK_PIXELS, int LANE_COUNT, void (*SUM_LANES)(const uint8_t*, int, uint32_t*)>
+static void sumYUYVLanes(const uint8_t* row, int x0, int x1, uint32_t sums[3]) {
+	const int chunkStart = (x0 + 1) & ~1; // <- First pair
+	const int chunkCount = (x1 - chunkStart) / CHUNK_PIXELS;
+	const int chunkEnd = chunkStart + chunkCount * CHUNK_PIXELS;
+	uint32_t lanes[LANE_COUNT];
+	SUM_LANES(row + chunkStart * 2, chunkCount, lanes);
+
+	uint32_t headSums[3] = { 0, 0, 0 };
+	if (x0 != chunkStart) sumYUYVScalar(row, x0, chunkStart, headSums);
+	sumYUYVScalar(row, chunkEnd, x1, sums);
+
+	// Lanes hold Y0 U Y1 V, every U and V counts for 2 pixels
+	for (int i = 0; i < LANE_COUNT; i += 4) {
+		sums[0] += lanes[i] + lanes[i + 2];
+		sums[1] += lanes[i + 1] * 2;
+		sums[2] += lanes[i + 3] * 2;
+	}
+	for (int c = 0; c < 3; c++) {
+		sums[c] += headSums[c];
+	}
+}
+
+/// <summary>
+/// Interleaves the bytes of the 2 rows, so one multiply-add (madd) gives the weighted sum of both rows as a 32 bit value.
+/// </summary>
+static void accumulateWeightedSSE2(const uint8_t* first, const uint8_t* second, int count, uint32_t firstWeight, uint32_t secondWeight,
+	uint32_t* profile) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i weights = _mm_set1_epi32((int)((secondWeight << 16) | firstWeight)); // <- Both at most 255, so madd can't overflow
+
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i firstBytes = _mm_loadu_si128((const __m128i*)(first + i));
+		__m128i secondBytes = _mm_loadu_si128((const __m128i*)(second + i));
+		__m128i low = _mm_unpacklo_epi8(firstBytes, secondBytes); // Bytes 0 - 7 of both rows
+		__m128i high = _mm_unpackhi_epi8(firstBytes, secondBytes); // Bytes 8 - 15
+
+		__m128i* target = (__m128i*)(profile + i);
+		_mm_storeu_si128(target, _mm_add_epi32(_mm_loadu_si128(target), _mm_madd_epi16(_mm_unpacklo_epi8(low, zero), weights)));
+		_mm_storeu_si128(target + 1, _mm_add_epi32(_mm_loadu_si128(target + 1), _mm_madd_epi16(_mm_unpackhi_epi8(low, zero), weights)));
+		_mm_storeu_si128(target + 2, _mm_add_epi32(_mm_loadu_si128(target + 2), _mm_madd_epi16(_mm_unpacklo_epi8(high, zero), weights)));
+		_mm_storeu_si128(target + 3, _mm_add_epi32(_mm_loadu_si128(target + 3), _mm_madd_epi16(_mm_unpackhi_epi8(high, zero), weights)));
+	}
+
+	accumulateWeightedScalar(first + i, second + i, count - i, firstWeight, secondWeight, profile + i);
+}
+
+/// <summary>
+/// Multiplies 8 bytes (widened to 16 bit) with 8 weights into 2 vectors of 4 full 32 bit products.
+/// </summary>
+static inline void multiplyWeightsSSE2(__m128i values, __m128i weights, __m128i& low, __m128i& high) {
+	__m128i productLow = _mm_mullo_epi16(values, weights);
+	__m128i productHigh = _mm_mulhi_epu16(values, weights);
+	low = _mm_unpacklo_epi16(productLow, productHigh);
+	high = _mm_unpackhi_epi16(productLow, productHigh);
+}
+
+/// <summary>
+/// Chunks of 48 bytes, a multiple of every channel count. Like sumLanesSSE2, the products of a chunk are added to 12 lanes,
+/// lane i always holds channel i % channelCount.
+/// </summary>
+static void sumWeightedSSE2(const uint8_t* bytes, const uint16_t* weights, int count, int channelCount, uint32_t sums[4]) {
+	constexpr int CHUNK_BYTES = 48;
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i totals[3] = { zero, zero, zero };
+	int i = 0;
+	for (; i + CHUNK_BYTES <= count; i += CHUNK_BYTES) {
+		for (int v = 0; v < 3; v++) {
+			__m128i chunk = _mm_loadu_si128((const __m128i*)(bytes + i + v * 16));
+			__m128i lowWeights = _mm_loadu_si128((const __m128i*)(weights + i + v * 16));
+			__m128i highWeights = _mm_loadu_si128((const __m128i*)(weights + i + v * 16 + 8));
+
+			// The 4 products from byte 4 * p go to total p % 3
+			__m128i products[4];
+			multiplyWeightsSSE2(_mm_unpacklo_epi8(chunk, zero), lowWeights, products[0], products[1]);
+			multiplyWeightsSSE2(_mm_unpackhi_epi8(chunk, zero), highWeights, products[2], products[3]);
+			for (int p = 0; p < 4; p++) {
+				totals[(v * 4 + p) % 3] = _mm_add_epi32(totals[(v * 4 + p) % 3], products[p]);
+			}
+		}
+	}
+
+	uint32_t lanes[12];
+	for (int t = 0; t < 3; t++) {
+		_mm_storeu_si128((__m128i*)(lanes + t * 4), totals[t]);
+	}
+	addWeightedLanes(lanes, 12, bytes + i, weights + i, count - i, channelCount, sums); // <- 48 is a multiple of the channel count
+}
+
+/// <summary>
+/// Same as sumWeightedSSE2, with 16 bytes per vector. Unpacking works per 128 bit half, so the low products of a vector
+/// are the bytes 0 - 3 and 8 - 11, the high products the bytes 4 - 7 and 12 - 15.
+/// </summary>
+TARGET_AVX2 static void sumWeightedAVX2(const uint8_t* bytes, const uint16_t* weights, int count, int channelCount, uint32_t sums[4]) {
+	constexpr int CHUNK_BYTES = 48;
+
+	// Total t holds the bytes from 4 * t in its low half and the bytes from 4 * (t + 2) in its high half (modulo 12)
+	__m256i totals[3] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256() };
+	int i = 0;
+	for (; i + CHUNK_BYTES <= count; i += CHUNK_BYTES) {
+		for (int v = 0; v < 3; v++) {
+			__m256i values = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(bytes + i + v * 16)));
+			__m256i vectorWeights = _mm256_loadu_si256((const __m256i*)(weights + i + v * 16));
+			__m256i productLow = _mm256_mullo_epi16(values, vectorWeights);
+			__m256i productHigh = _mm256_mulhi_epu16(values, vectorWeights);
+
+			totals[v] = _mm256_add_epi32(totals[v], _mm256_unpacklo_epi16(productLow, productHigh));
+			totals[(v + 1) % 3] = _mm256_add_epi32(totals[(v + 1) % 3], _mm256_unpackhi_epi16(productLow, productHigh));
+		}
+	}
+
+	uint32_t lanes[12];
+	for (int t = 0; t < 3; t++) {
+		__m128i lane = _mm_add_epi32(_mm256_castsi256_si128(totals[t]), _mm256_extracti128_si256(totals[(t + 1) % 3], 1));
+		_mm_storeu_si128((__m128i*)(lanes + t * 4), lane);
+	}
+	addWeightedLanes(lanes, 12, bytes + i, weights + i, count - i, channelCount, sums);
+}
+
+static bool isAVX2Supported() {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6; // <- OSXSAVE, and the OS saves the AVX registers
+	__cpuidex(info, 7, 0);
+	return osSavesYmm && (info[1] & (1 << 5));
+#else
+	return false;
+#endif
+}
+
+#endif
+
+/*
+* NEON
+*
+* vld3 and vld4 deinterleave the channels while loading, so every channel gets its own accumulator.
+* The bytes are added pairwise into 16 bit lanes and moved to 32 bits every 64 chunks, before they can overflow.
+*/
+#ifdef SUM_KERNELS_NEON
+
+static constexpr int NEON_FLUSH_CHUNKS = 64; // <- At most 4 bytes per lane per chunk, 64 * 4 * 255 still fits in 16 bits
+
+static inline uint32_t addLanes(uint32x4_t lanes) {
+#ifdef __aarch64__
+	return vaddvq_u32(lanes);
+#else
+	uint32x2_t pair = vadd_u32(vget_low_u32(lanes), vget_high_u32(lanes));
+	return vget_lane_u32(vpadd_u32(pair, pair), 0);
+#endif
+}
+
+static void sumBGRNEON(const uint8_t* row, int x0, int x1, uint32_t sums[3]) {
+	constexpr int CHUNK_PIXELS = 16;
+
+	int chunkCount = (x1 - x0) / CHUNK_PIXELS;
+	const int chunkEnd = x0 + chunkCount * CHUNK_PIXELS;
+	const uint8_t* pixel = row + x0 * 3;
+
+	uint32x4_t totals[3] = { vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0) };
+	while (chunkCount > 0) {
+		const int batchCount = std::min(chunkCount, NEON_FLUSH_CHUNKS);
+
+		uint16x8_t accumulators[3] = { vdupq_n_u16(0), vdupq_n_u16(0), vdupq_n_u16(0) };
+		for (int c = 0; c < batchCount; c++, pixel += CHUNK_PIXELS * 3) {
+			uint8x16x3_t channels = vld3q_u8(pixel);
+			accumulators[0] = vpadalq_u8(accumulators[0], channels.val[0]);
+			accumulators[1] = vpadalq_u8(accumulators[1], channels.val[1]);
+			accumulators[2] = vpadalq_u8(accumulators[2], channels.val[2]);
+		}
+
+		for (int i = 0; i < 3; i++) {
+			totals[i] = vpadalq_u16(totals[i], accumulators[i]);
+		}
+		chunkCount -= batchCount;
+	}
+
+	sumBGRScalar(row, chunkEnd, x1, sums);
+	for (int i = 0; i < 3; i++) {
+		sums[i] += addLanes(totals[i]);
+	}
+}
+
+static void sumYUYVNEON(const uint8_t* row, int x0, int x1, uint32_t sums[3]) {
+	constexpr int CHUNK_PIXELS = 32;
+
+	const int chunkStart = (x0 + 1) & ~1; // <- First pair
+	int chunkCount = (x1 - chunkStart) / CHUNK_PIXELS;
+	const int chunkEnd = chunkStart + chunkCount * CHUNK_PIXELS;
+	const uint8_t* pair = row + chunkStart * 2;
+
+	uint32x4_t totals[3] = { vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0) };
+	while (chunkCount > 0) {
+		const int batchCount = std::min(chunkCount, NEON_FLUSH_CHUNKS);
+
+		uint16x8_t accumulators[3] = { vdupq_n_u16(0), vdupq_n_u16(0), vdupq_n_u16(0) };
+		for (int c = 0; c < batchCount; c++, pair += CHUNK_PIXELS * 2) {
+			uint8x16x4_t components = vld4q_u8(pair); // <- Y0, U, Y1, V
+			accumulators[0] = vpadalq_u8(accumulators[0], components.val[0]);
+			accumulators[0] = vpadalq_u8(accumulators[0], components.val[2]);
+			accumulators[1] = vpadalq_u8(accumulators[1], components.val[1]);
+			accumulators[2] = vpadalq_u8(accumulators[2], components.val[3]);
+		}
+
+		for (int i = 0; i < 3; i++) {
+			totals[i] = vpadalq_u16(totals[i], accumulators[i]);
+		}
+		chunkCount -= batchCount;
+	}
+
+	uint32_t headSums[3] = { 0, 0, 0 };
+	if (x0 != chunkStart) sumYUYVScalar(row, x0, chunkStart, headSums);
+	sumYUYVScalar(row, chunkEnd, x1, sums);
+
+	sums[0] += headSums[0] + addLanes(totals[0]);
+	sums[1] += headSums[1] + addLanes(totals[1]) * 2; // <- Every U and V counts for 2 pixels
+	sums[2] += headSums[2] + addLanes(totals[2]) * 2;
+}
+
+static void accumulateWeightedNEON(const uint8_t* first, const uint8_t* second, int count, uint32_t firstWeight, uint32_t secondWeight,
+	uint32_t* profile) {
+	const uint8x8_t firstWeights = vdup_n_u8((uint8_t)firstWeight);
+	const uint8x8_t secondWeights = vdup_n_u8((uint8_t)secondWeight);
+
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16_t firstBytes = vld1q_u8(first + i);
+		uint8x16_t secondBytes = vld1q_u8(second + i);
+
+		// 255 * 255 still fits in 16 bits, the sum of both rows doesn't
+		uint16x8_t firstLow = vmull_u8(vget_low_u8(firstBytes), firstWeights);
+		uint16x8_t firstHigh = vmull_u8(vget_high_u8(firstBytes), firstWeights);
+		uint16x8_t secondLow = vmull_u8(vget_low_u8(secondBytes), secondWeights);
+		uint16x8_t secondHigh = vmull_u8(vget_high_u8(secondBytes), secondWeights);
+
+		uint32_t* target = profile + i;
+		vst1q_u32(target, vaddq_u32(vld1q_u32(target), vaddl_u16(vget_low_u16(firstLow), vget_low_u16(secondLow))));
+		vst1q_u32(target + 4, vaddq_u32(vld1q_u32(target + 4), vaddl_u16(vget_high_u16(firstLow), vget_high_u16(secondLow))));
+		vst1q_u32(target + 8, vaddq_u32(vld1q_u32(target + 8), vaddl_u16(vget_low_u16(firstHigh), vget_low_u16(secondHigh))));
+		vst1q_u32(target + 12, vaddq_u32(vld1q_u32(target + 12), vaddl_u16(vget_high_u16(firstHigh), vget_high_u16(secondHigh))));
+	}
+
+	accumulateWeightedScalar(first + i, second + i, count - i, firstWeight, secondWeight, profile + i);
+}
+
+/// <summary>
+/// Same chunks and lanes as sumWeightedSSE2.
+/// </summary>
+static void sumWeightedNEON(const uint8_t* bytes, const uint16_t* weights, int count, int channelCount, uint32_t sums[4]) {
+	constexpr int CHUNK_BYTES = 48;
+
+	uint32x4_t totals[3] = { vdupq_n_u32(0), vdupq_n_u32(0), vdupq_n_u32(0) };
+	int i = 0;
+	for (; i + CHUNK_BYTES <= count; i += CHUNK_BYTES) {
+		for (int v = 0; v < 3; v++) {
+			uint8x16_t chunk = vld1q_u8(bytes + i + v * 16);
+			uint16x8_t low = vmovl_u8(vget_low_u8(chunk));
+			uint16x8_t high = vmovl_u8(vget_high_u8(chunk));
+			uint16x8_t lowWeights = vld1q_u16(weights + i + v * 16);
+			uint16x8_t highWeights = vld1q_u16(weights + i + v * 16 + 8);
+
+			// The 4 products from byte 4 * p go to total p % 3
+			uint32x4_t products[4] = {
+				vmull_u16(vget_low_u16(low), vget_low_u16(lowWeights)),
+				vmull_u16(vget_high_u16(low), vget_high_u16(lowWeights)),
+				vmull_u16(vget_low_u16(high), vget_low_u16(highWeights)),
+				vmull_u16(vget_high_u16(high), vget_high_u16(highWeights))
+			};
+			for (int p = 0; p < 4; p++) {
+				totals[(v * 4 + p) % 3] = vaddq_u32(totals[(v * 4 + p) % 3], products[p]);
+			}
+		}
+	}
+
+	uint32_t lanes[12];
+	for (int t = 0; t < 3; t++) {
+		vst1q_u32(lanes + t * 4, totals[t]);
+	}
+	addWeightedLanes(lanes, 12, bytes + i, weights + i, count - i, channelCount, sums);
+}
+
+#endif
+
+/*
+* Dispatch
+*/
+
+static const SumKernels SCALAR_SUM_KERNELS = { "scalar", sumBGRScalar, sumYUYVScalar, accumulateWeightedScalar, sumWeightedScalar };
+#ifdef SUM_KERNELS_X86
+// Chunks of 16 BGR pixels (48 bytes) and 8 YUYV pixels (16 bytes), small chunks leave less pixels for the scalar kernel in short segments
+// Accumulating is bound by the loads and stores of the profile, so AVX2 reuses the SSE2 one
+static const SumKernels SSE2_SUM_KERNELS = { "SSE2", sumBGRLanes<16, 12, sumLanesSSE2<3, 3>>, sumYUYVLanes<8, 4, sumLanesSSE2<1, 4>>,
+	accumulateWeightedSSE2, sumWeightedSSE2 };
+static const SumKernels AVX2_SUM_KERNELS = { "AVX2", sumBGRLanes<16, 24, sumLanesAVX2<3, 3>>, sumYUYVLanes<8, 8, sumLanesAVX2<1, 4>>,
+	accumulateWeightedSSE2, sumWeightedAVX2 };
+#endif
+#ifdef SUM_KERNELS_NEON
+static const SumKernels NEON_SUM_KERNELS = { "NEON", sumBGRNEON, sumYUYVNEON, accumulateWeightedNEON, sumWeightedNEON };
+#endif
+
+/// <summary>
+/// The kernels this CPU supports, the reference first and the fastest last.
+/// </summary>
+std::vector<const SumKernels*> getSupportedSumKernels() {
+	std::vector<const SumKernels*> kernels = { &SCALAR_SUM_KERNELS };
+
+#ifdef SUM_KERNELS_NEON
+	kernels.push_back(&NEON_SUM_KERNELS);
+#endif
+#ifdef SUM_KERNELS_X86
+	kernels.push_back(&SSE2_SUM_KERNELS); // <- Every x86-64 CPU has SSE2
+	if (isAVX2Supported()) kernels.push_back(&AVX2_SUM_KERNELS);
+#endif
+
+	return kernels;
+}
+
+/// <summary>
+/// The fastest kernels this CPU supports, picked on the first call.
+/// </summary>
+const SumKernels& getSumKernels() {
+	static const SumKernels& kernels = []() -> const SumKernels& {
+		const SumKernels& fastest = *getSupportedSumKernels().back();
+		LOG_INFO("Summing the zones with the " << fastest.name << " kernels");
+		return fastest;
+	}();
+
+	return kernels;
+}
+
+const SumKernels& getReferenceSumKernels() {
+	return SCALAR_SUM_KERNELS;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+/// <summary>
+/// Sums the pixels of a row segment (columns x0 to x1, exclusive) per channel.
+/// </summary>
+using RowSumFunction = void (*)(const uint8_t* row, int x0, int x1, uint32_t sums[3]);
+
+/// <summary>
+/// Adds count bytes of 2 rows times their weight to the profile: profile[i] += firstWeight * first[i] + secondWeight * second[i].
+/// The weights are at most 255.
+/// </summary>
+using WeightedAccumulateFunction = void (*)(const uint8_t* first, const uint8_t* second, int count, uint32_t firstWeight, uint32_t secondWeight,
+	uint32_t* profile);
+
+/// <summary>
+/// Sums count bytes times their own weight per channel, the channels repeat every channelCount (1 - 4) bytes:
+/// sums[i % channelCount] += weights[i] * bytes[i]. The weights are at most 510.
+/// </summary>
+using WeightedSumFunction = void (*)(const uint8_t* bytes, const uint16_t* weights, int count, int channelCount, uint32_t sums[4]);
+
+/// <summary>
+/// The kernels that sum the rows of the zones, the inner loop of the whole program.
+///
+/// There is a scalar version (the reference) and vectorised versions for NEON (the Raspberry Pi), SSE2 and AVX2 (development machines).
+/// The best version the CPU supports is picked on the first call of getSumKernels.
+/// All versions give the exact same sums, the vectorised ones only add the bytes in a other order
+/// (run the benchmark with --verify to check it).
+///
+/// BGR is summed into Blue, Green, Red and YUYV into Y, U, V, where every pixel counts the U and V of its pair.
+/// The weighted kernels are used by the WeightedReducer.
+/// </summary>
+struct SumKernels {
+	const char* name;
+	RowSumFunction sumBGR;
+	RowSumFunction sumYUYV;
+	WeightedAccumulateFunction accumulateWeighted;
+	WeightedSumFunction sumWeighted;
+};
+
+const SumKernels& getSumKernels();
+const SumKernels& getReferenceSumKernels();
+std::vector<const SumKernels*> getSupportedSumKernels();
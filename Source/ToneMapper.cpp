@@ -0,0 +1,122 @@
+#include "ToneMapper.h"
+#include "PixelFormat.h"
+#include "const_config.h"
+
+#include <cmath>
+#include <algorithm>
+
+static constexpr float MAX_CODE = (float)((1 << (16 - HIGH_BIT_DEPTH_SHIFT)) - 1); // <- 1023
+
+/// <summary>
+/// SMPTE ST 2084 EOTF: a PQ signal (0 - 1) to display light in nits.
+/// </summary>
+static float pqToNits(float signal) {
+	const float m1 = 2610.0f / 16384.0f;
+	const float m2 = 2523.0f / 4096.0f * 128.0f;
+	const float c1 = 3424.0f / 4096.0f;
+	const float c2 = 2413.0f / 4096.0f * 32.0f;
+	const float c3 = 2392.0f / 4096.0f * 32.0f;
+
+	const float power = std::pow(std::clamp(signal, 0.0f, 1.0f), 1.0f / m2);
+	return 10000.0f * std::pow(std::max(power - c1, 0.0f) / (c2 - c3 * power), 1.0f / m1);
+}
+
+/// <summary>
+/// BT.2100 inverse OETF of HLG: a HLG signal (0 - 1) to scene light (0 - 1).
+/// </summary>
+static float hlgToScene(float signal) {
+	const float a = 0.17883277f;
+	const float b = 1.0f - 4.0f * a;
+	const float c = 0.5f - a * std::log(4.0f * a);
+
+	signal = std::clamp(signal, 0.0f, 1.0f);
+	return signal <= 0.5f ? signal * signal / 3.0f : (std::exp((signal - c) / a) + b) / 12.0f;
+}
+
+ToneMapper::ToneMapper(const ToneMappingSettings& settings)
+	: m_settings(settings) { }
+
+/// <summary>
+/// Maps the average of a zone to a led color.
+/// </summary>
+/// <param name="codes">The average of the 3 channels as 10 bit codes (with the fraction): Blue, Green, Red or Y, U, V (limited range)</param>
+/// <param name="yuv">If the codes are Y, U and V</param>
+/// <returns>The led color (BGR)</returns>
+cv::Vec3b ToneMapper::map(const float codes[3], bool yuv) const {
+	// The non-linear R', G' and B' (0 - 1)
+	float red, green, blue;
+	if (yuv) {
+		// BT.2020 non-constant luminance, limited range
+		const float y = (codes[0] - 64.0f) / 876.0f;
+		const float u = (codes[1] - 512.0f) / 896.0f;
+		const float v = (codes[2] - 512.0f) / 896.0f;
+		red = y + 1.4746f * v;
+		green = y - 0.16455f * u - 0.57135f * v;
+		blue = y + 1.8814f * u;
+	}
+	else {
+		blue = codes[0] / MAX_CODE;
+		green = codes[1] / MAX_CODE;
+		red = codes[2] / MAX_CODE;
+	}
+
+	// Display light in nits
+	float light[3]; // <- Red, Green, Blue
+	if (m_settings.transferFunction == TransferFunction::HLG) {
+		const float scene[3] = { hlgToScene(red), hlgToScene(green), hlgToScene(blue) };
+
+		// OOTF, the system gamma of the display peak
+		const float gamma = 1.2f + 0.42f * std::log10(m_settings.peakNits / 1000.0f);
+		const float luminance = 0.2627f * scene[0] + 0.6780f * scene[1] + 0.0593f * scene[2];
+		const float gain = m_settings.peakNits * (luminance > 0.0f ? std::pow(luminance, gamma - 1.0f) : 0.0f);
+		for (int i = 0; i < 3; i++) light[i] = gain * scene[i];
+	}
+	else {
+		light[0] = pqToNits(red);
+		light[1] = pqToNits(green);
+		light[2] = pqToNits(blue);
+	}
+
+	// BT.2020 to BT.709 primaries, relative to the white of the content
+	const float white = std::max(m_settings.whiteNits, 1.0f);
+	float rgb[3] = {
+		std::max(0.0f, (1.6605f * light[0] - 0.5876f * light[1] - 0.0728f * light[2]) / white),
+		std::max(0.0f, (-0.1246f * light[0] + 1.1329f * light[1] - 0.0083f * light[2]) / white),
+		std::max(0.0f, (-0.0182f * light[0] - 0.1006f * light[1] + 1.1187f * light[2]) / white)
+	};
+
+	// Roll off the brightest channel, the others keep their ratio to it
+	const float brightest = std::max({ rgb[0], rgb[1], rgb[2] });
+	if (brightest > KNEE) {
+		const float scale = this->rollOff(brightest) / brightest;
+		for (float& channel : rgb) channel *= scale;
+	}
+
+	auto encode = [](float value) {
+		return (uchar)std::lround(255.0f * std::pow(std::clamp(value, 0.0f, 1.0f), 1.0f / 2.2f));
+	};
+	return cv::Vec3b(encode(rgb[2]), encode(rgb[1]), encode(rgb[0]));
+}
+
+/// <summary>
+/// The tone curve above the knee: a extended Reinhard curve on the part above the knee,
+/// with a slope of 1 at the knee (no kink) that reaches 1 at the peak.
+/// </summary>
+/// <param name="value">Light relative to the white of the content, above KNEE</param>
+/// <returns>Light relative to the full led brightness, KNEE - 1</returns>
+float ToneMapper::rollOff(float value) const {
+	const float peak = std::max(m_settings.peakNits / std::max(m_settings.whiteNits, 1.0f), KNEE + 0.01f);
+	const float range = 1.0f - KNEE;
+
+	const float t = std::min((value - KNEE) / range, (peak - KNEE) / range);
+	const float end = (peak - KNEE) / range;
+	return KNEE + range * t * (1.0f + t / (end * end)) / (1.0f + t);
+}
+
+/// <summary>
+/// The tone mapper of the config (TONE_MAPPING), build once.
+/// </summary>
+const ToneMapper& getToneMapper() {
+	static const ToneMapper toneMapper(Config::TONE_MAPPING);
+	return toneMapper;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <opencv2/core.hpp>
+
+/// <summary>
+/// How the 10 and 16 bit frames are encoded, see TONE_MAPPING in the config.
+/// </summary>
+enum class TransferFunction {
+	SDR, // <- A normal source with more bits, BT.601 YUV like the 8 bit frames
+	PQ, // <- HDR10, SMPTE ST 2084 with BT.2020 colors
+	HLG // <- Hybrid log-gamma, BT.2100 with BT.2020 colors
+};
+
+struct ToneMappingSettings {
+	TransferFunction transferFunction = TransferFunction::SDR;
+	float peakNits = 1000.0f; // <- The brightest the source gets, mapped to the full led brightness. For HLG the peak of the display it is made for
+	float whiteNits = 203.0f; // <- The white of the content (BT.2408 reference white), the highlights above it are rolled off
+};
+
+/// <summary>
+/// Maps the average color of a zone of a HDR frame (PQ or HLG, BT.2020) to the range of the leds (8 bit BT.709, gamma 2.2).
+///
+/// Only the averages of the zones are mapped, never the pixels, so a HDR source costs no more than a SDR one (a few pow() per zone).
+/// The color is turned into display light (nits), converted to the BT.709 primaries and scaled relative to the white of the content.
+/// Up to KNEE of the white it is left as it is, above the knee the brightest channel is rolled off so the peak ends up at the full led brightness.
+/// The channels are scaled together, so the hue doesn't shift.
+/// </summary>
+class ToneMapper
+{
+public:
+	static constexpr float KNEE = 0.5f; // <- Ratio of the white nits
+
+	// Constructor
+	ToneMapper(const ToneMappingSettings& settings = ToneMappingSettings());
+
+	// Methods
+	cv::Vec3b map(const float codes[3], bool yuv) const;
+
+	// Getters & setters
+	const ToneMappingSettings& getSettings() const { return m_settings; }
+	bool isHDR() const { return m_settings.transferFunction != TransferFunction::SDR; }
+
+private:
+	// Methods
+	float rollOff(float value) const;
+
+	// Members
+	ToneMappingSettings m_settings;
+};
+
+const ToneMapper& getToneMapper();
@@ -0,0 +1,104 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/// <summary>
+/// A lock-free single producer / single consumer triple buffer.
+///
+/// The producer always has a back slot to write into and the consumer always has a front slot to read from.
+/// The third (middle) slot is swapped atomically between them, so neither side ever waits on the other.
+/// When the producer publishes twice before the consumer picks it up, the older value is overwritten (dropped).
+/// This way the consumer always gets the newest value instead of a queue of old ones.
+///
+/// The slots are reused, so values that own memory (cv::Mat, std::vector) are only allocated once.
+/// </summary>
+template<typename T>
+class TripleBuffer
+{
+public:
+	// Constructor
+	TripleBuffer() = default;
+	TripleBuffer(const T& initialValue) : m_slots{ initialValue, initialValue, initialValue } { }
+
+	// -- Producer side --
+
+	/// <summary>
+	/// The slot the producer can write into. Only valid until the next publish.
+	/// </summary>
+	T& back() { return m_slots[m_backIndex]; }
+
+	/// <summary>
+	/// Hands the back slot over to the consumer and wakes it up.
+	/// </summary>
+	/// <returns>True if a value the consumer never picked up got overwritten (dropped)</returns>
+	bool publish() {
+		uint32_t previous = m_middle.exchange(m_backIndex | NEW_VALUE_BIT, std::memory_order_acq_rel);
+		m_backIndex = previous & INDEX_MASK;
+
+		m_sequence.fetch_add(1, std::memory_order_release);
+		m_sequence.notify_all();
+
+		return (previous & NEW_VALUE_BIT) != 0;
+	}
+
+	// -- Consumer side --
+
+	/// <summary>
+	/// The slot the consumer can read from. Only valid until the next update.
+	/// </summary>
+	T& front() { return m_slots[m_frontIndex]; }
+	const T& front() const { return m_slots[m_frontIndex]; }
+
+	/// <summary>
+	/// Swaps the newest published value into the front slot, if there is one.
+	/// </summary>
+	/// <returns>True if the front slot holds a new value</returns>
+	bool update() {
+		if ((m_middle.load(std::memory_order_relaxed) & NEW_VALUE_BIT) == 0) {
+			return false;
+		}
+
+		uint32_t previous = m_middle.exchange(m_frontIndex, std::memory_order_acq_rel);
+		m_frontIndex = previous & INDEX_MASK;
+		return true;
+	}
+
+	/// <summary>
+	/// Blocks (without spinning) until a new value is published and swaps it into the front slot.
+	/// </summary>
+	/// <param name="running">Stops waiting when this is false. Call wakeUp after setting it.</param>
+	/// <returns>True if the front slot holds a new value, false if it stopped waiting</returns>
+	bool waitForUpdate(const std::atomic<bool>& running) {
+		while (true) {
+			// Note: the sequence is loaded before checking, so a publish in between makes the wait return immediately
+			uint32_t sequence = m_sequence.load(std::memory_order_acquire);
+
+			if (this->update()) return true;
+			if (!running.load(std::memory_order_relaxed)) return false;
+
+			m_sequence.wait(sequence, std::memory_order_acquire);
+		}
+	}
+
+	/// <summary>
+	/// Wakes up a consumer blocked in waitForUpdate, for example when shutting down.
+	/// </summary>
+	void wakeUp() {
+		m_sequence.fetch_add(1, std::memory_order_release);
+		m_sequence.notify_all();
+	}
+
+private:
+	static constexpr uint32_t INDEX_MASK = 0b011;
+	static constexpr uint32_t NEW_VALUE_BIT = 0b100;
+
+	// Members
+	std::array<T, 3> m_slots;
+
+	uint32_t m_backIndex = 0; // <- Only touched by the producer
+	std::atomic<uint32_t> m_middle = 1; // <- Index of the middle slot + NEW_VALUE_BIT when it holds a unread value
+	uint32_t m_frontIndex = 2; // <- Only touched by the consumer
+
+	std::atomic<uint32_t> m_sequence = 0; // <- Bumped on every publish, used to block the consumer
+};
@@ -0,0 +1,286 @@
+#include "V4l2FrameSource.h"
+#include "const_config.h"
+
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+#include <opencv2/core.hpp>
+
+/// <summary>
+/// ioctl that retries when it's interrupted by a signal.
+/// </summary>
+static int xioctl(int fd, unsigned long request, void* argument) {
+	int result;
+	do {
+		result = ioctl(fd, request, argument);
+	} while (result == -1 && errno == EINTR);
+
+	return result;
+}
+
+static uint32_t toV4l2PixelFormat(PixelFormat format) {
+	switch (format) {
+	case PixelFormat::BGR: return V4L2_PIX_FMT_BGR24;
+	case PixelFormat::NV12: return V4L2_PIX_FMT_NV12;
+#ifdef V4L2_PIX_FMT_BGR48
+	case PixelFormat::BGR16: return V4L2_PIX_FMT_BGR48;
+#endif
+#ifdef V4L2_PIX_FMT_Y210
+	case PixelFormat::Y210: return V4L2_PIX_FMT_Y210;
+#endif
+#ifdef V4L2_PIX_FMT_P010
+	case PixelFormat::P010: return V4L2_PIX_FMT_P010;
+#endif
+	case PixelFormat::YUYV:
+	default: return V4L2_PIX_FMT_YUYV;
+	}
+}
+
+V4l2FrameSource::V4l2FrameSource(std::string devicePath, PixelFormat requestedFormat, int bufferCount)
+	: m_devicePath(devicePath), m_requestedFormat(requestedFormat), m_bufferCount(bufferCount) { }
+
+V4l2FrameSource::~V4l2FrameSource() {
+	this->close();
+}
+
+V4l2FrameSource::Buffers::~Buffers() {
+	for (size_t i = 0; i < starts.size(); i++) {
+		munmap(starts[i], lengths[i]);
+	}
+	if (fd != -1) ::close(fd);
+}
+
+/// <summary>
+/// Gives the buffer back to the driver, so it can be filled again.
+/// Does nothing when the stream is already stopped.
+/// </summary>
+void V4l2FrameSource::Buffers::queue(uint32_t index) const {
+	if (!streaming) return;
+
+	v4l2_buffer buffer = {};
+	buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buffer.memory = V4L2_MEMORY_MMAP;
+	buffer.index = index;
+	xioctl(fd, VIDIOC_QBUF, &buffer);
+}
+
+/// <summary>
+/// Opens the device, negotiates the format, mmaps the buffers and starts streaming.
+/// </summary>
+bool V4l2FrameSource::open() {
+	this->close();
+
+	auto buffers = std::make_shared<Buffers>();
+	buffers->fd = ::open(m_devicePath.c_str(), O_RDWR | O_NONBLOCK);
+	if (buffers->fd == -1) {
+		LOG_ERROR("Can't open V4L2 device " << m_devicePath << ": " << std::strerror(errno));
+		return false;
+	}
+
+	// Check if the device can stream
+	v4l2_capability capability = {};
+	if (xioctl(buffers->fd, VIDIOC_QUERYCAP, &capability) == -1
+		|| !(capability.capabilities & V4L2_CAP_VIDEO_CAPTURE)
+		|| !(capability.capabilities & V4L2_CAP_STREAMING)) {
+		LOG_ERROR(m_devicePath << " is not a V4L2 capture device that can stream!");
+		return false;
+	}
+
+	// Negotiate the format, the size is left to the device (the size of the HDMI signal)
+	v4l2_format format = {};
+	format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+	// Reopening: try the last negotiated format first
+	bool hasFormat = false;
+	if (m_lastV4l2PixelFormat != 0) {
+		format.fmt.pix.pixelformat = m_lastV4l2PixelFormat;
+		format.fmt.pix.width = m_lastWidth;
+		format.fmt.pix.height = m_lastHeight;
+		format.fmt.pix.field = V4L2_FIELD_NONE;
+		hasFormat = xioctl(buffers->fd, VIDIOC_S_FMT, &format) != -1
+			&& format.fmt.pix.pixelformat == m_lastV4l2PixelFormat
+			&& format.fmt.pix.width == m_lastWidth && format.fmt.pix.height == m_lastHeight;
+	}
+
+	if (!hasFormat) {
+		format = {};
+		format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		if (xioctl(buffers->fd, VIDIOC_G_FMT, &format) == -1) {
+			LOG_ERROR("Can't get the format of " << m_devicePath << ": " << std::strerror(errno));
+			return false;
+		}
+
+		format.fmt.pix.pixelformat = toV4l2PixelFormat(m_requestedFormat);
+		format.fmt.pix.field = V4L2_FIELD_NONE;
+		if (xioctl(buffers->fd, VIDIOC_S_FMT, &format) == -1) {
+			LOG_ERROR("Can't set the format of " << m_devicePath << ": " << std::strerror(errno));
+			return false;
+		}
+	}
+
+	// The driver can pick a other format than requested
+	switch (format.fmt.pix.pixelformat) {
+	case V4L2_PIX_FMT_YUYV: m_format = PixelFormat::YUYV; break;
+	case V4L2_PIX_FMT_NV12: m_format = PixelFormat::NV12; break;
+	case V4L2_PIX_FMT_BGR24: m_format = PixelFormat::BGR; break;
+	// The 10 bit formats of HDMI capture of HDR sources (needs a newer kernel header)
+#ifdef V4L2_PIX_FMT_BGR48
+	case V4L2_PIX_FMT_BGR48: m_format = PixelFormat::BGR16; break;
+#endif
+#ifdef V4L2_PIX_FMT_Y210
+	case V4L2_PIX_FMT_Y210: m_format = PixelFormat::Y210; break;
+#endif
+#ifdef V4L2_PIX_FMT_P010
+	case V4L2_PIX_FMT_P010: m_format = PixelFormat::P010; break;
+#endif
+	default:
+		LOG_ERROR(m_devicePath << " has a unsupported pixel format: " << format.fmt.pix.pixelformat);
+		return false;
+	}
+	m_width = format.fmt.pix.width;
+	m_height = format.fmt.pix.height;
+	m_bytesPerLine = format.fmt.pix.bytesperline;
+
+	m_lastV4l2PixelFormat = format.fmt.pix.pixelformat;
+	m_lastWidth = format.fmt.pix.width;
+	m_lastHeight = format.fmt.pix.height;
+
+	// Request and map the buffers
+	v4l2_requestbuffers request = {};
+	request.count = m_bufferCount;
+	request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	request.memory = V4L2_MEMORY_MMAP;
+	if (xioctl(buffers->fd, VIDIOC_REQBUFS, &request) == -1 || request.count < 2) {
+		LOG_ERROR("Can't request buffers from " << m_devicePath << ": " << std::strerror(errno));
+		return false;
+	}
+
+	for (uint32_t i = 0; i < request.count; i++) {
+		v4l2_buffer buffer = {};
+		buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buffer.memory = V4L2_MEMORY_MMAP;
+		buffer.index = i;
+		if (xioctl(buffers->fd, VIDIOC_QUERYBUF, &buffer) == -1) {
+			LOG_ERROR("Can't query buffer " << i << " of " << m_devicePath << ": " << std::strerror(errno));
+			return false;
+		}
+
+		void* start = mmap(nullptr, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, buffers->fd, buffer.m.offset);
+		if (start == MAP_FAILED) {
+			LOG_ERROR("Can't mmap buffer " << i << " of " << m_devicePath << ": " << std::strerror(errno));
+			return false;
+		}
+		buffers->starts.push_back(start);
+		buffers->lengths.push_back(buffer.length);
+	}
+
+	// Queue all buffers and start streaming
+	buffers->streaming = true;
+	for (uint32_t i = 0; i < buffers->starts.size(); i++) {
+		buffers->queue(i);
+	}
+
+	v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (xioctl(buffers->fd, VIDIOC_STREAMON, &type) == -1) {
+		LOG_ERROR("Can't start streaming " << m_devicePath << ": " << std::strerror(errno));
+		buffers->streaming = false;
+		return false;
+	}
+
+	LOG_INFO("Streaming " << m_devicePath << " at " << m_width << "x" << m_height
+		<< " with " << buffers->starts.size() << " buffers");
+
+	m_buffers = buffers;
+	return true;
+}
+
+/// <summary>
+/// Stops streaming. The buffers stay mapped till the last frame using them is released.
+/// </summary>
+void V4l2FrameSource::close() {
+	if (!m_buffers) return;
+
+	m_buffers->streaming = false;
+	v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	xioctl(m_buffers->fd, VIDIOC_STREAMOFF, &type);
+
+	m_buffers.reset();
+}
+
+/// <summary>
+/// Waits for the driver to fill a buffer and wraps it in the frame, without copying it.
+/// </summary>
+bool V4l2FrameSource::read(Frame& frame) {
+	frame.release(); // <- Gives the buffer of the previous frame in this slot back to the driver
+
+	if (!m_buffers) return false;
+
+	// Without a signal the stream stays open, the poll wakes up on the first frame after it
+	pollfd pollFd = { m_buffers->fd, POLLIN, 0 };
+	int result = poll(&pollFd, 1, Config::CAPTURE_TIMEOUT_MS);
+	if (result <= 0) {
+		if (result == 0) {
+			if (!m_waitingForSignal) LOG_WARNING("Timeout while waiting for a frame from " << m_devicePath << ", waiting for a signal");
+			m_waitingForSignal = true;
+		}
+		else {
+			m_waitingForSignal = (errno == EINTR);
+		}
+		return false;
+	}
+
+	v4l2_buffer buffer = {};
+	buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buffer.memory = V4L2_MEMORY_MMAP;
+	if (xioctl(m_buffers->fd, VIDIOC_DQBUF, &buffer) == -1) {
+		m_waitingForSignal = (errno == EAGAIN); // <- ENODEV or EIO: the device is gone or broken, it has to be reopened
+		if (!m_waitingForSignal) LOG_WARNING("Can't dequeue a frame from " << m_devicePath << ": " << std::strerror(errno));
+		return false;
+	}
+	m_waitingForSignal = false;
+
+	if (buffer.flags & V4L2_BUF_FLAG_ERROR) {
+		m_buffers->queue(buffer.index);
+		return false;
+	}
+
+	// Wrap the buffer
+	void* start = m_buffers->starts[buffer.index];
+	switch (m_format) {
+	case PixelFormat::BGR:
+		frame.image = cv::Mat(m_height, m_width, CV_8UC3, start, m_bytesPerLine);
+		break;
+	case PixelFormat::YUYV:
+		frame.image = cv::Mat(m_height, m_width, CV_8UC2, start, m_bytesPerLine);
+		break;
+	case PixelFormat::NV12:
+		frame.image = cv::Mat(m_height * 3 / 2, m_width, CV_8UC1, start, m_bytesPerLine);
+		break;
+	case PixelFormat::BGR16:
+		frame.image = cv::Mat(m_height, m_width, CV_16UC3, start, m_bytesPerLine);
+		break;
+	case PixelFormat::Y210:
+		frame.image = cv::Mat(m_height, m_width, CV_16UC2, start, m_bytesPerLine);
+		break;
+	case PixelFormat::P010:
+		frame.image = cv::Mat(m_height * 3 / 2, m_width, CV_16UC1, start, m_bytesPerLine);
+		break;
+	}
+	frame.format = m_format;
+
+	// The lease queues the buffer again once the last copy of it is gone
+	std::shared_ptr<Buffers> buffers = m_buffers;
+	uint32_t index = buffer.index;
+	frame.bufferLease = std::shared_ptr<void>(start, [buffers, index](void*) {
+		buffers->queue(index);
+	});
+
+	return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+#include "FrameSource.h"
+#include "PixelFormat.h"
+
+/// <summary>
+/// A FrameSource that streams straight from a V4L2 device (like the capture card or v4l2loopback).
+///
+/// The driver fills a set of buffers that are mmap'ed once (VIDIOC_REQBUFS + mmap).
+/// A read dequeues a filled buffer and wraps it in the frame without copying or converting it,
+/// the buffer is queued again once the lease in the frame is released.
+/// The zone averages are calculated on the YUYV/NV12 data, so only the averages are converted to BGR.
+/// A reopen first asks for the last negotiated format, so the device doesn't have to be asked for its format again.
+/// </summary>
+class V4l2FrameSource : public FrameSource
+{
+public:
+	// Constructor
+	V4l2FrameSource(std::string devicePath, PixelFormat requestedFormat, int bufferCount);
+	~V4l2FrameSource();
+
+	// Methods
+	bool open() override;
+	void close() override;
+	bool read(Frame& frame) override;
+
+	// Getters & setters
+	bool isOpened() const override { return m_buffers != nullptr; }
+	const char* getName() const override { return "v4l2"; }
+	const char* getDevicePath() const override { return m_devicePath.c_str(); }
+	bool isWaitingForSignal() const override { return m_waitingForSignal; }
+
+private:
+	/// <summary>
+	/// The file descriptor and mmap'ed buffers of a stream.
+	/// Shared with the leases of the frames, so it's only unmapped when the last frame is released.
+	/// </summary>
+	struct Buffers {
+		int fd = -1;
+		std::vector<void*> starts;
+		std::vector<size_t> lengths;
+		std::atomic<bool> streaming = false;
+
+		~Buffers();
+		void queue(uint32_t index) const;
+	};
+
+	// Members
+	std::string m_devicePath;
+	PixelFormat m_requestedFormat;
+	int m_bufferCount;
+
+	std::shared_ptr<Buffers> m_buffers;
+	bool m_waitingForSignal = false; // <- The last read timed out, or the driver had no buffer (EAGAIN)
+
+	// Negotiated format
+	PixelFormat m_format = PixelFormat::YUYV;
+	int m_width = 0;
+	int m_height = 0;
+	int m_bytesPerLine = 0;
+
+	// Last negotiated format, requested first when reopening (after a HDMI source switch most devices come back with the same format)
+	uint32_t m_lastV4l2PixelFormat = 0;
+	uint32_t m_lastWidth = 0;
+	uint32_t m_lastHeight = 0;
+};
@@ -0,0 +1,92 @@
+#include "WeightTable.h"
+
+#include <cmath>
+#include <algorithm>
+
+static uint32_t quantizeWeight(float weight) {
+	return std::clamp((uint32_t)std::lround(weight * WeightTable::MAX_WEIGHT), (uint32_t)1, WeightTable::MAX_WEIGHT);
+}
+
+/// <summary>
+/// Builds the depth weights of every side and the tangent weights of every zone.
+/// The depth weights fall off as a gaussian toward the centre of the screen,
+/// the zones reach into their neighbours on both ends with a linearly falling tangent weight.
+/// The buffers are reused, so building the same zones again (for example with a other content rect) doesn't allocate.
+/// </summary>
+/// <param name="zones">The laid out zones, all zones on a side have the same depth</param>
+/// <param name="contentRect">The part of the frame without black bars, nothing outside it gets a weight</param>
+/// <param name="frameDimensions">Dimensions of the frames that will be reduced</param>
+/// <param name="kernel">How the pixels are weighted</param>
+/// <param name="rowStride">Only the rows that are a multiple of this get a weight, 1 weights every row</param>
+void WeightTable::build(const ZoneTable& zones, const cv::Rect& contentRect, Dimensions frameDimensions, const SamplingKernel& kernel, int rowStride) {
+	m_frameDimensions = frameDimensions;
+	m_rowStride = std::max(rowStride, 1);
+	const cv::Rect content = contentRect & cv::Rect(0, 0, frameDimensions.width, frameDimensions.height);
+
+	for (SideWeights& sideWeights : m_sides) {
+		sideWeights.hasZones = false;
+		sideWeights.depthWeights.clear();
+		sideWeights.depthWeightTotal = 0;
+	}
+	m_zones.clear();
+	m_tangentWeights.clear();
+	m_boundingRects.clear();
+
+	for (size_t i = 0; i < zones.size(); i++) {
+		const ZoneSide side = zones.slots[i].side;
+		const cv::Rect& rect = zones.rects[i];
+		const bool horizontal = (side == ZoneSide::TOP || side == ZoneSide::BOTTOM);
+
+		// Depth weights, from the first zone on the side
+		SideWeights& sideWeights = m_sides[(int)side];
+		if (!sideWeights.hasZones) {
+			sideWeights.hasZones = true;
+			sideWeights.horizontal = horizontal;
+
+			const int depth = horizontal ? rect.height : rect.width;
+			const int rectDepthBegin = horizontal ? rect.y : rect.x;
+			const int depthBegin = std::max(rectDepthBegin, horizontal ? content.y : content.x);
+			const int depthEnd = std::min(rectDepthBegin + depth, horizontal ? content.y + content.height : content.x + content.width);
+
+			sideWeights.depthBegin = depthBegin;
+			for (int position = depthBegin; position < depthEnd; position++) {
+				float weight = 1.0f;
+				if (kernel.depthFalloff > 0.0f) {
+					// Distance of the middle of the row or column to the edge of the screen, 0 - 1
+					const bool edgeAtBegin = (side == ZoneSide::TOP || side == ZoneSide::LEFT);
+					const int offset = edgeAtBegin ? position - rectDepthBegin : rectDepthBegin + depth - 1 - position;
+					const float distance = (offset + 0.5f) / depth / kernel.depthFalloff;
+					weight = std::exp(-0.5f * distance * distance);
+				}
+
+				const bool sampled = !horizontal || position % m_rowStride == 0;
+				sideWeights.depthWeights.push_back(sampled ? quantizeWeight(weight) : 0);
+				sideWeights.depthWeightTotal += sideWeights.depthWeights.back();
+			}
+		}
+
+		// Tangent weights, the zone plus the part that reaches into its neighbours
+		const int tangentBegin = horizontal ? rect.x : rect.y;
+		const int tangentEnd = horizontal ? rect.x + rect.width : rect.y + rect.height;
+		const int extension = (int)std::lround(std::max(0.0f, kernel.overlap) * (tangentEnd - tangentBegin));
+		const int begin = std::max(tangentBegin - extension, horizontal ? content.x : content.y);
+		const int end = std::min(tangentEnd + extension, horizontal ? content.x + content.width : content.y + content.height);
+
+		ZoneWeights zoneWeights = { side, begin, (int)m_tangentWeights.size(), (int)m_tangentWeights.size(), 0 };
+		uint64_t tangentWeightTotal = 0;
+		for (int position = begin; position < end; position++) {
+			const int distance = (position < tangentBegin) ? tangentBegin - position : (position >= tangentEnd ? position - tangentEnd + 1 : 0);
+			const bool sampled = horizontal || position % m_rowStride == 0;
+			m_tangentWeights.push_back(sampled ? quantizeWeight(1.0f - (float)distance / (extension + 1)) : 0);
+			tangentWeightTotal += m_tangentWeights.back();
+		}
+		zoneWeights.weightEnd = (int)m_tangentWeights.size();
+		zoneWeights.weightTotal = tangentWeightTotal * sideWeights.depthWeightTotal;
+		m_zones.push_back(zoneWeights);
+
+		const int depthCount = (int)sideWeights.depthWeights.size();
+		m_boundingRects.push_back(horizontal
+			? cv::Rect(begin, sideWeights.depthBegin, std::max(0, end - begin), depthCount)
+			: cv::Rect(sideWeights.depthBegin, begin, depthCount, std::max(0, end - begin)));
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "ZoneTable.h"
+#include "Dimensions.h"
+
+/// <summary>
+/// How the pixels of a zone are weighted. The default is the flat kernel: a hard edged rect where every pixel counts the same.
+/// </summary>
+struct SamplingKernel {
+	float depthFalloff = 0.0f; // <- Sigma of a gaussian falloff toward the centre of the screen, as ratio of the zone thickness. 0 is flat
+	float overlap = 0.0f; // <- How far a zone reaches into its neighbours (falling off linearly), as ratio of the zone length. 0 is hard edges
+
+	bool isFlat() const { return depthFalloff <= 0.0f && overlap <= 0.0f; }
+};
+
+/// <summary>
+/// The depth weights of a side, shared by all zones on it.
+/// The depth goes over the rows on the top and bottom side, and over the columns on the left and right side.
+/// </summary>
+struct SideWeights {
+	bool hasZones = false;
+	bool horizontal = false; // <- Top or bottom
+	int depthBegin = 0; // <- First row (horizontal) or column of the side
+	std::vector<uint32_t> depthWeights; // <- Per row or column from depthBegin
+	uint64_t depthWeightTotal = 0;
+};
+
+/// <summary>
+/// The tangent weights of a zone: the weight of every column (top and bottom side) or row (left and right side) it covers.
+/// </summary>
+struct ZoneWeights {
+	ZoneSide side;
+	int tangentBegin; // <- Column or row of the first tangent weight
+	int weightBegin; // <- Range in the tangent weights of the table
+	int weightEnd;
+	uint64_t weightTotal; // <- Sum of the weights of all pixels of the zone
+};
+
+/// <summary>
+/// Compiles the zones and a SamplingKernel into a sparse weight table, only the border pixels are in it.
+///
+/// The weight of a pixel is its depth weight (the distance from the edge of the screen) times its tangent weight (the place along the edge),
+/// so the table only holds a weight per row or column: a depth profile per side and a tangent profile per zone.
+/// That lets the WeightedReducer reduce a side in one pass, no matter how much the zones overlap.
+/// With a row stride above 1 the rows that are not a multiple of it get a weight of 0 (and are skipped by the WeightedReducer).
+/// Needs to be build again when the zones are laid out again.
+/// </summary>
+class WeightTable
+{
+public:
+	static constexpr uint32_t MAX_WEIGHT = 255;
+
+	// Methods
+	void build(const ZoneTable& zones, const cv::Rect& contentRect, Dimensions frameDimensions, const SamplingKernel& kernel, int rowStride = 1);
+
+	// Getters & setters
+	const Dimensions& getFrameDimensions() const { return m_frameDimensions; }
+	int getRowStride() const { return m_rowStride; }
+	const SideWeights& getSideWeights(ZoneSide side) const { return m_sides[(int)side]; }
+	const std::vector<ZoneWeights>& getZoneWeights() const { return m_zones; }
+	const std::vector<uint32_t>& getTangentWeights() const { return m_tangentWeights; }
+	const std::vector<cv::Rect>& getBoundingRects() const { return m_boundingRects; } // <- Per zone, every pixel that has a weight
+
+private:
+	// Members
+	Dimensions m_frameDimensions = { 0, 0 };
+	int m_rowStride = 1;
+	std::array<SideWeights, 4> m_sides; // <- Indexed by ZoneSide
+	std::vector<ZoneWeights> m_zones; // <- Same order as the zone table
+	std::vector<uint32_t> m_tangentWeights;
+	std::vector<cv::Rect> m_boundingRects;
+};
@@ -0,0 +1,317 @@
+#include "WeightedReducer.h"
+#include "BorderReducer.h"
+
+#include <algorithm>
+#include <climits>
+
+/// <summary>
+/// Uses the given weight table for the next reduces, the table has to stay alive.
+/// Needs to be called again when the table is build again.
+/// </summary>
+void WeightedReducer::build(const WeightTable& weightTable) {
+	m_weightTable = &weightTable;
+
+	// Sized for the biggest profile, so reducing doesn't allocate
+	const Dimensions& frameDimensions = weightTable.getFrameDimensions();
+	m_profile.assign((size_t)std::max(frameDimensions.width, frameDimensions.height) * 3, 0);
+	m_uvProfile.assign(frameDimensions.width, 0);
+	m_byteWeights.assign((size_t)(frameDimensions.width + 1) * 3, 0);
+	m_uvByteWeights.assign((size_t)frameDimensions.width + 1, 0);
+}
+
+/// <summary>
+/// Reads the 3 channels of pixel x from a row (Blue, Green, Red or Y, U, V).
+/// Works on the bytes of a frame row and on a folded profile, which has the same layout.
+/// </summary>
+template<PixelFormat FORMAT, typename T>
+static inline void readPixel(const T* row, const T* uvRow, int x, uint32_t pixel[3]) {
+	if constexpr (FORMAT == PixelFormat::BGR) {
+		pixel[0] = row[x * 3];
+		pixel[1] = row[x * 3 + 1];
+		pixel[2] = row[x * 3 + 2];
+	}
+	if constexpr (FORMAT == PixelFormat::YUYV) {
+		const T* pair = row + (x & ~1) * 2; // <- Y0 U Y1 V
+		pixel[0] = row[x * 2];
+		pixel[1] = pair[1];
+		pixel[2] = pair[3];
+	}
+	if constexpr (FORMAT == PixelFormat::NV12) {
+		pixel[0] = row[x];
+		pixel[1] = uvRow[x & ~1];
+		pixel[2] = uvRow[(x & ~1) + 1];
+	}
+}
+
+/// <summary>
+/// Folds 2 weighted rows into the profile, with the kernels of the CPU for 8 bit samples.
+/// </summary>
+static inline void accumulateWeighted(const SumKernels& sumKernels, const uint8_t* first, const uint8_t* second, int count,
+	uint32_t firstWeight, uint32_t secondWeight, uint32_t* profile) {
+	sumKernels.accumulateWeighted(first, second, count, firstWeight, secondWeight, profile);
+}
+
+/// <summary>
+/// Folds 2 weighted rows of 16 bit samples into the profile, on their top 10 bits (255 * 1023 per row still leaves room for thousands of rows).
+/// In blocks of a fixed size, so the compiler vectorizes them.
+/// </summary>
+static inline void accumulateWeighted(const SumKernels&, const uint16_t* first, const uint16_t* second, int count,
+	uint32_t firstWeight, uint32_t secondWeight, uint32_t* profile) {
+	constexpr int BLOCK_SIZE = 16;
+	int i = 0;
+	for (; i + BLOCK_SIZE <= count; i += BLOCK_SIZE) {
+		for (int b = 0; b < BLOCK_SIZE; b++) {
+			profile[i + b] += firstWeight * (uint32_t)(first[i + b] >> HIGH_BIT_DEPTH_SHIFT) + secondWeight * (uint32_t)(second[i + b] >> HIGH_BIT_DEPTH_SHIFT);
+		}
+	}
+	for (; i < count; i++) {
+		profile[i] += firstWeight * (uint32_t)(first[i] >> HIGH_BIT_DEPTH_SHIFT) + secondWeight * (uint32_t)(second[i] >> HIGH_BIT_DEPTH_SHIFT);
+	}
+}
+
+/// <summary>
+/// Weighted sum of the channels of a strip, with the kernels of the CPU for 8 bit samples.
+/// </summary>
+static inline void sumWeighted(const SumKernels& sumKernels, const uint8_t* samples, const uint16_t* weights, int count, int channelCount,
+	uint32_t sums[4]) {
+	sumKernels.sumWeighted(samples, weights, count, channelCount, sums);
+}
+
+/// <summary>
+/// Weighted sum of the channels of a strip of 16 bit samples, on their top 10 bits.
+/// The samples are added to LANE_COUNT lanes (a multiple of the channel count) that the compiler can vectorize, and only then to their channel.
+/// </summary>
+template<int CHANNEL_COUNT>
+static inline void sumWeighted16(const uint16_t* samples, const uint16_t* weights, int count, uint32_t sums[4]) {
+	constexpr int LANE_COUNT = CHANNEL_COUNT * 4;
+	uint32_t lanes[LANE_COUNT] = {};
+	int i = 0;
+	for (; i + LANE_COUNT <= count; i += LANE_COUNT) {
+		for (int l = 0; l < LANE_COUNT; l++) {
+			lanes[l] += (uint32_t)weights[i + l] * (uint32_t)(samples[i + l] >> HIGH_BIT_DEPTH_SHIFT);
+		}
+	}
+	for (int l = 0; i < count; i++, l++) {
+		lanes[l] += (uint32_t)weights[i] * (uint32_t)(samples[i] >> HIGH_BIT_DEPTH_SHIFT);
+	}
+
+	for (int l = 0; l < LANE_COUNT; l++) sums[l % CHANNEL_COUNT] += lanes[l];
+}
+
+static inline void sumWeighted(const SumKernels&, const uint16_t* samples, const uint16_t* weights, int count, int channelCount,
+	uint32_t sums[4]) {
+	switch (channelCount) {
+	case 1: sumWeighted16<1>(samples, weights, count, sums); break;
+	case 2: sumWeighted16<2>(samples, weights, count, sums); break;
+	case 3: sumWeighted16<3>(samples, weights, count, sums); break;
+	default: sumWeighted16<4>(samples, weights, count, sums); break;
+	}
+}
+
+/// <summary>
+/// Folds the (dirty part of the) side into the profile and calculates the averages of its (dirty) zones.
+/// </summary>
+template<PixelFormat FORMAT>
+void WeightedReducer::reduceSide(const cv::Mat& frame, ZoneSide side, std::vector<cv::Vec3b>& averages, const std::vector<uint8_t>* dirtyZones) {
+	const WeightTable& weightTable = *m_weightTable;
+	const SideWeights& sideWeights = weightTable.getSideWeights(side);
+	const std::vector<ZoneWeights>& zones = weightTable.getZoneWeights();
+	const uint32_t* tangentWeights = weightTable.getTangentWeights().data();
+	const int frameHeight = weightTable.getFrameDimensions().height;
+	constexpr PixelFormat LAYOUT = getLayout(FORMAT);
+	using Sample = SampleType<FORMAT>;
+
+	if (!sideWeights.hasZones) return;
+
+	// The part of the side that is covered by the zones that need a new average
+	int begin = INT_MAX;
+	int end = INT_MIN;
+	for (size_t z = 0; z < zones.size(); z++) {
+		if (zones[z].side != side || (dirtyZones != nullptr && !(*dirtyZones)[z])) continue;
+		if (zones[z].weightBegin == zones[z].weightEnd) continue;
+
+		begin = std::min(begin, zones[z].tangentBegin);
+		end = std::max(end, zones[z].tangentBegin + (zones[z].weightEnd - zones[z].weightBegin));
+	}
+
+	uint32_t* profile = m_profile.data();
+	uint32_t* uvProfile = m_uvProfile.data();
+	const int depthCount = (int)sideWeights.depthWeights.size();
+
+	if (begin < end && sideWeights.horizontal) {
+		// Fold the rows into a weighted sum per byte of the columns
+		int byteBegin = begin * 3, byteEnd = end * 3;
+		int uvBegin = 0, uvEnd = 0;
+		if constexpr (LAYOUT == PixelFormat::YUYV) {
+			byteBegin = (begin & ~1) * 2; // <- Whole pairs, for the U and V
+			byteEnd = ((end + 1) & ~1) * 2;
+		}
+		if constexpr (LAYOUT == PixelFormat::NV12) {
+			byteBegin = begin;
+			byteEnd = end;
+			uvBegin = begin & ~1;
+			uvEnd = (end + 1) & ~1;
+		}
+
+		std::fill(profile + byteBegin, profile + byteEnd, 0);
+		std::fill(uvProfile + uvBegin, uvProfile + uvEnd, 0);
+
+		// Only the rows of the row stride, the others have a weight of 0
+		const int rowStride = weightTable.getRowStride();
+		const int firstDepth = firstSampledRow(sideWeights.depthBegin, rowStride) - sideWeights.depthBegin;
+		for (int d = firstDepth; d < depthCount; d += 2 * rowStride) {
+			// 2 rows at a time, a odd last row is paired with itself with a weight of 0
+			const bool hasSecondRow = d + rowStride < depthCount;
+			const int y = sideWeights.depthBegin + d;
+			const int secondY = hasSecondRow ? y + rowStride : y;
+			const uint32_t weight = sideWeights.depthWeights[d];
+			const uint32_t secondWeight = hasSecondRow ? sideWeights.depthWeights[d + rowStride] : 0;
+
+			accumulateWeighted(*m_sumKernels, frame.ptr<Sample>(y) + byteBegin, frame.ptr<Sample>(secondY) + byteBegin, byteEnd - byteBegin,
+				weight, secondWeight, profile + byteBegin);
+			if constexpr (LAYOUT == PixelFormat::NV12) {
+				accumulateWeighted(*m_sumKernels, frame.ptr<Sample>(frameHeight + y / 2) + uvBegin, frame.ptr<Sample>(frameHeight + secondY / 2) + uvBegin,
+					uvEnd - uvBegin, weight, secondWeight, uvProfile + uvBegin);
+			}
+		}
+	}
+	else if (begin < end) {
+		// Fold the columns into a weighted sum of the 3 channels per row, with a weight per byte of the strip
+		const int depthEnd = sideWeights.depthBegin + depthCount;
+		const int pairBegin = sideWeights.depthBegin & ~1;
+		const int pairEnd = (depthEnd + 1) & ~1;
+		auto depthWeight = [&](int x) -> uint16_t {
+			return (x >= sideWeights.depthBegin && x < depthEnd) ? (uint16_t)sideWeights.depthWeights[x - sideWeights.depthBegin] : 0;
+		};
+
+		int byteBegin = 0, byteCount = 0, uvBegin = 0;
+		uint16_t* byteWeights = m_byteWeights.data();
+		uint16_t* uvByteWeights = m_uvByteWeights.data();
+		if constexpr (LAYOUT == PixelFormat::BGR) {
+			byteBegin = sideWeights.depthBegin * 3;
+			byteCount = depthCount * 3;
+			for (int d = 0; d < depthCount; d++) {
+				byteWeights[d * 3] = byteWeights[d * 3 + 1] = byteWeights[d * 3 + 2] = (uint16_t)sideWeights.depthWeights[d];
+			}
+		}
+		if constexpr (LAYOUT == PixelFormat::YUYV) {
+			byteBegin = pairBegin * 2;
+			byteCount = (pairEnd - pairBegin) * 2;
+			for (int x = pairBegin; x < pairEnd; x += 2) {
+				uint16_t* pair = byteWeights + (x - pairBegin) * 2; // <- Y0 U Y1 V, the U and V count for both pixels
+				pair[0] = depthWeight(x);
+				pair[2] = depthWeight(x + 1);
+				pair[1] = pair[3] = pair[0] + pair[2];
+			}
+		}
+		if constexpr (LAYOUT == PixelFormat::NV12) {
+			byteBegin = sideWeights.depthBegin;
+			uvBegin = pairBegin;
+			byteCount = depthCount;
+			for (int d = 0; d < depthCount; d++) {
+				byteWeights[d] = (uint16_t)sideWeights.depthWeights[d];
+			}
+			for (int x = pairBegin; x < pairEnd; x += 2) {
+				uvByteWeights[x - pairBegin] = uvByteWeights[x - pairBegin + 1] = depthWeight(x) + depthWeight(x + 1);
+			}
+		}
+
+		// Only the rows of the row stride, the (old) profile of the others is multiplied with a tangent weight of 0
+		const int rowStride = weightTable.getRowStride();
+		for (int y = firstSampledRow(begin, rowStride); y < end; y += rowStride) {
+			const Sample* row = frame.ptr<Sample>(y);
+
+			uint32_t rowSums[4] = { 0, 0, 0, 0 };
+			if constexpr (LAYOUT == PixelFormat::BGR) {
+				sumWeighted(*m_sumKernels, row + byteBegin, byteWeights, byteCount, 3, rowSums);
+			}
+			if constexpr (LAYOUT == PixelFormat::YUYV) {
+				sumWeighted(*m_sumKernels, row + byteBegin, byteWeights, byteCount, 4, rowSums);
+				rowSums[0] += rowSums[2]; // <- Y0 + Y1
+				rowSums[2] = rowSums[3];
+			}
+			if constexpr (LAYOUT == PixelFormat::NV12) {
+				uint32_t uvSums[4] = { 0, 0, 0, 0 };
+				sumWeighted(*m_sumKernels, row + byteBegin, byteWeights, byteCount, 1, rowSums);
+				sumWeighted(*m_sumKernels, frame.ptr<Sample>(frameHeight + y / 2) + uvBegin, uvByteWeights, pairEnd - pairBegin, 2, uvSums);
+				rowSums[1] = uvSums[0];
+				rowSums[2] = uvSums[1];
+			}
+
+			profile[y * 3] = rowSums[0];
+			profile[y * 3 + 1] = rowSums[1];
+			profile[y * 3 + 2] = rowSums[2];
+		}
+	}
+
+	// Every zone multiplies its tangent weights with its part of the profile
+	for (size_t z = 0; z < zones.size(); z++) {
+		const ZoneWeights& zone = zones[z];
+		if (zone.side != side || (dirtyZones != nullptr && !(*dirtyZones)[z])) continue;
+
+		uint64_t sums[3] = { 0, 0, 0 };
+		for (int w = zone.weightBegin; w < zone.weightEnd; w++) {
+			const int position = zone.tangentBegin + (w - zone.weightBegin);
+			const uint64_t weight = tangentWeights[w];
+
+			uint32_t pixel[3];
+			if (sideWeights.horizontal) readPixel<LAYOUT>(profile, uvProfile, position, pixel);
+			else readPixel<PixelFormat::BGR>(profile, uvProfile, position, pixel); // <- The row profile always holds 3 channels
+			sums[0] += weight * pixel[0];
+			sums[1] += weight * pixel[1];
+			sums[2] += weight * pixel[2];
+		}
+
+		averages[z] = calculateAverageColor(sums, zone.weightTotal, FORMAT, *m_toneMapper);
+	}
+}
+
+/// <summary>
+/// Calculates the weighted average color of every zone of the weight table.
+/// The frame must have the dimensions the table was build for.
+/// </summary>
+/// <param name="frame">Frame to calculate the averages on</param>
+/// <param name="averages">Gets resized to the zone count and filled with the average color (BGR) per zone</param>
+/// <param name="format">The pixel format of the frame</param>
+/// <param name="dirtyZones">Optional, 1 for every zone that needs a new average. The averages of the other zones are kept.</param>
+void WeightedReducer::reduce(const cv::Mat& frame, std::vector<cv::Vec3b>& averages, PixelFormat format,
+	const std::vector<uint8_t>* dirtyZones) {
+	assert(m_weightTable != nullptr);
+	assert(dirtyZones == nullptr || dirtyZones->size() == m_weightTable->getZoneWeights().size());
+
+	averages.resize(m_weightTable->getZoneWeights().size());
+
+	for (ZoneSide side : { ZoneSide::TOP, ZoneSide::BOTTOM, ZoneSide::LEFT, ZoneSide::RIGHT }) {
+		switch (format) {
+		case PixelFormat::BGR:
+			assert(frame.type() == CV_8UC3 && m_weightTable->getFrameDimensions().equals(frame));
+			this->reduceSide<PixelFormat::BGR>(frame, side, averages, dirtyZones);
+			break;
+
+		case PixelFormat::YUYV:
+			assert(frame.type() == CV_8UC2 && m_weightTable->getFrameDimensions().equals(frame));
+			this->reduceSide<PixelFormat::YUYV>(frame, side, averages, dirtyZones);
+			break;
+
+		case PixelFormat::NV12:
+			assert(frame.type() == CV_8UC1 && frame.rows == m_weightTable->getFrameDimensions().height * 3 / 2);
+			this->reduceSide<PixelFormat::NV12>(frame, side, averages, dirtyZones);
+			break;
+
+		case PixelFormat::BGR16:
+			assert(frame.type() == CV_16UC3 && m_weightTable->getFrameDimensions().equals(frame));
+			this->reduceSide<PixelFormat::BGR16>(frame, side, averages, dirtyZones);
+			break;
+
+		case PixelFormat::Y210:
+			assert(frame.type() == CV_16UC2 && m_weightTable->getFrameDimensions().equals(frame));
+			this->reduceSide<PixelFormat::Y210>(frame, side, averages, dirtyZones);
+			break;
+
+		case PixelFormat::P010:
+			assert(frame.type() == CV_16UC1 && frame.rows == m_weightTable->getFrameDimensions().height * 3 / 2);
+			this->reduceSide<PixelFormat::P010>(frame, side, averages, dirtyZones);
+			break;
+		}
+	}
+}
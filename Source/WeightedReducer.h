@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "WeightTable.h"
+#include "PixelFormat.h"
+#include "SumKernels.h"
+#include "ToneMapper.h"
+
+/// <summary>
+/// Calculates the weighted average color of the zones of a WeightTable, in one pass over every side.
+///
+/// Because the weight of a pixel is its depth weight times its tangent weight, a side is reduced in 2 steps:
+/// the rows (or columns) of the side are first folded into a profile with the depth weights, a weighted sum per column (or row).
+/// Every zone then only has to multiply its tangent weights with its part of that profile.
+/// So every border pixel is read once (one multiply-add per byte), no matter how wide the zones are or how much they overlap.
+/// Both folds use the weighted SumKernels, the 16 bit formats are folded on their top 10 bits with scalar loops.
+///
+/// When a mask of dirty zones is given, only the part of a side that is covered by dirty zones is folded
+/// and the clean zones keep the average they already had.
+/// </summary>
+class WeightedReducer
+{
+public:
+	// Methods
+	void build(const WeightTable& weightTable);
+	void reduce(const cv::Mat& frame, std::vector<cv::Vec3b>& averages, PixelFormat format = PixelFormat::BGR,
+		const std::vector<uint8_t>* dirtyZones = nullptr);
+
+	// Getters & setters
+	void setSumKernels(const SumKernels& sumKernels) { m_sumKernels = &sumKernels; }
+	void setToneMapper(const ToneMapper& toneMapper) { m_toneMapper = &toneMapper; }
+
+private:
+	// Methods
+	template<PixelFormat FORMAT>
+	void reduceSide(const cv::Mat& frame, ZoneSide side, std::vector<cv::Vec3b>& averages, const std::vector<uint8_t>* dirtyZones);
+
+	// Members
+	const WeightTable* m_weightTable = nullptr;
+	const SumKernels* m_sumKernels = &getSumKernels();
+	const ToneMapper* m_toneMapper = &getToneMapper(); // <- Only for the 16 bit formats
+
+	std::vector<uint32_t> m_profile; // <- Per byte of a row (top and bottom), or 3 per row (left and right)
+	std::vector<uint32_t> m_uvProfile; // <- Per byte of a UV row of NV12 (top and bottom)
+	std::vector<uint16_t> m_byteWeights; // <- The depth weight of every byte of the strip (left and right)
+	std::vector<uint16_t> m_uvByteWeights; // <- Same for the UV row of NV12
+};
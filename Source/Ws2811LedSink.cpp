@@ -0,0 +1,70 @@
+#include "Ws2811LedSink.h"
+#include "const_config.h"
+
+
+#include <ws2811.h>
+
+Ws2811LedSink::Ws2811LedSink()
+	: Ws2811LedSink({ { Config::DATA_OUT_GPIO_PIN, (int)Config::LED_COUNTS.all() } }) { }
+
+/// <summary>
+/// Drives a strip on every given channel, at most RPI_PWM_CHANNELS. The first channel uses PWM channel 0, the second PWM channel 1.
+/// </summary>
+Ws2811LedSink::Ws2811LedSink(const std::vector<Ws2811Channel>& channels)
+	: m_ledStrip{
+		.freq = Config::TARGET_FREQ,
+		.dmanum = Config::DMA
+	} {
+	for (size_t i = 0; i < channels.size() && i < RPI_PWM_CHANNELS; i++) {
+		ws2811_channel_t& channel = m_ledStrip.channel[i];
+		channel.gpionum = channels[i].gpioPin;
+		channel.invert = 0;
+		channel.count = channels[i].ledCount;
+		channel.strip_type = Config::STRIP_TYPE;
+		channel.brightness = Config::LED_BRIGHTNESS;
+	}
+}
+
+bool Ws2811LedSink::init() {
+	ws2811_return_t result = ws2811_init(&m_ledStrip);
+	if (result != ws2811_return_t::WS2811_SUCCESS) {
+		LOG_ERROR("Can't init led-strip! Error code: " << result);
+		return false;
+	}
+
+	m_initialized = true;
+	return true;
+}
+
+/// <summary>
+/// Copies the given led colors to the LED strips (the first channel first) and then renders the changes to the physical strips.
+/// Note: this blocks until the previous DMA transfer is done.
+/// </summary>
+bool Ws2811LedSink::render(const std::vector<uint32_t>& ledColors) {
+	size_t ledIndex = 0;
+	for (ws2811_channel_t& channel : m_ledStrip.channel) {
+		for (int i = 0; i < channel.count && ledIndex < ledColors.size(); i++, ledIndex++) {
+			channel.leds[i] = ledColors[ledIndex];
+		}
+	}
+
+	ws2811_return_t result = ws2811_render(&m_ledStrip);
+	if (result != ws2811_return_t::WS2811_SUCCESS) {
+		LOG_ERROR("Can't render led-strip! Error code: " << result);
+		return false;
+	}
+
+	return true;
+}
+
+void Ws2811LedSink::fini() {
+	if (!m_initialized) return;
+
+	for (ws2811_channel_t& channel : m_ledStrip.channel) {
+		channel.brightness = 0; // Easy way to turn off all leds
+	}
+	ws2811_render(&m_ledStrip);
+	ws2811_fini(&m_ledStrip);
+
+	m_initialized = false;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include <ws2811.h>
+
+#include "LedSink.h"
+
+/// <summary>
+/// A PWM channel of the Pi and the amount of leds on the strip connected to it.
+/// </summary>
+struct Ws2811Channel {
+	int gpioPin; // <- 12 or 18 for the first PWM channel, 13 or 19 for the second
+	int ledCount;
+};
+
+/// <summary>
+/// A LedSink that renders to WS281x led-strips on the GPIO pins of the Pi, using the PWM/DMA hardware (rpi_ws281x).
+/// Up to 2 strips (one per PWM channel) are driven at the same time by one DMA transfer,
+/// so the transfer takes as long as the longest strip instead of all leds together.
+/// The leds of the channels are rendered from one buffer, the first channel first.
+/// The strips are configured with the values in const_config.h.
+/// </summary>
+class Ws2811LedSink : public LedSink
+{
+public:
+	// Constructor
+	Ws2811LedSink();
+	Ws2811LedSink(const std::vector<Ws2811Channel>& channels);
+
+	// Methods
+	bool init() override;
+	bool render(const std::vector<uint32_t>& ledColors) override;
+	void fini() override;
+
+	// Getters & setters
+	const char* getName() const override { return "ws2811"; }
+
+private:
+	// Members
+	ws2811_t m_ledStrip;
+	bool m_initialized = false;
+};
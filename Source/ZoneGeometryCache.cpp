@@ -0,0 +1,44 @@
+#include "ZoneGeometryCache.h"
+
+#include <algorithm>
+
+ZoneGeometryCache::ZoneGeometryCache(size_t capacity)
+	: m_capacity(std::max<size_t>(capacity, 1)) { }
+
+/// <summary>
+/// Looks up the layout of the given key, and marks it as used.
+/// </summary>
+/// <returns>The layout, nullptr if it isn't build yet</returns>
+ZoneGeometry* ZoneGeometryCache::find(const ZoneGeometryKey& key) {
+	// Only a handful of layouts, a linear search over them is cheaper than hashing the key
+	for (std::unique_ptr<ZoneGeometry>& geometry : m_geometries) {
+		if (!(geometry->key == key)) continue;
+
+		geometry->lastUsed = ++m_useCounter;
+		return geometry.get();
+	}
+
+	return nullptr;
+}
+
+/// <summary>
+/// Gives a layout for the given key, to be build by the caller. When the cache is full the least recently used layout is reused,
+/// its buffers keep their memory so building it again allocates less.
+/// </summary>
+/// <returns>The layout with the key set, the rest still holds the old layout (or nothing)</returns>
+ZoneGeometry& ZoneGeometryCache::add(const ZoneGeometryKey& key) {
+	ZoneGeometry* geometry = nullptr;
+	if (m_geometries.size() < m_capacity) {
+		m_geometries.push_back(std::make_unique<ZoneGeometry>());
+		geometry = m_geometries.back().get();
+	}
+	else {
+		auto leastRecentlyUsed = std::min_element(m_geometries.begin(), m_geometries.end(),
+			[](const std::unique_ptr<ZoneGeometry>& a, const std::unique_ptr<ZoneGeometry>& b) { return a->lastUsed < b->lastUsed; });
+		geometry = leastRecentlyUsed->get();
+	}
+
+	geometry->key = key;
+	geometry->lastUsed = ++m_useCounter;
+	return *geometry;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "Dimensions.h"
+#include "BorderReducer.h"
+#include "WeightTable.h"
+#include "WeightedReducer.h"
+#include "DominantColorReducer.h"
+#include "ChangeDetector.h"
+
+/// <summary>
+/// What a zone layout is build for: the input resolution, the content rect (black bars) and the row stride of the QualityGovernor.
+/// </summary>
+struct ZoneGeometryKey {
+	Dimensions frameDimensions;
+	cv::Rect contentRect;
+	int rowStride;
+
+	bool operator==(const ZoneGeometryKey& value) const {
+		return frameDimensions == value.frameDimensions && contentRect == value.contentRect && rowStride == value.rowStride;
+	}
+};
+
+/// <summary>
+/// A complete zone layout: the rect of every zone and everything the reducers compiled from it (the bands and segments of the BorderReducer,
+/// the weights of the WeightTable or the sample grids and histograms of the DominantColorReducer), together with a ChangeDetector sampling those zones.
+/// </summary>
+struct ZoneGeometry {
+	ZoneGeometryKey key;
+	std::vector<cv::Rect> rects; // <- Same order as the zone table, inside the content rect
+	BorderReducer borderReducer; // <- Flat kernel
+	WeightTable weightTable;
+	WeightedReducer weightedReducer; // <- Other kernels, points into weightTable
+	DominantColorReducer dominantColorReducer; // <- ZoneColorMode::DOMINANT, keeps the histograms of the last time the layout was used
+	ChangeDetector changeDetector;
+	uint64_t lastUsed = 0;
+};
+
+/// <summary>
+/// Keeps the zone layouts of the last few input resolutions and content rects, so switching the HDMI source (1080p console, 4K streamer,
+/// 720p set-top box) or a movie with black bars coming and going doesn't build the zones and reducers again.
+/// A layout that is in the cache is switched to by pointer, building one is only done the first time.
+///
+/// Holds at most capacity layouts, the least recently used one is reused for a new layout.
+/// The layouts don't move in memory (the WeightedReducer points into its WeightTable).
+/// </summary>
+class ZoneGeometryCache
+{
+public:
+	// Constructor
+	ZoneGeometryCache(size_t capacity);
+
+	// Methods
+	ZoneGeometry* find(const ZoneGeometryKey& key);
+	ZoneGeometry& add(const ZoneGeometryKey& key);
+	void clear() { m_geometries.clear(); }
+
+	// Getters & setters
+	size_t size() const { return m_geometries.size(); }
+	size_t getCapacity() const { return m_capacity; }
+
+private:
+	// Members
+	size_t m_capacity;
+	std::vector<std::unique_ptr<ZoneGeometry>> m_geometries;
+	uint64_t m_useCounter = 0;
+};
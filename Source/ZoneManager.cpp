@@ -1,114 +1,72 @@
-#include <iostream>
 #include <cmath>
 #include <vector>
+#include <algorithm>
+#include <iterator>
 
 #include "ZoneManager.h"
 #include "const_config.h"
 #include "Dimensions.h"
 #include "LEDCounts.h"
+#include "ZoneTable.h"
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 
 ZoneManager::ZoneManager(LEDCounts LEDCounts, Dimensions frameDimensions)
-	: m_LEDCounts(LEDCounts), m_frameDimensions(frameDimensions), m_zones(this->generateZones()){ }
+	: m_LEDCounts(LEDCounts), m_frameDimensions(frameDimensions),
+	m_contentRect(0, 0, frameDimensions.width, frameDimensions.height), m_zones(this->generateZones()),
+	m_colorMode(Config::ZONE_COLOR_MODE), m_toneMapper(Config::TONE_MAPPING), m_geometryCache(Config::ZONE_GEOMETRY_CACHE_SIZE), m_changeDetection(Config::CHANGE_DETECTION) {
+	m_samplingKernel.depthFalloff = Config::ZONE_DEPTH_FALLOFF;
+	m_samplingKernel.overlap = Config::ZONE_OVERLAP;
 
-/// <summary>
-/// Generate zones based on the m_LEDCounts and puts it in a map with the associated ZoneSide.
-/// </summary>
-/// <returns>A map of ZoneSides with the associated generated zones.</returns>
-std::map<ZoneSide, std::vector<Zone>> ZoneManager::generateZones() const {
-	std::cout << "Generating zones..." << std::endl;
-	std::map<ZoneSide, std::vector<Zone>> zoneMap;
-
-	ZoneSide sidesToInclude[] = { 
-		ZoneSide::TOP, ZoneSide::BOTTOM, 
-		ZoneSide::LEFT, ZoneSide::RIGHT 
-	};
-
-	for (ZoneSide side : sidesToInclude) {
-		const cv::Vec3b redColor(0, 0, 255);
-		const cv::Vec3b blueColor(255, 0, 0);
-		const cv::Vec3b greenColor(0, 255, 0);
-		const cv::Vec3b yellowColor(0, 255, 255);
-
-		// Set LEDCount and borderColor and calculate dimension based on ZoneSide
-		int LEDCount;
-		Dimensions dimensions;
-		cv::Vec3b borderColor;
-
-		switch (side) {
-		case ZoneSide::TOP:
-			borderColor = redColor;
-			LEDCount = this->m_LEDCounts.top;
-			dimensions = this->calculateHorizontalZoneDimensions(LEDCount);
-			break;
-			
-		case ZoneSide::BOTTOM:
-			borderColor = blueColor;
-			LEDCount = this->m_LEDCounts.bottom;
-			dimensions = this->calculateHorizontalZoneDimensions(LEDCount);
-			break;
-
-		case ZoneSide::LEFT:
-			borderColor = greenColor;
-			LEDCount = this->m_LEDCounts.left;
-			dimensions = this->calculateVerticalZoneDimensions(LEDCount);
-			break;
+	this->updateZoneDimension();
+}
 
-		case ZoneSide::RIGHT:
-			borderColor = yellowColor;
-			LEDCount = this->m_LEDCounts.right;
-			dimensions = this->calculateVerticalZoneDimensions(LEDCount);
-			break;
+// The default flow (start right bottom, counter clockwise) is the flow the led-strip always had: right side up, top to the left, left side down, bottom to the right.
+static_assert(generateLedOrder<4>(LEDCounts{ 1, 1, 1, 1 }, StripCorner::BOTTOM_RIGHT, StripDirection::COUNTER_CLOCKWISE) == std::array<ZoneSlot, 4>{
+	ZoneSlot{ ZoneSide::RIGHT, 0 }, ZoneSlot{ ZoneSide::TOP, 0 }, ZoneSlot{ ZoneSide::LEFT, 0 }, ZoneSlot{ ZoneSide::BOTTOM, 0 }
+});
 
-		default:
-			std::cout << "Error: a unknown ZoneSide is given while calculating the zone dimensions." << std::endl;
-			continue;
-		}
+/// <summary>
+/// Generates the zone table based on m_LEDCounts, in the order of the leds on the strip (STRIP_START_CORNER and STRIP_DIRECTION).
+/// The zones are not laid out yet.
+/// </summary>
+/// <returns>The zone table with a zone per led.</returns>
+ZoneTable ZoneManager::generateZones() const {
+	LOG_VERBOSE("Generating zones...");
+	ZoneTable zoneTable;
+
+	if (m_LEDCounts == Config::LED_COUNTS) {
+		// Generated at compile time
+		zoneTable.assign(Config::LED_ORDER.begin(), Config::LED_ORDER.end());
+	}
+	else {
+		std::vector<ZoneSlot> ledOrder;
+		ledOrder.reserve(m_LEDCounts.all());
+		generateLedOrder(m_LEDCounts, Config::STRIP_START_CORNER, Config::STRIP_DIRECTION, std::back_inserter(ledOrder));
+		zoneTable.assign(ledOrder.begin(), ledOrder.end());
+	}
 
-		// Create zones
-		std::vector<Zone> zones;
-		for (int i = 0; i < LEDCount; i++) {
-			
-			// Calculate origin point
-			cv::Point originPoint;
-			switch (side) {
-			case ZoneSide::TOP:
-				originPoint = cv::Point(dimensions.width * i, 0);
-				break;
-
-			case ZoneSide::BOTTOM:
-				originPoint = cv::Point(dimensions.width * i, m_frameDimensions.height - dimensions.height);
-				break;
-
-			case ZoneSide::LEFT:
-				originPoint = cv::Point(0, dimensions.height * i);
-				break;
-
-			case ZoneSide::RIGHT:
-				originPoint = cv::Point(m_frameDimensions.width - dimensions.width, dimensions.height * i);
-				break;
-				
-			default:
-				std::cout << "Error: a unknown ZoneSide is given while calculating the zone origin point." << std::endl;
-				continue;
-			}
-
-			// Create zone and add to array
-			Zone zone(dimensions, originPoint, borderColor);
-			zones.push_back(zone);
-		}
+	return zoneTable;
+}
 
-		// Add generated zones of a side to the zoneMap
-		zoneMap.insert({ side, zones });
+/// <summary>
+/// The color of the border of the zones on a side, used to draw the zones.
+/// </summary>
+static cv::Scalar getBorderColor(ZoneSide side) {
+	switch (side) {
+	case ZoneSide::TOP: return cv::Scalar(0, 0, 255); // Red
+	case ZoneSide::BOTTOM: return cv::Scalar(255, 0, 0); // Blue
+	case ZoneSide::LEFT: return cv::Scalar(0, 255, 0); // Green
+	case ZoneSide::RIGHT: return cv::Scalar(0, 255, 255); // Yellow
 	}
-
-	return zoneMap;
+	return cv::Scalar(0, 0, 255);
 }
 
 /// <summary>
-/// Runs the draw method on all zones.
+/// Draws a rectangle of the area of every zone on the given frame.
+/// This gives you a visual representation of the zones. 
+/// Could be used for debugging.
 /// </summary>
 /// <param name="frame">Frame drawn on</param>
 /// <param name="includeAverageColor">If set to true it will fill the rectangle with the last calculated average color of the zone</param>
@@ -116,115 +74,313 @@ void ZoneManager::draw(const cv::Mat& frame, bool includeAverageColor) {
 	if (!m_frameDimensions.equals(frame)) {
 		m_frameDimensions.width = frame.cols;
 		m_frameDimensions.height = frame.rows;
+		m_contentRect = cv::Rect(0, 0, frame.cols, frame.rows);
 
 		this->updateZoneDimension();
 	}
 
-	for (const auto& [side, zones] : this->m_zones) {
-		for (const Zone& zone : zones) {
-			zone.draw(frame, includeAverageColor);
+	drawZones(frame, m_zones, includeAverageColor);
+}
+
+/// <summary>
+/// Draws a rectangle of the area of every zone of the table on the given image, used by ZoneManager::draw and the PreviewService.
+/// </summary>
+/// <param name="image">Image drawn on (BGR)</param>
+/// <param name="zones">The zones, with the rects of the full frame</param>
+/// <param name="includeAverageColor">If set to true it will fill the rectangle with the last calculated average color of the zone</param>
+/// <param name="scale">Size of the image compared to the frame, for drawing on a downscaled copy</param>
+void drawZones(const cv::Mat& image, const ZoneTable& zones, bool includeAverageColor, double scale) {
+	const int borderBrushThickness = std::max(1, (int)std::lround(3 * scale));
+	for (size_t i = 0; i < zones.size(); i++) {
+		const cv::Rect& zoneRect = zones.rects[i];
+		const cv::Rect rect(
+			(int)std::lround(zoneRect.x * scale), (int)std::lround(zoneRect.y * scale),
+			(int)std::lround(zoneRect.width * scale), (int)std::lround(zoneRect.height * scale)
+		);
+
+		// Average color
+		if (includeAverageColor) {
+			const cv::Vec3b& color = zones.colors[i];
+			cv::rectangle(image, rect, cv::Scalar(color[0], color[1], color[2]), -1); // <- -1 == fill rectangle
 		}
+
+		// Border
+		cv::rectangle(image, rect, getBorderColor(zones.slots[i].side), borderBrushThickness);
 	}
 }
 
 /// <summary>
-/// Runs the calculateAverage method on all zones.
+/// Calculates the average color of all zones in one sweep over the frame
+/// and puts it in the colors of the zone table.
+/// With change detection on, the zones that didn't change keep their last calculated average color.
 /// </summary>
-/// <param name="frame">Frame to calculate averages on</param>
-void ZoneManager::calculateAverages(const cv::Mat& frame) {
-	if (!m_frameDimensions.equals(frame)) {
-		m_frameDimensions.width = frame.cols;
-		m_frameDimensions.height = frame.rows;
+/// <param name="frame">Frame to calculate averages on (BGR, YUYV or NV12)</param>
+void ZoneManager::calculateAverages(const Frame& frame) {
+	Dimensions frameDimensions = frame.getDimensions();
+	if (!(m_frameDimensions == frameDimensions)) {
+		m_frameDimensions = frameDimensions;
+		m_contentRect = cv::Rect(0, 0, frameDimensions.width, frameDimensions.height);
 
 		this->updateZoneDimension();
 	}
 
-	for (auto& [side, zones] : this->m_zones) {
-		for (Zone& zone : zones) {
-			zone.calculateAverage(frame);
-		}
+	// A replayed frame brings the content rect it was recorded with
+	if (!frame.contentRect.empty()) this->setContentRect(frame.contentRect);
+
+	if (m_changeDetection) {
+		m_geometry->changeDetector.detect(frame.image, frame.format, m_dirtyZones);
+		this->reduce(frame, &m_dirtyZones);
+
+		size_t dirtyZoneCount = std::count(m_dirtyZones.begin(), m_dirtyZones.end(), 1);
+		m_calculatedZoneCount += dirtyZoneCount;
+		m_skippedZoneCount += m_dirtyZones.size() - dirtyZoneCount;
+	}
+	else {
+		this->reduce(frame, nullptr);
+		m_calculatedZoneCount += m_zones.size();
 	}
 }
 
-void ZoneManager::updateZoneDimension() {
-	std::cout << "Updating zones dimensions..." << std::endl;
+/// <summary>
+/// Calculates the colors of the (dirty) zones with the reducer of the color mode and sampling kernel.
+/// </summary>
+void ZoneManager::reduce(const Frame& frame, const std::vector<uint8_t>* dirtyZones) {
+	if (m_colorMode == ZoneColorMode::DOMINANT) {
+		m_geometry->dominantColorReducer.setToneMapper(m_toneMapper);
+		m_geometry->dominantColorReducer.reduce(frame.image, m_zones.colors, frame.format, dirtyZones);
+	}
+	else if (m_samplingKernel.isFlat()) {
+		m_geometry->borderReducer.setToneMapper(m_toneMapper);
+		m_geometry->borderReducer.reduce(frame.image, m_zones.colors, frame.format, dirtyZones);
+	}
+	else {
+		m_geometry->weightedReducer.setToneMapper(m_toneMapper);
+		m_geometry->weightedReducer.reduce(frame.image, m_zones.colors, frame.format, dirtyZones);
+	}
+}
 
-	for (auto& [side, zones] : this->m_zones) {
-		// Calculate dimensions based on ZoneSide
-		Dimensions dimensions;
-		switch (side) {
-		case ZoneSide::TOP:
-			dimensions = this->calculateHorizontalZoneDimensions(
-				this->m_LEDCounts.top
-			);
-			break;
+/// <summary>
+/// Calculates the average color of all zones of a BGR frame.
+/// </summary>
+/// <param name="frame">BGR frame to calculate averages on</param>
+void ZoneManager::calculateAverages(const cv::Mat& frame) {
+	this->calculateAverages(Frame{ .image = frame, .format = PixelFormat::BGR });
+}
 
-		case ZoneSide::BOTTOM:
-			dimensions = this->calculateHorizontalZoneDimensions(
-				this->m_LEDCounts.bottom
-			);
-			break;
+/// <summary>
+/// Lays out the zones along the edges of the given content rect (the frame without black bars).
+/// Doesn't allocate when the layout of the rect is in the geometry cache, so it can be called from the analysis loop.
+/// The rect is reset to the whole frame when the frame dimensions change.
+/// </summary>
+/// <param name="contentRect">The content rect, gets clipped to the frame</param>
+void ZoneManager::setContentRect(const cv::Rect& contentRect) {
+	cv::Rect clippedRect = contentRect & cv::Rect(0, 0, m_frameDimensions.width, m_frameDimensions.height);
+	if (clippedRect.empty() || clippedRect == m_contentRect) return;
 
-		case ZoneSide::LEFT:
-			dimensions = this->calculateVerticalZoneDimensions(
-				this->m_LEDCounts.left
-			);
-			break;
+	m_contentRect = clippedRect;
+	this->updateZoneDimension();
+}
 
-		case ZoneSide::RIGHT:
-			dimensions = this->calculateVerticalZoneDimensions(
-				this->m_LEDCounts.right
-			);
-			break;
+/// <summary>
+/// The part of the frame the zones of the given side sample (with a weight), used to record only the border strips.
+/// </summary>
+/// <returns>The bounding rect of the zones on the side, empty when the side has no zones</returns>
+cv::Rect ZoneManager::getSampledRect(ZoneSide side) const {
+	const bool weighted = (m_colorMode == ZoneColorMode::AVERAGE && !m_samplingKernel.isFlat());
+	const std::vector<cv::Rect>& rects = weighted ? m_geometry->weightTable.getBoundingRects() : m_zones.rects;
+
+	cv::Rect sampledRect;
+	for (size_t i = 0; i < m_zones.size() && i < rects.size(); i++) {
+		if (m_zones.slots[i].side != side || rects[i].empty()) continue;
+		sampledRect = sampledRect.empty() ? rects[i] : (sampledRect | rects[i]);
+	}
 
-		default:
-			std::cout << "Error: a unknown ZoneSide is given while updating the zone dimensions." << std::endl;
-			continue;
-		}
+	return sampledRect & cv::Rect(0, 0, m_frameDimensions.width, m_frameDimensions.height);
+}
 
+/// <summary>
+/// Changes how the pixels of the zones are weighted, the layouts are build again right away.
+/// </summary>
+void ZoneManager::setSamplingKernel(const SamplingKernel& samplingKernel) {
+	m_samplingKernel = samplingKernel;
+
+	// Every layout in the cache is build for the old kernel
+	m_geometry = nullptr;
+	m_geometryCache.clear();
+	this->precomputeGeometry(m_precomputedDimensions);
+	this->updateZoneDimension();
+}
 
-		// Double check! A assert can never hurt
-		assert(dimensions.width > 0 || dimensions.height > 0);
-		
-		// Update the zone dimensions
-		for (Zone& zone : zones) {
-			zone.setDimensions(dimensions);
-		}
+/// <summary>
+/// Changes how the colors of the zones of a 16 bit frame are mapped to the leds.
+/// Every zone gets its new color on the next frame, also the zones that didn't change.
+/// </summary>
+void ZoneManager::setToneMapping(const ToneMappingSettings& toneMapping) {
+	m_toneMapper = ToneMapper(toneMapping);
+	m_geometry->changeDetector.invalidate();
+}
+
+/// <summary>
+/// Changes how the color of a zone is calculated (its average or its dominant color), the layouts are build again right away.
+/// </summary>
+void ZoneManager::setColorMode(ZoneColorMode colorMode) {
+	if (colorMode == m_colorMode) return;
+
+	m_colorMode = colorMode;
+
+	// Every layout in the cache only has the reducers of the old mode
+	m_geometry = nullptr;
+	m_geometryCache.clear();
+	this->precomputeGeometry(m_precomputedDimensions);
+	this->updateZoneDimension();
+}
+
+/// <summary>
+/// Samples only every rowStride rows of the zones (1 samples every row).
+/// A cheaper but rougher average, used by the QualityGovernor when the analysis is too slow. Switching back and forth is a cache hit.
+/// </summary>
+void ZoneManager::setRowStride(int rowStride) {
+	rowStride = std::max(rowStride, 1);
+	if (rowStride == m_rowStride) return;
+
+	m_rowStride = rowStride;
+	this->updateZoneDimension();
+}
+
+/// <summary>
+/// Builds the layouts of the given input resolutions (the whole frame as content, every row sampled) ahead of time,
+/// so the first frame after switching to one of them isn't stalled by building its reducers.
+/// </summary>
+/// <param name="frameDimensions">The resolutions the capture card is expected to switch between</param>
+void ZoneManager::precomputeGeometry(const std::vector<Dimensions>& frameDimensions) {
+	m_precomputedDimensions = frameDimensions;
+
+	// Leave room for the layouts of the black bars
+	const size_t count = std::min(frameDimensions.size(), m_geometryCache.getCapacity() / 2);
+	for (size_t i = 0; i < count; i++) {
+		const Dimensions& dimensions = frameDimensions[i];
+		this->getGeometry({ dimensions, cv::Rect(0, 0, dimensions.width, dimensions.height), 1 });
 	}
+
+	// The layout in use is the most recently used one again
+	if (m_geometry) m_geometryCache.find(m_geometry->key);
+}
+
+/// <summary>
+/// Switches to the layout of the current frame dimensions, content rect and row stride, it is only build when it isn't in the cache.
+/// </summary>
+void ZoneManager::updateZoneDimension() {
+	m_geometry = &this->getGeometry({ m_frameDimensions, m_contentRect, m_rowStride });
+
+	m_zones.rects = m_geometry->rects; // <- Same size, doesn't allocate
+	m_geometry->changeDetector.invalidate(); // <- Its previous samples are of the last time this layout was used
 }
 
 /// <summary>
-/// Calculates the dimensions of a zone based on the frame dimensions and given LEDCount.
-/// Should be used to calculate the zone dimensions of the right and left side.
+/// The layout of the given key, from the cache or build.
 /// </summary>
-/// <param name="LEDCount"></param>
-/// <returns></returns>
-Dimensions ZoneManager::calculateVerticalZoneDimensions(int LEDCount) const {
-	int frameWidth = m_frameDimensions.width;
-	int frameHeight = m_frameDimensions.height;
+ZoneGeometry& ZoneManager::getGeometry(const ZoneGeometryKey& key) {
+	ZoneGeometry* geometry = m_geometryCache.find(key);
+	if (geometry) return *geometry;
 
-	Dimensions zoneDimensions = {
-		.width = (int)std::ceil(frameWidth * Config::ZONE_THICKNES_TO_SCREEN_RATIO),
-		.height = (int)std::ceil(frameHeight / LEDCount)
-	};
+	LOG_VERBOSE("Laying out zones for " << key.frameDimensions.width << "x" << key.frameDimensions.height << " (content " << key.contentRect.width << "x"
+		<< key.contentRect.height << " at (" << key.contentRect.x << ", " << key.contentRect.y << "), row stride " << key.rowStride << ")...");
+
+	ZoneGeometry& newGeometry = m_geometryCache.add(key);
+	this->buildGeometry(newGeometry);
+	return newGeometry;
+}
+
+/// <summary>
+/// Lays out the zones of the key of the geometry and builds the dominant color reducer (dominant color mode),
+/// the border reducer (flat kernel) or the weight table and weighted reducer.
+/// The change detector samples every pixel that has a weight, so a change in a overlapping part also marks the zone.
+/// </summary>
+void ZoneManager::buildGeometry(ZoneGeometry& geometry) const {
+	const ZoneGeometryKey& key = geometry.key;
+	this->layoutZones(key.contentRect, key.frameDimensions, geometry.rects);
+
+	geometry.changeDetector.setThreshold(Config::CHANGE_DETECTION_THRESHOLD);
+	geometry.changeDetector.setRefreshInterval(Config::CHANGE_DETECTION_REFRESH_FRAMES);
+
+	if (m_colorMode == ZoneColorMode::DOMINANT) {
+		geometry.dominantColorReducer.setSaturationWeight(Config::DOMINANT_COLOR_SATURATION_WEIGHT);
+		geometry.dominantColorReducer.setMinShare(Config::DOMINANT_COLOR_MIN_SHARE);
+		geometry.dominantColorReducer.build(geometry.rects, key.frameDimensions, Config::DOMINANT_COLOR_SAMPLE_STEP, key.rowStride);
+		geometry.changeDetector.build(geometry.rects, key.frameDimensions);
+	}
+	else if (m_samplingKernel.isFlat()) {
+		geometry.borderReducer.build(geometry.rects, key.frameDimensions, key.rowStride);
+		geometry.changeDetector.build(geometry.rects, key.frameDimensions);
+	}
+	else {
+		ZoneTable zones = m_zones;
+		zones.rects = geometry.rects;
+		geometry.weightTable.build(zones, key.contentRect, key.frameDimensions, m_samplingKernel, key.rowStride);
+		geometry.weightedReducer.build(geometry.weightTable);
+		geometry.changeDetector.build(geometry.weightTable.getBoundingRects(), key.frameDimensions);
+	}
+}
 
-	return zoneDimensions;
+/// <summary>
+/// The amount of leds (zones) on the given side.
+/// </summary>
+int ZoneManager::getSideLEDCount(ZoneSide side) const {
+	switch (side) {
+	case ZoneSide::TOP: return m_LEDCounts.top;
+	case ZoneSide::BOTTOM: return m_LEDCounts.bottom;
+	case ZoneSide::LEFT: return m_LEDCounts.left;
+	case ZoneSide::RIGHT: return m_LEDCounts.right;
+	}
+	return 0;
 }
 
 /// <summary>
-/// Calculates the dimensions of a zone based on the frame dimensions and given LEDCount.
-/// Should be used to calculate the zone dimensions of the top and bottom side.
+/// Calculates the rect of every zone, along the edges of the content rect.
+///
+/// The thicknes of the top and bottom zones is ZONE_THICKNES_TO_SCREEN_RATIO of the content height, of the left and right zones of the content width.
+/// The length of a side is split over its zones with the edges rounded down (zone i starts at i * length / LEDCount),
+/// so the zones of a side cover it exactly: no gap at the end and no zone past the content rect, they differ at most a pixel in length.
 /// </summary>
-/// <param name="LEDCount"></param>
-/// <returns></returns>
-Dimensions ZoneManager::calculateHorizontalZoneDimensions(int LEDCount) const {
-	int frameWidth = m_frameDimensions.width;
-	int frameHeight = m_frameDimensions.height;
+/// <param name="contentRect">The content rect, inside the frame</param>
+/// <param name="frameDimensions">The frame, the rects are checked against it</param>
+/// <param name="rects">Gets a rect per zone of the zone table</param>
+void ZoneManager::layoutZones(const cv::Rect& contentRect, Dimensions frameDimensions, std::vector<cv::Rect>& rects) const {
+	const cv::Rect& content = contentRect;
+	const int horizontalThicknes = std::min(content.height, (int)std::ceil(content.height * Config::ZONE_THICKNES_TO_SCREEN_RATIO));
+	const int verticalThicknes = std::min(content.width, (int)std::ceil(content.width * Config::ZONE_THICKNES_TO_SCREEN_RATIO));
+
+	rects.resize(m_zones.size());
+	for (size_t i = 0; i < m_zones.size(); i++) {
+		const ZoneSlot& slot = m_zones.slots[i];
+		const int64_t LEDCount = this->getSideLEDCount(slot.side);
+
+		switch (slot.side) {
+		case ZoneSide::TOP:
+		case ZoneSide::BOTTOM: {
+			const int x0 = (int)(slot.index * (int64_t)content.width / LEDCount);
+			const int x1 = (int)((slot.index + 1) * (int64_t)content.width / LEDCount);
+			const int y = (slot.side == ZoneSide::TOP) ? content.y : content.y + content.height - horizontalThicknes;
+			rects[i] = cv::Rect(content.x + x0, y, x1 - x0, horizontalThicknes);
+			break;
+		}
+		case ZoneSide::LEFT:
+		case ZoneSide::RIGHT: {
+			const int y0 = (int)(slot.index * (int64_t)content.height / LEDCount);
+			const int y1 = (int)((slot.index + 1) * (int64_t)content.height / LEDCount);
+			const int x = (slot.side == ZoneSide::LEFT) ? content.x : content.x + content.width - verticalThicknes;
+			rects[i] = cv::Rect(x, content.y + y0, verticalThicknes, y1 - y0);
+			break;
+		}
+		}
+	}
 
-	Dimensions zoneDimensions = {
-		.width = (int)std::ceil(frameWidth / LEDCount),
-		.height = (int)std::ceil(frameWidth * Config::ZONE_THICKNES_TO_SCREEN_RATIO)
-	};
+	// Double check! A zone outside of the frame would read past the image
+	const cv::Rect frameRect(0, 0, frameDimensions.width, frameDimensions.height);
+	for (cv::Rect& rect : rects) {
+		if ((rect & frameRect) == rect) continue;
 
-	return zoneDimensions;
+		LOG_ERROR("A zone (" << rect.x << ", " << rect.y << ", " << rect.width << "x" << rect.height << ") is outside of the frame, it is clipped.");
+		rect = rect & frameRect;
+	}
 }
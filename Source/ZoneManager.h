@@ -1,22 +1,27 @@
 #pragma once
-#include <map>
+#include <vector>
+#include <cstdint>
 
 #include <opencv2/core.hpp>
 
-#include "Zone.h"
+#include "ZoneTable.h"
 #include "LEDCounts.h"
-
-enum class ZoneSide {
-	TOP,
-	BOTTOM,
-	LEFT,
-	RIGHT
-};
+#include "WeightTable.h"
+#include "ZoneGeometryCache.h"
+#include "Frame.h"
 
 /// <summary>
 /// This class generates and manages a set of zones.
-/// The zones are generated based on the given frameDimensions and LEDCounts.
+/// The zones are generated based on the given frameDimensions and LEDCounts, in a flat table in the order of the leds on the strip.
 /// When the sizes of a given frame changes the zones will also change size.
+/// The zones are laid out along the edges of the content rect, which is the whole frame unless black bars are detected.
+/// The averages of all zones are calculated in one sweep by a BorderReducer,
+/// or with a WeightedReducer when the SamplingKernel weights the pixels (soft and overlapping zones).
+/// With change detection on, only the zones the ChangeDetector marks as changed are averaged.
+/// In ZoneColorMode::DOMINANT the zones get their most common color from a DominantColorReducer instead of the average (the sampling kernel is not used).
+/// The colors of the zones of a 16 bit (HDR) frame are tone mapped with the ToneMapper of the zone manager.
+/// The layouts (the zone rects and the reducers build from them) are kept in a ZoneGeometryCache, keyed by the frame dimensions,
+/// content rect and row stride, so switching back to a layout that was used before only swaps a pointer.
 /// </summary>
 class ZoneManager
 {
@@ -25,26 +30,66 @@ public:
 	ZoneManager(LEDCounts LEDCounts, Dimensions frameDimensions = Dimensions(0,0));
 
 	// Methods
+	void calculateAverages(const Frame& frame);
 	void calculateAverages(const cv::Mat& frame);
 	void draw(const cv::Mat& frame, bool includeAverageColor = true);
+	void setContentRect(const cv::Rect& contentRect);
+	void precomputeGeometry(const std::vector<Dimensions>& frameDimensions);
 
 	// Getters & setters
-	const std::map<ZoneSide, std::vector<Zone>>& getZones() { return m_zones; }
-	const std::vector<Zone>& getZonesBySide(ZoneSide side) { return m_zones[side]; }
+	const ZoneTable& getZoneTable() const { return m_zones; }
+
+	const LEDCounts& getLEDCounts() const { return m_LEDCounts; }
 
 	int getFrameWidth() const { return m_frameDimensions.width; }
 	int getFrameHeight() const { return m_frameDimensions.height; }
+	const cv::Rect& getContentRect() const { return m_contentRect; }
+	cv::Rect getSampledRect(ZoneSide side) const;
+
+	const SamplingKernel& getSamplingKernel() const { return m_samplingKernel; }
+	void setSamplingKernel(const SamplingKernel& samplingKernel);
+	int getRowStride() const { return m_rowStride; }
+	void setRowStride(int rowStride);
+	ZoneColorMode getColorMode() const { return m_colorMode; }
+	void setColorMode(ZoneColorMode colorMode);
+	const ToneMappingSettings& getToneMapping() const { return m_toneMapper.getSettings(); }
+	void setToneMapping(const ToneMappingSettings& toneMapping);
+
+	void setChangeDetection(bool enabled) { m_changeDetection = enabled; m_geometry->changeDetector.invalidate(); }
+	uint64_t getSkippedZoneCount() const { return m_skippedZoneCount; }
+	uint64_t getCalculatedZoneCount() const { return m_calculatedZoneCount; }
 
 private:
 	// Methods
-	std::map<ZoneSide, std::vector<Zone>> generateZones() const;
+	ZoneTable generateZones() const;
 	void updateZoneDimension();
-	Dimensions calculateVerticalZoneDimensions(int LEDCount) const;
-	Dimensions calculateHorizontalZoneDimensions (int LEDCount) const;
+	ZoneGeometry& getGeometry(const ZoneGeometryKey& key);
+	void buildGeometry(ZoneGeometry& geometry) const;
+	void layoutZones(const cv::Rect& contentRect, Dimensions frameDimensions, std::vector<cv::Rect>& rects) const;
+	void reduce(const Frame& frame, const std::vector<uint8_t>* dirtyZones);
+	int getSideLEDCount(ZoneSide side) const;
 
 	// Members
 	Dimensions m_frameDimensions;
 	LEDCounts m_LEDCounts;
+	cv::Rect m_contentRect; // <- The part of the frame without black bars
+
+	ZoneTable m_zones;
+
+	SamplingKernel m_samplingKernel;
+	ZoneColorMode m_colorMode;
+	ToneMapper m_toneMapper; // <- Given to the reducer on every reduce, so a moved zone manager doesn't leave it pointing to the old one
+	int m_rowStride = 1; // <- Only every this many rows are sampled
+
+	ZoneGeometryCache m_geometryCache;
+	ZoneGeometry* m_geometry = nullptr; // <- The layout in use, its reducers write the averages straight into m_zones.colors
+	std::vector<Dimensions> m_precomputedDimensions; // <- Build again when the cache is cleared
+
+	bool m_changeDetection;
+	std::vector<uint8_t> m_dirtyZones; // <- Output of the change detector of m_geometry, same order as m_zones
+
+	uint64_t m_skippedZoneCount = 0; // <- Zones that kept their average because they didn't change
+	uint64_t m_calculatedZoneCount = 0;
+};
 
-	std::map<ZoneSide, std::vector<Zone>> m_zones;
-};
\ No newline at end of file
+void drawZones(const cv::Mat& image, const ZoneTable& zones, bool includeAverageColor, double scale = 1.0);
@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstddef>
+
+#include <opencv2/core.hpp>
+
+#include "LEDCounts.h"
+
+enum class ZoneSide {
+	TOP,
+	BOTTOM,
+	LEFT,
+	RIGHT
+};
+
+/// <summary>
+/// The corner of the screen (looking in front of it) where the led-strip starts.
+/// </summary>
+enum class StripCorner {
+	TOP_LEFT,
+	TOP_RIGHT,
+	BOTTOM_LEFT,
+	BOTTOM_RIGHT
+};
+
+/// <summary>
+/// The direction the led-strip runs around the screen (looking in front of it).
+/// </summary>
+enum class StripDirection {
+	CLOCKWISE,
+	COUNTER_CLOCKWISE
+};
+
+/// <summary>
+/// The place of a zone: its side and its index on that side.
+/// The index goes from left to right on the top and bottom side, and from top to bottom on the left and right side.
+/// </summary>
+struct ZoneSlot {
+	ZoneSide side;
+	int index;
+
+	constexpr bool operator==(const ZoneSlot&) const = default;
+};
+
+/// <summary>
+/// Writes the slot of every led, in the order of the strip, to out.
+///
+/// Going clockwise the sides are TOP (left to right), RIGHT (top to bottom), BOTTOM (right to left), LEFT (bottom to top).
+/// Going counter clockwise they are LEFT (top to bottom), BOTTOM (left to right), RIGHT (bottom to top), TOP (right to left).
+/// The start corner picks the side the strip starts on.
+/// </summary>
+template<typename OutputIterator>
+constexpr void generateLedOrder(const LEDCounts& LEDCounts, StripCorner startCorner, StripDirection direction, OutputIterator out) {
+	struct SideRun {
+		ZoneSide side;
+		unsigned int count;
+		bool reverse;
+	};
+
+	const bool clockwise = (direction == StripDirection::CLOCKWISE);
+	const SideRun runs[4] = {
+		clockwise ? SideRun{ ZoneSide::TOP, LEDCounts.top, false } : SideRun{ ZoneSide::LEFT, LEDCounts.left, false },
+		clockwise ? SideRun{ ZoneSide::RIGHT, LEDCounts.right, false } : SideRun{ ZoneSide::BOTTOM, LEDCounts.bottom, false },
+		clockwise ? SideRun{ ZoneSide::BOTTOM, LEDCounts.bottom, true } : SideRun{ ZoneSide::RIGHT, LEDCounts.right, true },
+		clockwise ? SideRun{ ZoneSide::LEFT, LEDCounts.left, true } : SideRun{ ZoneSide::TOP, LEDCounts.top, true }
+	};
+
+	// Index of the run that starts in the start corner
+	int firstRun = 0;
+	switch (startCorner) {
+	case StripCorner::TOP_LEFT: firstRun = 0; break;
+	case StripCorner::TOP_RIGHT: firstRun = (clockwise ? 1 : 3); break;
+	case StripCorner::BOTTOM_RIGHT: firstRun = 2; break;
+	case StripCorner::BOTTOM_LEFT: firstRun = (clockwise ? 3 : 1); break;
+	}
+
+	for (int r = 0; r < 4; r++) {
+		const SideRun& run = runs[(firstRun + r) % 4];
+		for (unsigned int i = 0; i < run.count; i++) {
+			*out++ = ZoneSlot{ run.side, (int)(run.reverse ? run.count - 1 - i : i) };
+		}
+	}
+}
+
+/// <summary>
+/// The led order as a array, for when the led counts are known at compile time.
+/// </summary>
+template<size_t LED_COUNT>
+constexpr std::array<ZoneSlot, LED_COUNT> generateLedOrder(const LEDCounts& LEDCounts, StripCorner startCorner, StripDirection direction) {
+	std::array<ZoneSlot, LED_COUNT> order{};
+	generateLedOrder(LEDCounts, startCorner, direction, order.begin());
+	return order;
+}
+
+/// <summary>
+/// All zones in one flat table (structure of arrays), in the order of the leds on the strip.
+/// So zone i belongs to led i and the colors can be copied to the strip as they are.
+/// </summary>
+struct ZoneTable {
+	std::vector<ZoneSlot> slots;
+	std::vector<cv::Rect> rects;
+	std::vector<cv::Vec3b> colors; // <- The last calculated average color (BGR)
+
+	size_t size() const { return slots.size(); }
+
+	/// <summary>
+	/// Fills the slots in the given order, the rects are empty and the colors black till the zones are laid out.
+	/// </summary>
+	template<typename Iterator>
+	void assign(Iterator begin, Iterator end) {
+		slots.assign(begin, end);
+		rects.assign(slots.size(), cv::Rect());
+		colors.assign(slots.size(), cv::Vec3b(0, 0, 0));
+	}
+};
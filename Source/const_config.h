@@ -1,9 +1,24 @@
 #pragma once
 
+#ifdef WITH_WS2811
 #include "ws2811.h"
+#endif
 
 #include "LEDCounts.h"
-#include "ZoneManager.h"
+#include "ZoneTable.h"
+#include "LedSink.h"
+#include "MultiLedSink.h"
+#include "FrameSource.h"
+#include "PixelFormat.h"
+#include "Dimensions.h"
+#include "Logger.h"
+#include "ColorCorrection.h"
+#include "QualityGovernor.h"
+#include "DominantColorReducer.h"
+#include "ToneMapper.h"
+
+#define DEBUG true
+#define DEBUG_WINDOW false
 
 /*
 	Purpose: 
@@ -19,19 +34,272 @@ namespace Config {
 	*/
 	const float ZONE_THICKNES_TO_SCREEN_RATIO = 0.10f;
 
+	/*
+	* How the pixels of a zone are weighted, instead of a hard edged rect where every pixel counts the same:
+	* - ZONE_DEPTH_FALLOFF: sigma of a gaussian falloff toward the centre of the screen, as ratio of the zone thicknes.
+	*   The pixels at the edge of the screen (closest to the led) count the most.
+	* - ZONE_OVERLAP: how far a zone reaches into its neighbours (falling off linearly), as ratio of the zone length.
+	*   Content that crosses the border of 2 zones fades from one led to the other, instead of jumping.
+	* Use 0 for both to get the hard edged zones back.
+	*/
+	const float ZONE_DEPTH_FALLOFF = 0.5f;
+	const float ZONE_OVERLAP = 0.5f;
+
+	/*
+	* What color a zone gets:
+	* - ZoneColorMode::AVERAGE: the average of its pixels, weighted by ZONE_DEPTH_FALLOFF and ZONE_OVERLAP.
+	* - ZoneColorMode::DOMINANT: its most common color, from a coarse histogram (4 bits per channel) of every DOMINANT_COLOR_SAMPLE_STEP-th pixel and row.
+	*   Keeps the colors of a logo, subtitles or a small bright object from mixing into a muddy average. The zones are hard edged.
+	* - DOMINANT_COLOR_SATURATION_WEIGHT: how much more a fully saturated color counts than grey (2 == 3 times as much).
+	* - DOMINANT_COLOR_MIN_SHARE: the dominant color has to be at least this ratio of the samples, otherwise the zone gets its average (gradients and noise).
+	*/
+	const ZoneColorMode ZONE_COLOR_MODE = ZoneColorMode::AVERAGE;
+	const int DOMINANT_COLOR_SAMPLE_STEP = 2;
+	const float DOMINANT_COLOR_SATURATION_WEIGHT = 2.0f;
+	const float DOMINANT_COLOR_MIN_SHARE = 0.1f;
+
+	/*
+	* The zone layouts (with the reducers build from them) of the last ZONE_GEOMETRY_CACHE_SIZE frame dimensions, content rects and row strides are kept,
+	* so switching the HDMI source or black bars coming and going doesn't stall the analysis on building them again.
+	* The layouts of ZONE_GEOMETRY_PRECOMPUTED_DIMENSIONS (the whole frame as content) are build at start-up, at most half of the cache.
+	*/
+	const int ZONE_GEOMETRY_CACHE_SIZE = 8;
+	const Dimensions ZONE_GEOMETRY_PRECOMPUTED_DIMENSIONS[] = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+
 	/*
 	* This is used in the constructor of the VideoCapture object.
 	* With index at 0, it will use the first video device that it can find.
 	*/
 	const int VIDEO_CAPTURE_INDEX = 0;
 
-	const LEDCounts LED_COUNTS = { 
+	/*
+	* Where the frames come from:
+	* - FrameSourceType::OPENCV: cv::VideoCapture with VIDEO_CAPTURE_INDEX, converts every frame to BGR.
+	* - FrameSourceType::V4L2: straight from the V4L2 device at V4L2_DEVICE_PATH, no copies and no color conversion.
+	* - FrameSourceType::RAW_FILE: raw frames from RAW_FILE_PATH, a stand-in for the capture card.
+	* - FrameSourceType::REPLAY: the border strips recorded to REPLAY_FILE_PATH, see BORDER_RECORDING.
+	*/
+#ifdef __linux__
+	const FrameSourceType FRAME_SOURCE_TYPE = FrameSourceType::V4L2;
+#else
+	const FrameSourceType FRAME_SOURCE_TYPE = FrameSourceType::OPENCV;
+#endif
+	const int CAPTURE_TIMEOUT_MS = 1000; // <- A read fails when there is no frame for this long
+
+	/*
+	* Reconnecting the capture card (after unplugging it or switching the HDMI source).
+	* - CAPTURE_READ_RETRIES: failed reads in a row before the frame source is reopened.
+	* - CAPTURE_RECONNECT_MIN_DELAY_MS / MAX_DELAY_MS: the wait between attempts to reopen doubles from min to max.
+	*   A new video device in CAPTURE_DEVICE_DIRECTORY ends the wait right away.
+	*/
+	const int CAPTURE_READ_RETRIES = 2;
+	const int CAPTURE_RECONNECT_MIN_DELAY_MS = 10;
+	const int CAPTURE_RECONNECT_MAX_DELAY_MS = 1000;
+	const char* const CAPTURE_DEVICE_DIRECTORY = "/dev";
+
+	const char* const V4L2_DEVICE_PATH = "/dev/video0";
+	const PixelFormat V4L2_PIXEL_FORMAT = PixelFormat::YUYV; // <- Only requested, the device can pick a other one
+	const int V4L2_BUFFER_COUNT = 8; // <- The pipeline holds up to 3 frames and the PreviewService up to 2, the rest can be filled by the driver
+
+	const char* const RAW_FILE_PATH = "capture.yuyv";
+	const Dimensions RAW_FILE_DIMENSIONS = { 1920, 1080 };
+	const PixelFormat RAW_FILE_PIXEL_FORMAT = PixelFormat::YUYV;
+	const int RAW_FILE_FPS = 60;
+
+	/*
+	* The 10 bit capture formats (PixelFormat::BGR16, Y210 and P010, from a HDMI capture card that passes HDR through).
+	* The zones are reduced on the 10 bits, only the average of every zone is mapped to the leds:
+	* - transferFunction: TransferFunction::PQ for HDR10, TransferFunction::HLG for broadcast HDR,
+	*   TransferFunction::SDR for a normal source that is captured with more bits (gives the same colors as the 8 bit formats).
+	* - peakNits: the brightest the content gets (the mastering peak of HDR10), it gets the full led brightness.
+	* - whiteNits: the white of the content (203 for BT.2408), everything above half of it is rolled off towards the peak.
+	* The 8 bit formats are never tone mapped.
+	*/
+	const ToneMappingSettings TONE_MAPPING = {
+		.transferFunction = TransferFunction::PQ,
+		.peakNits = 1000.0f,
+		.whiteNits = 203.0f
+	};
+
+	const char* const REPLAY_FILE_PATH = "borders.rec";
+	const bool REPLAY_REAL_TIME = true; // <- false plays the frames back as fast as the pipeline takes them
+
+	/*
+	* Records the border strips the zones sample of every analysed frame (with its timestamp and the zone layout) to BORDER_RECORDING_FILE_PATH.
+	* Play it back with FrameSourceType::REPLAY to run the same frames again without a capture card, for regression and performance runs.
+	* Note: a 1080p YUYV frame still takes about 2 MB, so only record short clips (on a fast disk).
+	*/
+	const bool BORDER_RECORDING = false;
+	const char* const BORDER_RECORDING_FILE_PATH = "borders.rec";
+
+	/*
+	* The capture, analysis and render stage each run on their own thread.
+	* Here you can pin a stage to a CPU core (a Pi 4 has core 0 - 3), so the stages don't fight over the same core.
+	* Use -1 to let the OS decide.
+	*/
+	const int CAPTURE_CPU_CORE = 1;
+	const int ANALYSIS_CPU_CORE = 2;
+	const int RENDER_CPU_CORE = 3;
+
+	/*
+	* Real-time mode, for output without stutter while other services (Kodi, SSH, log rotation) run on the Pi. Needs root (or CAP_SYS_NICE and a memlock limit).
+	* - The stages run with SCHED_FIFO at the given priority (1 - 99), before every normal task on their core. The render stage is the highest, its clock is what you see.
+	*   Keep them below the interrupt threads of a PREEMPT_RT kernel (50), and pin the stages to cores above (a busy analysis stage owns its core).
+	* - All memory is locked (mlockall), REAL_TIME_HEAP_PREFAULT_BYTES of heap and REAL_TIME_STACK_PREFAULT_BYTES of the stack of every stage are touched at start-up.
+	* The render jitter (how late the render clock ticks) is measured in both modes, see the metrics and the --jitter benchmark.
+	*/
+	const bool REAL_TIME = false;
+	const int CAPTURE_REAL_TIME_PRIORITY = 40;
+	const int ANALYSIS_REAL_TIME_PRIORITY = 30;
+	const int RENDER_REAL_TIME_PRIORITY = 45;
+	const size_t REAL_TIME_HEAP_PREFAULT_BYTES = 32 * 1024 * 1024;
+	const size_t REAL_TIME_STACK_PREFAULT_BYTES = 256 * 1024;
+
+	/*
+	* The led-strip is rendered on its own clock, not once per captured frame.
+	* Between two captured frames the colors are interpolated, so a 30 fps capture card still gives smooth output.
+	* Use 0 to render once per captured frame.
+	*/
+	const int RENDER_RATE_HZ = 120;
+
+	/*
+	* Time constant of the smoothing on top of the interpolation, it doesn't depend on the render rate.
+	* After this time a change in color is ~63% done. Use 0 to turn the smoothing off.
+	*/
+	const float LED_SMOOTHING_TIME_MS = 30.0f;
+
+	/*
+	* Change detection: a few pixels of every zone are compared with the previous frame,
+	* only the zones that changed get a new average (static content like a paused movie costs almost nothing).
+	* - CHANGE_DETECTION_THRESHOLD: mean difference per sampled value (0 - 255) before a zone counts as changed.
+	* - CHANGE_DETECTION_REFRESH_FRAMES: every this many frames all zones are averaged, for changes the samples missed.
+	*/
+	const bool CHANGE_DETECTION = true;
+	const int CHANGE_DETECTION_THRESHOLD = 2;
+	const int CHANGE_DETECTION_REFRESH_FRAMES = 30;
+
+	/*
+	* Black bar detection (letterbox and pillarbox): the zones are moved to the edges of the picture,
+	* so a 2.39:1 movie doesn't average the black bars.
+	* - LETTERBOX_DETECTION_INTERVAL_FRAMES: the bars are searched every this many frames.
+	* - LETTERBOX_BLACK_LEVEL: brightness (0 - 255) a pixel of a bar can have, Y of black is 16 on most capture cards.
+	* - LETTERBOX_STABLE_DETECTIONS: times in a row the same bars have to be found before the zones are moved.
+	*/
+	const bool LETTERBOX_DETECTION = true;
+	const int LETTERBOX_DETECTION_INTERVAL_FRAMES = 10;
+	const int LETTERBOX_BLACK_LEVEL = 32;
+	const int LETTERBOX_STABLE_DETECTIONS = 3;
+
+	/*
+	* The led-strip is only rendered when a color channel of a led differs more than this from the last render.
+	* Use 0 to render on every change, -1 to always render.
+	*/
+	const int RENDER_CHANGE_THRESHOLD = 0;
+
+	/*
+	* Idle mode, the units run 24/7 and the TV is off most of the time:
+	* - When every zone stays at or below IDLE_BLACK_LEVEL (0 - 255) for IDLE_BLACK_TIME_MS, the frames are not analysed anymore.
+	*   Only every IDLE_PROBE_INTERVAL_MS a few pixels of the newest frame are looked at, the leds are back within that (and a frame) when there is content.
+	* - When no frame comes for IDLE_NO_SIGNAL_TIMEOUT_MS (no signal, the capture card waits for it on its own) the leds don't freeze on the last colors.
+	* In both cases the led-strip fades out in IDLE_FADE_TIME_MS and isn't rendered anymore till there is a new frame.
+	* Note: the fade needs the render clock (RENDER_RATE_HZ above 0).
+	*/
+	const bool IDLE_MODE = true;
+	const int IDLE_BLACK_LEVEL = 32;
+	const int IDLE_BLACK_TIME_MS = 5000;
+	const int IDLE_PROBE_INTERVAL_MS = 80;
+	const int IDLE_NO_SIGNAL_TIMEOUT_MS = 2000;
+	const int IDLE_FADE_TIME_MS = 1500;
+
+	/*
+	* The quality governor holds the analysis latency (captured till analysed) under QUALITY_TARGET_LATENCY_MS when the Pi can't keep up,
+	* by stepping down QUALITY_LEVELS: first fewer rows of the zones are sampled, then fewer frames are analysed (the led-strip keeps interpolating).
+	* It also steps down while the SoC (SOC_TEMPERATURE_PATH) is at QUALITY_MAX_TEMPERATURE_C or above, a Pi 4 throttles at 80 degrees.
+	* It decides every QUALITY_DECISION_INTERVAL_MS and only steps back up after QUALITY_RECOVER_INTERVALS calm intervals in a row.
+	*/
+	const bool QUALITY_GOVERNOR = true;
+	const int QUALITY_TARGET_LATENCY_MS = 20;
+	const float QUALITY_MAX_TEMPERATURE_C = 75.0f;
+	const int QUALITY_DECISION_INTERVAL_MS = 500;
+	const int QUALITY_RECOVER_INTERVALS = 4;
+	const char* const SOC_TEMPERATURE_PATH = "/sys/class/thermal/thermal_zone0/temp";
+	const QualityLevel QUALITY_LEVELS[] = { { 1, 1 }, { 2, 1 }, { 4, 1 }, { 4, 2 }, { 4, 3 } }; // <- Row stride, analysis interval
+
+	/*
+	* Shows the zones on a downscaled copy of a frame (PREVIEW_WIDTH pixels wide) every PREVIEW_INTERVAL_FRAMES analysed frames,
+	* drawn and encoded (JPEG) on a low priority thread so the analysis stage doesn't wait on it.
+	* The previews are appended to PREVIEW_FILE_PATH as a MJPEG stream (started over at PREVIEW_FILE_MAX_BYTES), use "" to not write the file,
+	* and streamed at http://127.0.0.1:PREVIEW_PORT/ (linux only), use 0 to not open the socket.
+	* With DEBUG_WINDOW the preview is also shown in a window ('q' quits).
+	*/
+	const bool PREVIEW = DEBUG;
+	const int PREVIEW_INTERVAL_FRAMES = 15;
+	const int PREVIEW_WIDTH = 640;
+	const int PREVIEW_JPEG_QUALITY = 70;
+	const char* const PREVIEW_FILE_PATH = "";
+	const size_t PREVIEW_FILE_MAX_BYTES = 64 * 1024 * 1024;
+	const int PREVIEW_PORT = 8090;
+
+	/*
+	* The duration of every stage, the frame latency and the counters are written as a Prometheus text file
+	* every METRICS_EXPORT_INTERVAL_MS (for the textfile collector of node_exporter). Use "" to not write the file.
+	* With DEBUG a summary is also printed every interval.
+	*/
+	const char* const METRICS_FILE_PATH = "tv_ambient_lighting.prom";
+	const int METRICS_EXPORT_INTERVAL_MS = 5000;
+
+	/*
+	* Messages below LOG_LEVEL are not logged (LogLevel::VERBOSE, INFO, WARNING or ERROR).
+	* Every place that logs can log at most LOG_RATE_LIMIT_MESSAGES per LOG_RATE_LIMIT_INTERVAL_MS,
+	* the rest is suppressed (and counted), so a message that repeats every frame doesn't flood the log.
+	*/
+	const LogLevel LOG_LEVEL = DEBUG ? LogLevel::VERBOSE : LogLevel::INFO;
+	const int LOG_RATE_LIMIT_MESSAGES = 5;
+	const int LOG_RATE_LIMIT_INTERVAL_MS = 1000;
+
+	constexpr LEDCounts LED_COUNTS = { 
 		.top = 14,
 		.bottom = 14,
 		.left = 9,
 		.right = 10
 	};
 
+	/*
+	* Where the led-strip starts and which way it runs around the screen (looking in front of the screen).
+	* The default flow: 
+	*   v ---------- <
+	*   |            |
+	*   |            | START (Right bottom)
+	*   > ----------
+	*			 END (Right bottom)
+	*/
+	const StripCorner STRIP_START_CORNER = StripCorner::BOTTOM_RIGHT;
+	const StripDirection STRIP_DIRECTION = StripDirection::COUNTER_CLOCKWISE;
+
+	// The zone of every led on the strip, generated at compile time
+	constexpr auto LED_ORDER = generateLedOrder<LED_COUNTS.all()>(LED_COUNTS, STRIP_START_CORNER, STRIP_DIRECTION);
+
+	/*
+	* Where the led colors are rendered to (the channel in LED_CHANNELS):
+	* - LedSinkType::WS2811: the led-strip (needs a build with rpi_ws281x).
+	* - LedSinkType::NONE: nowhere, for measuring the throughput without a led-strip.
+	* - LedSinkType::RECORDING: a file (LED_RECORDING_FILE_PATH) with a timestamp per frame.
+	* - LedSinkType::MOCK: nowhere, but it takes as long as a WS281x strip. For testing LED_SEGMENTS without the hardware.
+	* - LedSinkType::DDP: a led controller on the network (WLED, ESPixelStick, ...) at DDP_HOST, over UDP (linux only).
+	*   Only the changed leds are sent, and every DDP_FULL_FRAME_INTERVAL_MS all leds (for a controller that restarted or lost a packet).
+	*   DDP_RGBW sends 4 bytes per led (with the white of COLOR_CORRECTION.extractWhite) instead of 3. Without it the extracted white is added back to R, G and B.
+	*/
+#ifdef WITH_WS2811
+	const LedSinkType LED_SINK_TYPE = LedSinkType::WS2811;
+#else
+	const LedSinkType LED_SINK_TYPE = LedSinkType::NONE;
+#endif
+	const char* const LED_RECORDING_FILE_PATH = "led_recording.bin";
+	const char* const DDP_HOST = "wled.local";
+	const int DDP_PORT = 4048;
+	const bool DDP_RGBW = false;
+	const int DDP_FULL_FRAME_INTERVAL_MS = 1000;
+
 	/*
 	* Down below is data pased to the library controlling the led-strip.
 	*/
@@ -39,7 +307,46 @@ namespace Config {
 	
 	const uint8_t LED_BRIGHTNESS = 128; // A value of 0 - 255
 	const int DATA_OUT_GPIO_PIN = 18;
+#ifdef WITH_WS2811
 	const uint32_t TARGET_FREQ = WS2811_TARGET_FREQ;
 	const int DMA = 10;
 	const int STRIP_TYPE = WS2811_STRIP_GBR;
+	const bool STRIP_HAS_WHITE = (STRIP_TYPE & SK6812_SHIFT_WMASK) != 0; // <- The SK6812 RGBW types
+#else
+	const bool STRIP_HAS_WHITE = false;
+#endif
+
+	/*
+	* The transfer to a WS281x strip takes 30 us per led, so one long strip limits the render rate (300 leds: 9 ms, about 110 Hz).
+	* The leds (in the order of LED_ORDER) can be split in segments over several channels, which are rendered at the same time:
+	* - LED_CHANNELS: the outputs. A LedSinkType::WS2811 channel needs a PWM GPIO pin: 12 or 18 for the first, 13 or 19 for the second.
+	*   Both WS2811 channels are driven by one DMA transfer.
+	* - LED_SEGMENTS: { channel, first led, led count, reversed }. The segments of a channel are chained in this order,
+	*   reversed is for a strip that runs the other way than LED_ORDER.
+	* Example, 300 leds as 2 strips that both start in the middle of the chain, the first on GPIO 18 and the second on GPIO 13:
+	*   LED_CHANNELS = { { LedSinkType::WS2811, 18 }, { LedSinkType::WS2811, 13 } };
+	*   LED_SEGMENTS = { { 0, 150, 150 }, { 1, 0, 150, true } };
+	* A LedSinkType::DDP channel can be added next to the strip, with its own host (nullptr is DDP_HOST). Example, the same leds on a controller at 192.168.1.50:
+	*   LED_CHANNELS = { { LedSinkType::WS2811, 18 }, { LedSinkType::DDP, 0, "192.168.1.50" } };
+	*   LED_SEGMENTS = { { 0, 0, LED_COUNTS.all() }, { 1, 0, LED_COUNTS.all() } };
+	*/
+	const LedChannel LED_CHANNELS[] = { { LED_SINK_TYPE, DATA_OUT_GPIO_PIN } };
+	const LedSegment LED_SEGMENTS[] = { { 0, 0, LED_COUNTS.all() } };
+
+	/*
+	* The correction of the led colors, folded into a lookup table per channel at startup:
+	* - gamma (Red, Green, Blue): the leds are linear, the screen is not. 2.2 makes the dark colors look like on the screen, 1 turns it off.
+	* - colorTemperature: white point in Kelvin, lower is warmer. 6500 is the neutral white of the screen.
+	* - minimumBrightness: every channel is lifted to at least this (0 - 255), so the leds never go fully dark.
+	* - extractWhite: puts the white part of a color on the white led, for the RGBW (SK6812) strip types.
+	* The brightness of the whole strip is still LED_BRIGHTNESS.
+	*/
+	const ColorCorrectionSettings COLOR_CORRECTION = {
+		.gammaRed = 2.2f,
+		.gammaGreen = 2.2f,
+		.gammaBlue = 2.2f,
+		.colorTemperature = 6500,
+		.minimumBrightness = 0,
+		.extractWhite = STRIP_HAS_WHITE
+	};
 }
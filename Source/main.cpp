@@ -1,129 +1,117 @@
-﻿#include <iostream>
-#include <chrono>
+﻿#include <chrono>
 #include <thread>
 #include <functional>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <iterator>
 #include <signal.h>
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/highgui.hpp>
-#include <opencv2/videoio.hpp>
 #include <opencv2/imgproc.hpp>
 
-#include <ws2811.h>
-
 #include "ZoneManager.h"
 #include "LEDCounts.h"
+#include "Pipeline.h"
+#include "LedSink.h"
+#include "MultiLedSink.h"
+#include "FrameSource.h"
+#include "CaptureConnection.h"
+#include "Metrics.h"
+#include "MetricsExporter.h"
+#include "Frame.h"
+#include "Logger.h"
+#include "RealTime.h"
 #include "const_config.h"
 
-#define DEBUG true
-#define DEBUG_WINDOW false
+std::unique_ptr<LedSink> ledSink;
 
-ws2811_t ledStrip =
-{
-	.freq = Config::TARGET_FREQ,
-	.dmanum = Config::DMA,
-	.channel =
-	{
-		{
-			.gpionum = Config::DATA_OUT_GPIO_PIN,
-			.invert = 0,
-			.count = Config::LED_COUNTS.all(),
-			.strip_type = Config::STRIP_TYPE,
-			.brightness = Config::LED_BRIGHTNESS
-		}
-	}
-};
+std::unique_ptr<FrameSource> frameSource;
 
-cv::VideoCapture vCap(Config::VIDEO_CAPTURE_INDEX, cv::CAP_ANY);
+std::atomic<bool> running = true;
+volatile sig_atomic_t recievedSignal = -1;
 
+void handleSignal(int signal);
 void handleProgramTermination(int signal = -1);
-bool handleCaptureCard(cv::VideoCapture& vCap, cv::Mat& frame);
-bool handleRenderLedStrip(ws2811_t& ledStrip, ZoneManager& zoneManager);
-void setColorsOnLedStrip(ws2811_t& ledStrip, ZoneManager& zoneManager);
-int BGRToWRGBHex(cv::Vec3b color);
 
 int main() {
-	std::cout << "Welcome! TV ambient ligthing (raspberry pi) Creds: Floows" << std::endl;
+	getLogger().setLevel(Config::LOG_LEVEL);
+	getLogger().setRateLimit(Config::LOG_RATE_LIMIT_MESSAGES, Config::LOG_RATE_LIMIT_INTERVAL_MS);
+	getLogger().start();
+
+	LOG_INFO("Welcome! TV ambient ligthing (raspberry pi) Creds: Floows");
 
 	// --- Setup ---
-	cv::Mat frame;
+	Frame frame;
 
-	ws2811_init(&ledStrip);
+	frameSource = createFrameSource(Config::FRAME_SOURCE_TYPE);
+	if (!frameSource) {
+		LOG_ERROR("Can't create the frame source!");
+		return EXIT_FAILURE;
+	}
+	LOG_INFO("Reading frames from frame source: " << frameSource->getName());
+
+	ledSink = createLedOutput(); // <- The channels and segments in the config
+	if (!ledSink || !ledSink->init()) {
+		LOG_ERROR("Can't init the led sink!");
+		return EXIT_FAILURE;
+	}
+	LOG_INFO("Rendering to led sink: " << ledSink->getName());
 
-	signal(SIGINT, handleProgramTermination);
-	signal(SIGTERM, handleProgramTermination);
-	signal(SIGABRT, handleProgramTermination);
-	signal(SIGFPE, handleProgramTermination);
+	signal(SIGINT, handleSignal);
+	signal(SIGTERM, handleSignal);
+	signal(SIGABRT, handleSignal);
+	signal(SIGFPE, handleSignal);
 
 	// --- Start-up (loop) ---
-	std::cout << "Entering start-up loop. Waiting for capture card signal..." << std::endl;
-	while (!handleCaptureCard(vCap, frame)) {
-		std::this_thread::sleep_for(std::chrono::milliseconds(50)); // <- do not overload the thread and CPU unnecessarily
+	LOG_INFO("Entering start-up loop. Waiting for capture card signal...");
+	CaptureConnection captureConnection(*frameSource);
+	while (!captureConnection.read(frame)) { // <- Waits for the capture card, no need to sleep here
+		if (!running) handleProgramTermination(recievedSignal);
 	}
-	std::cout << "Capture card signal recieved!" << std::endl;
+	LOG_INFO("Capture card signal recieved!");
 
 	// Init manager and create zones for calculating the average color
-	ZoneManager zoneManager(Config::LED_COUNTS, Dimensions(frame.cols, frame.rows));
-
-#if DEBUG
-
-#if DEBUG_WINDOW
-	const std::string windowName = "TV ambient lighting (Raspberry pi) - DEBUG";
-	cv::namedWindow(windowName);
-#endif
-	// Used for calculating average loop time
-	uint64_t loopCounter = 0; // Dont worry this will only overflow in about 51 milion years ;)
-	double averageLoopTimeMS = 0.0;
-#endif
-
-	// --- Main loop ---
-	std::cout << "Entering main loop..." << std::endl;
-	bool running = true;
-	while (running) {
-
-#if DEBUG
-		loopCounter++;
-		auto startTime = std::chrono::high_resolution_clock::now();
-#endif
-
-		// Get frame from capture card
-		if (!handleCaptureCard(vCap, frame)) {
-			std::cout << "Can't get frame from capture card, retrying..." << std::endl;
-			std::this_thread::sleep_for(std::chrono::milliseconds(50)); // <- do not overload the thread and CPU unnecessarily
-			continue;
-		}
-
-		// Calculate averages in zones
-		zoneManager.calculateAverages(frame);
+	ZoneManager zoneManager(Config::LED_COUNTS, frame.getDimensions());
+	zoneManager.precomputeGeometry(std::vector<Dimensions>(std::begin(Config::ZONE_GEOMETRY_PRECOMPUTED_DIMENSIONS), std::end(Config::ZONE_GEOMETRY_PRECOMPUTED_DIMENSIONS)));
+	frame.release(); // <- Give the buffer back to the capture card
 
-		// Set calculated colors and render led-strip
-		handleRenderLedStrip(ledStrip, zoneManager);
+	// Everything is allocated now (the frames of the capture card, the zone layouts), lock it in memory before the stages start
+	if (Config::REAL_TIME) lockMemory(Config::REAL_TIME_HEAP_PREFAULT_BYTES);
 
-#if DEBUG
-		// Draw for debugging
-		zoneManager.draw(frame, true);
+	// --- Pipeline ---
+	LOG_INFO("Starting pipeline...");
+	Pipeline pipeline(captureConnection, zoneManager, *ledSink);
+	pipeline.start();
 
-		// Calculate incremental average loop time
-		auto endTime = std::chrono::high_resolution_clock::now();
-		float deltaTimeInMS = std::chrono::duration<float, std::milli>(endTime - startTime).count();
-		averageLoopTimeMS += (deltaTimeInMS - averageLoopTimeMS) / loopCounter;
-		std::cout << "Average loop time: " << averageLoopTimeMS << "MS" << std::endl;
+	MetricsExporter metricsExporter(getMetrics(), Config::METRICS_FILE_PATH, Config::METRICS_EXPORT_INTERVAL_MS);
+	metricsExporter.start();
 
-#if DEBUG_WINDOW
-		cv::imshow(windowName, frame);
-		char pressedKey = cv::waitKey(1); // <- Is needed to handle OpenCV GUI events (like imshow) (I know its stupid, waitKey??)
-		if (pressedKey == 'q' || pressedKey == 'Q') running = false;
-#endif
-#endif
+	// The stages run on their own threads, this one only waits till it's time to stop
+	while (running && pipeline.isRunning()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
 	}
 
-	std::cout << "Out of main loop!" << std::endl;
-	handleProgramTermination();
+	pipeline.stop();
+	metricsExporter.stop();
+	LOG_INFO("Pipeline stopped!");
+	handleProgramTermination(recievedSignal);
 
 	return 0;
 }
 
+/// <summary>
+/// Signal handler, only tells the main thread to stop.
+/// The cleanup is done by the main thread once the pipeline threads are stopped.
+/// </summary>
+/// <param name="signal">The signal that triggerd this handler.</param>
+void handleSignal(int signal) {
+	recievedSignal = signal;
+	running = false;
+}
+
 /// <summary>
 /// This function cleans up some things before exiting the program.
 /// It also "turns-off" the led-strip.
@@ -131,129 +119,19 @@ int main() {
 /// <param name="signal">The signal that triggerd this handler. -1 if its not done by an signal.</param>
 void handleProgramTermination(int signal) {
 	if (signal != -1) {
-		std::cout << "Recieved signal: " << signal << std::endl;
+		LOG_WARNING("Recieved signal: " << signal);
 	}
-	std::cout << "Program terminating..." << std::endl;
+	LOG_INFO("Program terminating...");
 
 	// Video capture
-	std::cout << "Releasing VideoCapture..." << std::endl;
-	vCap.release();
+	LOG_INFO("Releasing FrameSource...");
+	if (frameSource) frameSource->close();
 
 	// Led-strip
-	std::cout << "Releasing and turning off led-strip..." << std::endl;
-	ledStrip.channel[0].brightness = 0; // Easy way to turn off all leds
-	ws2811_render(&ledStrip);
-	ws2811_fini(&ledStrip);
+	LOG_INFO("Releasing and turning off led-strip...");
+	if (ledSink) ledSink->fini();
 
-	std::cout << "Goodbye! Creds: Floows" << std::endl;
+	LOG_INFO("Goodbye! Creds: Floows");
+	getLogger().stop(); // <- Writes the messages that are left
 	exit(EXIT_SUCCESS);
 }
-
-
-/// <summary>
-/// Read a frame from the given vCap and write it to the given frame.
-/// </summary>
-/// <returns>If it could succesfully get a non-empty frame from the vCap</returns>
-bool handleCaptureCard(cv::VideoCapture& vCap, cv::Mat& frame) {
-	// Check vCap
-	// Note: vCap.isOpened() doenst check if the capture card is still connected...
-	if (!vCap.isOpened()) {
-		std::cout << "VideoCapture is not opened... Trying to reopen!" << std::endl;
-		vCap.open(Config::VIDEO_CAPTURE_INDEX, cv::CAP_ANY);
-		return false;
-	}
-
-	// Read frame
-	bool hasReadFrame = vCap.read(frame);
-	if (!hasReadFrame) {
-		std::cout << "Can't read frame... Releasing VideoCapture so it will fully reconnect!" << std::endl;
-		vCap.release(); // <- Release so next cycle it will try to reconnect the vCap.
-		return false;
-	}
-
-	if (frame.empty()) {
-		std::cout << "Frame is empty... Skipping loop cycle!" << std::endl;
-		return false;
-	}
-
-	return true;
-}
-
-/// <summary>
-/// Sets the colors on the LED strip based on the ZoneManager's zones last calculated average's and then renders the changes to the physical strip.
-/// </summary>
-/// <param name="ledStrip">A reference to the ws2811_t ledStrip to be updated and rendered.</param>
-/// <param name="zoneManager">A reference to the ZoneManager.</param>
-bool handleRenderLedStrip(ws2811_t& ledStrip, ZoneManager& zoneManager) {
-	setColorsOnLedStrip(ledStrip, zoneManager);
-
-	ws2811_return_t result = ws2811_render(&ledStrip);
-	if (result != ws2811_return_t::WS2811_SUCCESS) {
-		std::cout << "Can't render led-strip! Error code: " << result << std::endl;
-		return false;
-	}
-
-	return true;
-}
-
-/// <summary>
-/// Sets the colors in the ledStrip.
-/// </summary>
-/// <param name="ledStrip">A reference to the ws2811_t ledStrip.</param>
-/// <param name="zoneManager">A refrence of the zoneManager's.</param>
-void setColorsOnLedStrip(ws2811_t& ledStrip, ZoneManager& zoneManager) {
-	/*
-	* Note: 
-	* due to lack of motivation to finish this project properly
-	* because i have bigger projects i want to work, the flow direction is static...
-	* 
-	* If anyone is reading this and has nothing to do, and wants to implement a way to set your own flow, i would thank you!
-	* I would suggest doing something with the ZoneSide enum in a array as a var like FLOW_DIRECTION in the const_config file.
-	* And then figure out when you need to reverse loop over the zones like i have done with the TOP and RIGHT side down belowe.
-	* 
-	* For now the flow of the LED-strip (looking infront of the screen): 
-	*   v ---------- <
-    *   |            |
-    *   |            | START (Right bottom)
-    *   > ----------
-	*			 END (Right bottom)
-	* 
-	* The order / direction of the zones:
-	*    ---------->
-	*   |            |
-	*   |            | 
-	*   v ---------> v
-	*/
-
-	const ZoneSide flowDirection[] = { ZoneSide::RIGHT, ZoneSide::TOP, ZoneSide::LEFT, ZoneSide::BOTTOM };
-	int ledIndex = 0;
-
-	for (ZoneSide zoneSide : flowDirection) {
-		const std::vector<Zone>& zones = zoneManager.getZonesBySide(zoneSide);
-
-		// If the current ZoneSide is top or right -> loop through zones in reverse
-		bool reverseLoop = (zoneSide == ZoneSide::TOP || zoneSide == ZoneSide::RIGHT);
-		int start = (reverseLoop ? zones.size() - 1 : 0);
-		int end = (reverseLoop ? -1 : zones.size()); // Note: past the last-index
-		int step = (reverseLoop ? -1 : 1);
-
-		for (int i = start; i != end; i += step) {
-			ledStrip.channel[0].leds[ledIndex] = BGRToWRGBHex(
-				zones[i].getLastCalculatedAverageColor()
-			);
-
-			ledIndex++;
-		}
-	}
-}
-
-/// <summary>
-/// Converts a BGR value to a WBGR hex value.
-/// Note: White is included but set to 0.
-/// </summary>
-/// <param name="color">The color to be converted.</param>
-/// <returns>The WBGR hex value.</returns>
-int BGRToWRGBHex(cv::Vec3b color) {
-	//		  White			Blue 			   Green		   Red
-	return ((0 << 24) | (color[0] << 16) | (color[1] << 8) | color[2]);
-}
\ No newline at end of file